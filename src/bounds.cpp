@@ -0,0 +1,182 @@
+/*
+ *  Portions Copyright 2006,2009 David Carne and 2007,2008 Spark Fun Electronics
+ *
+ *
+ *  This file is part of gerberDRC.
+ *
+ *  gerberDRC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gerberDRC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <limits.h>
+#include <algorithm>
+
+#include "bounds.h"
+
+/*
+ * The search loops are written without branches on the data, over plain
+ * arrays, so the compiler can vectorise the compares. Matches are first
+ * marked in a small block of flags and then packed into the output.
+ */
+
+#define BOUNDS_BLOCK 256
+
+void BoundsTable::append(GerbObj * o)
+{
+	append(o, o->getBounds());
+}
+
+void BoundsTable::append(GerbObj * o, const Rect & r)
+{
+	Point a = r.getStartPoint(), b = r.getEndPoint();
+	if (!r.isSet())
+	{
+		a.x = a.y = LLONG_MAX;
+		b.x = b.y = LLONG_MIN;
+	}
+	minx.push_back(a.x);
+	miny.push_back(a.y);
+	maxx.push_back(b.x);
+	maxy.push_back(b.y);
+	objs.push_back(o);
+}
+
+void BoundsTable::append(const BoundsTable & t)
+{
+	minx.insert(minx.end(), t.minx.begin(), t.minx.end());
+	miny.insert(miny.end(), t.miny.begin(), t.miny.end());
+	maxx.insert(maxx.end(), t.maxx.begin(), t.maxx.end());
+	maxy.insert(maxy.end(), t.maxy.begin(), t.maxy.end());
+	objs.insert(objs.end(), t.objs.begin(), t.objs.end());
+}
+
+void BoundsTable::rebuild(const std::list<sp_GerbObj> & all)
+{
+	clear();
+	minx.reserve(all.size());
+	miny.reserve(all.size());
+	maxx.reserve(all.size());
+	maxy.reserve(all.size());
+	objs.reserve(all.size());
+	
+	std::list<sp_GerbObj>::const_iterator it = all.begin();
+	for (; it != all.end(); it++)
+		append((*it).get());
+}
+
+void BoundsTable::clear()
+{
+	minx.clear();
+	miny.clear();
+	maxx.clear();
+	maxy.clear();
+	objs.clear();
+}
+
+void BoundsTable::query(const Rect & r, std::vector<unsigned int> & out) const
+{
+	// An unset rect covers nothing, its corners are just zeroes
+	if (!r.isSet())
+		return;
+	
+	coord_t qx0 = r.getStartPoint().x, qy0 = r.getStartPoint().y;
+	coord_t qx1 = r.getEndPoint().x, qy1 = r.getEndPoint().y;
+	
+	unsigned int n = size();
+	const coord_t * x0 = n ? &minx[0] : NULL;
+	const coord_t * y0 = n ? &miny[0] : NULL;
+	const coord_t * x1 = n ? &maxx[0] : NULL;
+	const coord_t * y1 = n ? &maxy[0] : NULL;
+	
+	unsigned char hit[BOUNDS_BLOCK];
+	for (unsigned int base=0; base < n; base += BOUNDS_BLOCK)
+	{
+		unsigned int m = std::min(n - base, (unsigned int)BOUNDS_BLOCK);
+		for (unsigned int i=0; i < m; i++)
+		{
+			unsigned int k = base + i;
+			hit[i] = (x0[k] <= qx1) & (x1[k] >= qx0) & (y0[k] <= qy1) & (y1[k] >= qy0);
+		}
+		
+		unsigned int start = out.size();
+		out.resize(start + m);
+		unsigned int * o = &out[start];
+		unsigned int c = 0;
+		for (unsigned int i=0; i < m; i++)
+		{
+			o[c] = base + i;
+			c += hit[i];
+		}
+		out.resize(start + c);
+	}
+}
+
+struct bounds_minx_lt {
+	const coord_t * x;
+	bool operator()(unsigned int a, unsigned int b) const
+	{
+		return x[a] < x[b] || (x[a] == x[b] && a < b);
+	}
+};
+
+void BoundsTable::overlapping_pairs(coord_t d, std::vector<bounds_pair_t> & out) const
+{
+	// Sweep along x: with the boxes in minx order, the boxes that can meet
+	// box i are a run starting just after it
+	std::vector<unsigned int> order;
+	order.reserve(size());
+	for (unsigned int i=0; i < size(); i++)
+		if (minx[i] <= maxx[i])
+			order.push_back(i);
+	
+	struct bounds_minx_lt lt;
+	lt.x = order.empty() ? NULL : &minx[0];
+	std::sort(order.begin(), order.end(), lt);
+	
+	unsigned int n = order.size();
+	std::vector<coord_t> sx0(n), sx1(n), sy0(n), sy1(n);
+	for (unsigned int i=0; i < n; i++)
+	{
+		sx0[i] = minx[order[i]];
+		sx1[i] = maxx[order[i]];
+		sy0[i] = miny[order[i]];
+		sy1[i] = maxy[order[i]];
+	}
+	
+	unsigned char hit[BOUNDS_BLOCK];
+	unsigned int start = out.size();
+	for (unsigned int i=0; i < n; i++)
+	{
+		coord_t reach = sx1[i] + d;
+		unsigned int end = std::upper_bound(sx0.begin() + i + 1, sx0.end(), reach) - sx0.begin();
+		coord_t lo = sy0[i] - d, hi = sy1[i] + d;
+		
+		for (unsigned int base=i + 1; base < end; base += BOUNDS_BLOCK)
+		{
+			unsigned int m = std::min(end - base, (unsigned int)BOUNDS_BLOCK);
+			const coord_t * y0 = &sy0[base];
+			const coord_t * y1 = &sy1[base];
+			for (unsigned int j=0; j < m; j++)
+				hit[j] = (y0[j] <= hi) & (y1[j] >= lo);
+			
+			for (unsigned int j=0; j < m; j++)
+				if (hit[j])
+				{
+					unsigned int a = order[i], b = order[base + j];
+					out.push_back(a < b ? bounds_pair_t(a, b) : bounds_pair_t(b, a));
+				}
+		}
+	}
+	std::sort(out.begin() + start, out.end());
+}
@@ -0,0 +1,67 @@
+/*
+ *  Portions Copyright 2006,2009 David Carne and 2007,2008 Spark Fun Electronics
+ *
+ *
+ *  This file is part of gerberDRC.
+ *
+ *  gerberDRC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gerberDRC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef _BOUNDS_H_
+#define _BOUNDS_H_
+
+#include <list>
+#include <vector>
+#include <utility>
+
+#include "util_type.h"
+#include "gerbobj.h"
+
+typedef std::pair<unsigned int, unsigned int> bounds_pair_t;
+
+/*
+ * Bounding boxes of a set of objects, one array per edge so the broad
+ * phase searches [query, overlapping_pairs] run straight down memory
+ * instead of calling getBounds on every object.
+ *
+ * Entry i belongs to objs[i]. Objects with no extent [an empty polygon]
+ * get an inverted box that matches nothing.
+ */
+class BoundsTable {
+public:
+	void append(GerbObj * o);
+	void append(GerbObj * o, const Rect & r);
+	void append(const BoundsTable & t);
+	
+	// Reload from a layer, in list order
+	void rebuild(const std::list<sp_GerbObj> & all);
+	void clear();
+	
+	unsigned int size() const {return objs.size();};
+	
+	// Entries whose box touches r [closed], in table order. None for an
+	// unset r
+	void query(const Rect & r, std::vector<unsigned int> & out) const;
+	
+	// Every pair [i < j] whose boxes are no more than d apart on both axes.
+	// Sorted by i, then j
+	void overlapping_pairs(coord_t d, std::vector<bounds_pair_t> & out) const;
+	
+	std::vector<coord_t> minx, miny, maxx, maxy;
+	std::vector<GerbObj *> objs;
+};
+
+#endif
@@ -0,0 +1,112 @@
+/*
+ *  Portions Copyright 2006,2009 David Carne and 2007,2008 Spark Fun Electronics
+ *
+ *
+ *  This file is part of gerberDRC.
+ *
+ *  gerberDRC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gerberDRC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <math.h>
+
+#include "capsule.h"
+#include "ring.h"
+#include "gerbobj_line.h"
+
+bool line_capsule(const GerbObj_Line * l, struct capsule & c)
+{
+	if (l->width <= 0)
+		return false;
+	
+	c.a.x = l->sx;
+	c.a.y = l->sy;
+	c.b.x = l->ex;
+	c.b.y = l->ey;
+	c.r = l->width / 2;
+	return true;
+}
+
+Rect capsule_bounds(const struct capsule & c)
+{
+	Rect r(c.a.x, c.a.y, c.b.x, c.b.y);
+	r.feather(c.r);
+	return r;
+}
+
+static double seg_seg_dist(const Point & a, const Point & b, const Point & c, const Point & d)
+{
+	if (segs_cross(a, b, c, d))
+		return 0;
+	return fmin(fmin(pt_seg_dist(a, c, d), pt_seg_dist(b, c, d)),
+		fmin(pt_seg_dist(c, a, b), pt_seg_dist(d, a, b)));
+}
+
+double capsule_point_dist(const struct capsule & c, const Point & p)
+{
+	return pt_seg_dist(p, c.a, c.b) - c.r;
+}
+
+double capsule_gap(const struct capsule & x, const struct capsule & y)
+{
+	return seg_seg_dist(x.a, x.b, y.a, y.b) - x.r - y.r;
+}
+
+// Crossing number test, points on the outline may go either way
+static bool pt_in_ring(const Point & p, const Point * pts, unsigned int n)
+{
+	bool in = false;
+	for (unsigned int i=0, j=n - 1; i < n; j = i++)
+	{
+		const Point & a = pts[i], & b = pts[j];
+		if ((a.y > p.y) != (b.y > p.y) &&
+			p.x < a.x + (double)(b.x - a.x) * (p.y - a.y) / (double)(b.y - a.y))
+			in = !in;
+	}
+	return in;
+}
+
+bool capsule_meets_ring(const struct capsule & c, const Point * pts, unsigned int n)
+{
+	if (n == 0)
+		return false;
+	
+	// Either the spine starts inside the ring, or the ring's outline comes
+	// within r of the spine somewhere. A ring inside the capsule is caught
+	// by the second test
+	if (pt_in_ring(c.a, pts, n))
+		return true;
+	
+	for (unsigned int i=0, j=n - 1; i < n; j = i++)
+		if (seg_seg_dist(c.a, c.b, pts[j], pts[i]) <= c.r)
+			return true;
+	return false;
+}
+
+int arc_steps_for_tol(coord_t r, coord_t tol, int maxsteps)
+{
+	if (tol <= 0)
+		return maxsteps;
+	if (r <= tol)
+		return 2;
+	
+	// A chord over angle t sits r * (1 - cos(t/2)) inside the arc
+	double t = 2 * acos(1.0 - (double)tol / r);
+	int n = (int)ceil(M_PI / t);
+	if (n < 2)
+		n = 2;
+	if (n > maxsteps)
+		n = maxsteps;
+	return n;
+}
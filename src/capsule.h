@@ -0,0 +1,61 @@
+/*
+ *  Portions Copyright 2006,2009 David Carne and 2007,2008 Spark Fun Electronics
+ *
+ *
+ *  This file is part of gerberDRC.
+ *
+ *  gerberDRC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gerberDRC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef _CAPSULE_H_
+#define _CAPSULE_H_
+
+#include "util_type.h"
+
+class GerbObj_Line;
+
+/*
+ * A round capped trace held analytically: every point within r of the
+ * segment a-b. Bounds, distance and overlap tests work on this directly,
+ * so a line only has to become a polygon [createPolyForLine] when a
+ * boolean needs its outline.
+ */
+struct capsule {
+	Point a, b;
+	coord_t r;
+};
+
+// False for lines with no area [zero width]
+bool line_capsule(const GerbObj_Line * l, struct capsule & c);
+
+Rect capsule_bounds(const struct capsule & c);
+
+// Distance from p to the outline, negative inside
+double capsule_point_dist(const struct capsule & c, const Point & p);
+
+// Gap between two outlines, zero or negative when they touch
+double capsule_gap(const struct capsule & x, const struct capsule & y);
+
+// The capsule and the closed ring pts[0..n-1] share any point
+bool capsule_meets_ring(const struct capsule & c, const Point * pts, unsigned int n);
+
+/*
+ * Steps per half circle so that no chord strays more than tol from an arc
+ * of radius r, within [2, maxsteps]
+ */
+int arc_steps_for_tol(coord_t r, coord_t tol, int maxsteps);
+
+#endif
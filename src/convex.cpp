@@ -0,0 +1,441 @@
+/*
+ *  Portions Copyright 2006,2009 David Carne and 2007,2008 Spark Fun Electronics
+ *
+ *
+ *  This file is part of gerberDRC.
+ *
+ *  gerberDRC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gerberDRC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <math.h>
+#include <algorithm>
+
+#include "convex.h"
+#include "trapezoid.h"
+#include "capsule.h"
+#include "gerbobj_poly.h"
+#include "gerbobj_line.h"
+#include "gcode_interp.h"
+#include "main.h"
+
+// Trapezoid sides closer than this [grid steps] are taken as the same
+#define CVX_EPS 1e-3
+
+// and slopes [dx/dy] closer than this as one straight side
+#define CVX_SLOPE_EPS 1e-7
+
+void ConvexParts::add_piece(const std::vector<struct cvx_point> & p)
+{
+	struct convex_piece c;
+	c.first = pts.size();
+	c.minx = c.miny = INFINITY;
+	c.maxx = c.maxy = -INFINITY;
+	for (unsigned int i=0; i < p.size(); i++)
+	{
+		const struct cvx_point & q = p[i];
+		if (pts.size() > c.first && fabs(pts.back().x - q.x) <= CVX_EPS && fabs(pts.back().y - q.y) <= CVX_EPS)
+			continue;
+		pts.push_back(q);
+		c.minx = fmin(c.minx, q.x);
+		c.miny = fmin(c.miny, q.y);
+		c.maxx = fmax(c.maxx, q.x);
+		c.maxy = fmax(c.maxy, q.y);
+	}
+	if (pts.size() - c.first > 1 && fabs(pts.back().x - pts[c.first].x) <= CVX_EPS &&
+		fabs(pts.back().y - pts[c.first].y) <= CVX_EPS)
+		pts.pop_back();
+	
+	// Nothing with area, its neighbours cover its outline
+	c.count = pts.size() - c.first;
+	if (c.count < 3)
+	{
+		pts.resize(c.first);
+		return;
+	}
+	pieces.push_back(c);
+}
+
+// A piece growing upwards, as its left and right sides from the bottom
+struct stack_piece {
+	std::vector<struct cvx_point> left, right;
+	double lslope, rslope;
+};
+
+static void add_point(std::vector<struct cvx_point> & side, double x, double y)
+{
+	struct cvx_point p = {x, y};
+	side.push_back(p);
+}
+
+static struct cvx_point cvx_pt(double x, double y)
+{
+	struct cvx_point p = {x, y};
+	return p;
+}
+
+ConvexParts::ConvexParts(const ring_t & r, const PolyTraps * t)
+{
+	if (ring_convex(r))
+	{
+		std::vector<struct cvx_point> p;
+		for (unsigned int i=0; i < r.size(); i++)
+			p.push_back(cvx_pt(r[i].x, r[i].y));
+		if (ring_area(r) < 0)
+			std::reverse(p.begin(), p.end());
+		add_piece(p);
+		return;
+	}
+	
+	/*
+	 * A trapezoid carries on the piece below when its bottom is that
+	 * piece's top, and the left side still bends left [slope dx/dy not
+	 * decreasing] and the right side right. Pieces nothing carries on
+	 * are finished
+	 */
+	std::vector<stack_piece> open, next;
+	for (unsigned int s=0; s < t->slabCount(); s++)
+	{
+		double y0 = t->ys[s], y1 = t->ys[s+1];
+		std::vector<bool> used(open.size(), false);
+		next.clear();
+		
+		unsigned int j = 0;
+		for (unsigned int i=t->first[s]; i < t->first[s+1]; i++)
+		{
+			const struct trapezoid & z = t->traps[i];
+			double ls = (z.xl1 - z.xl0) / (y1 - y0), rs = (z.xr1 - z.xr0) / (y1 - y0);
+			
+			// Pieces already carried on have given up their sides
+			while (j < open.size() && (used[j] || open[j].left.back().x < z.xl0 - CVX_EPS))
+				j++;
+			if (j < open.size() &&
+				fabs(open[j].left.back().x - z.xl0) <= CVX_EPS &&
+				fabs(open[j].right.back().x - z.xr0) <= CVX_EPS &&
+				open[j].left.back().y == y0 &&
+				ls >= open[j].lslope - CVX_SLOPE_EPS && rs <= open[j].rslope + CVX_SLOPE_EPS)
+			{
+				used[j] = true;
+				next.push_back(stack_piece());
+				stack_piece & p = next.back();
+				p.left.swap(open[j].left);
+				p.right.swap(open[j].right);
+				
+				// Straight on, the corner goes
+				if (fabs(ls - open[j].lslope) <= CVX_SLOPE_EPS)
+					p.left.pop_back();
+				if (fabs(rs - open[j].rslope) <= CVX_SLOPE_EPS)
+					p.right.pop_back();
+				add_point(p.left, z.xl1, y1);
+				add_point(p.right, z.xr1, y1);
+				p.lslope = ls;
+				p.rslope = rs;
+				continue;
+			}
+			
+			next.push_back(stack_piece());
+			stack_piece & p = next.back();
+			add_point(p.left, z.xl0, y0);
+			add_point(p.left, z.xl1, y1);
+			add_point(p.right, z.xr0, y0);
+			add_point(p.right, z.xr1, y1);
+			p.lslope = ls;
+			p.rslope = rs;
+		}
+		
+		for (unsigned int k=0; k < open.size(); k++)
+			if (!used[k])
+			{
+				std::vector<struct cvx_point> poly(open[k].right);
+				poly.insert(poly.end(), open[k].left.rbegin(), open[k].left.rend());
+				add_piece(poly);
+			}
+		open.swap(next);
+	}
+	for (unsigned int k=0; k < open.size(); k++)
+	{
+		std::vector<struct cvx_point> poly(open[k].right);
+		poly.insert(poly.end(), open[k].left.rbegin(), open[k].left.rend());
+		add_piece(poly);
+	}
+}
+
+long ConvexParts::bytes() const
+{
+	return sizeof(*this) + pts.capacity() * sizeof(struct cvx_point) +
+		pieces.capacity() * sizeof(struct convex_piece);
+}
+
+/*
+ * Pairs of convex shapes: counterclockwise polygons, or a segment [two
+ * points] or a single point
+ */
+
+// pt_seg_dist [ring.h] for piece corners, which are off the grid
+static double cvx_seg_dist(const struct cvx_point & p, const struct cvx_point & a, const struct cvx_point & b)
+{
+	double dx = b.x - a.x, dy = b.y - a.y;
+	double l = dx * dx + dy * dy;
+	double t = l > 0 ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / l : 0;
+	t = fmax(0, fmin(1, t));
+	double ex = a.x + t * dx - p.x, ey = a.y + t * dy - p.y;
+	return sqrt(ex * ex + ey * ey);
+}
+
+// Some edge of a has all of b strictly outside it. Each edge of a
+// counterclockwise polygon is its furthest point along its own normal
+static bool separates(const struct cvx_point * a, unsigned int n, const struct cvx_point * b, unsigned int m)
+{
+	for (unsigned int i=0; i < n; i++)
+	{
+		const struct cvx_point & p = a[i], & q = a[(i+1) % n];
+		double nx = q.y - p.y, ny = p.x - q.x;
+		if (nx == 0 && ny == 0)
+			continue;
+		double top = p.x * nx + p.y * ny;
+		unsigned int k = 0;
+		for (; k < m; k++)
+			if (b[k].x * nx + b[k].y * ny <= top)
+				break;
+		if (k == m)
+			return true;
+	}
+	return false;
+}
+
+// side [ring.h] for piece corners
+static double cvx_side(const struct cvx_point & a, const struct cvx_point & b, const struct cvx_point & p)
+{
+	return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+}
+
+/*
+ * Segments and points have no edges across their length, so two of them
+ * can't go by separating edges. They meet if each one's ends aren't both
+ * strictly on one side of the other; collinear ones are left to the
+ * distances
+ */
+static bool segs_meet(const struct cvx_point * a, const struct cvx_point * b)
+{
+	double d1 = cvx_side(b[0], b[1], a[0]), d2 = cvx_side(b[0], b[1], a[1]);
+	double d3 = cvx_side(a[0], a[1], b[0]), d4 = cvx_side(a[0], a[1], b[1]);
+	return ((d1 <= 0 && d2 >= 0) || (d1 >= 0 && d2 <= 0)) &&
+		((d3 <= 0 && d4 >= 0) || (d3 >= 0 && d4 <= 0)) &&
+		!(d1 == 0 && d2 == 0);
+}
+
+static double cvx_gap(const struct cvx_point * a, unsigned int n, const struct cvx_point * b, unsigned int m)
+{
+	if (n >= 3 || m >= 3)
+	{
+		if (!separates(a, n, b, m) && !separates(b, m, a, n))
+			return 0;
+	} else if (n == 2 && m == 2 && segs_meet(a, b)) {
+		return 0;
+	}
+	
+	double best = INFINITY;
+	for (unsigned int i=0; i < n; i++)
+		for (unsigned int k=0; k < m; k++)
+			best = fmin(best, cvx_seg_dist(a[i], b[k], b[(k+1) % m]));
+	for (unsigned int k=0; k < m; k++)
+		for (unsigned int i=0; i < n; i++)
+			best = fmin(best, cvx_seg_dist(b[k], a[i], a[(i+1) % n]));
+	return best;
+}
+
+// One side of a pair: a polygon's pieces, or a line's spine and radius
+struct gap_shape {
+	const ConvexParts * parts;
+	struct cvx_point spine[2];
+	struct convex_piece box;
+	double r;
+};
+
+static bool gap_shape_of(GerbObj * o, struct gap_shape & s, sp_ConvexParts & hold)
+{
+	GerbObj_Poly * p = dynamic_cast<GerbObj_Poly *>(o);
+	if (p)
+	{
+		hold = p->getParts();
+		s.parts = hold.get();
+		s.r = 0;
+		return true;
+	}
+	
+	GerbObj_Line * l = dynamic_cast<GerbObj_Line *>(o);
+	if (l)
+	{
+		struct capsule c;
+		if (!line_capsule(l, c))
+		{
+			c.a = Point(l->sx, l->sy);
+			c.b = Point(l->ex, l->ey);
+			c.r = 0;
+		}
+		s.parts = NULL;
+		s.spine[0] = cvx_pt(c.a.x, c.a.y);
+		s.spine[1] = cvx_pt(c.b.x, c.b.y);
+		s.box.first = 0;
+		s.box.count = (c.a.x == c.b.x && c.a.y == c.b.y) ? 1 : 2;
+		s.box.minx = std::min(c.a.x, c.b.x);
+		s.box.miny = std::min(c.a.y, c.b.y);
+		s.box.maxx = std::max(c.a.x, c.b.x);
+		s.box.maxy = std::max(c.a.y, c.b.y);
+		s.r = c.r;
+		return true;
+	}
+	return false;
+}
+
+static unsigned int shape_count(const struct gap_shape & s)
+{
+	return s.parts ? s.parts->pieces.size() : 1;
+}
+
+static const struct convex_piece & shape_piece(const struct gap_shape & s, unsigned int i)
+{
+	return s.parts ? s.parts->pieces[i] : s.box;
+}
+
+static const struct cvx_point * shape_pts(const struct gap_shape & s, const struct convex_piece & c)
+{
+	return s.parts ? &s.parts->pts[c.first] : s.spine;
+}
+
+static double shape_gap(const struct gap_shape & sa, const struct gap_shape & sb, double stop)
+{
+	// Round caps don't change which pieces are nearest, only by how much
+	double rr = sa.r + sb.r;
+	double best = INFINITY;
+	for (unsigned int i=0; i < shape_count(sa); i++)
+	{
+		const struct convex_piece & pa = shape_piece(sa, i);
+		for (unsigned int k=0; k < shape_count(sb); k++)
+		{
+			const struct convex_piece & pb = shape_piece(sb, k);
+			
+			// Box gap first, it can't be more than the real one
+			double dx = fmax(0, fmax(pb.minx - pa.maxx, pa.minx - pb.maxx));
+			double dy = fmax(0, fmax(pb.miny - pa.maxy, pa.miny - pb.maxy));
+			if (sqrt(dx * dx + dy * dy) - rr >= best)
+				continue;
+			
+			double g = cvx_gap(shape_pts(sa, pa), pa.count, shape_pts(sb, pb), pb.count) - rr;
+			if (g < best)
+			{
+				best = g;
+				if (best <= stop)
+					return fmax(best, 0);
+			}
+		}
+	}
+	return fmax(best, 0);
+}
+
+double obj_gap(GerbObj * a, GerbObj * b, double stop)
+{
+	struct gap_shape sa, sb;
+	sp_ConvexParts ha, hb;
+	if (!gap_shape_of(a, sa, ha) || !gap_shape_of(b, sb, hb))
+		return INFINITY;
+	return shape_gap(sa, sb, stop);
+}
+
+// A point is a line of no length or width
+double point_gap(GerbObj * o, coord_t x, coord_t y, double stop)
+{
+	struct gap_shape sa, sb;
+	sp_ConvexParts hb;
+	if (!gap_shape_of(o, sb, hb))
+		return INFINITY;
+	
+	sa.parts = NULL;
+	sa.spine[0] = sa.spine[1] = cvx_pt(x, y);
+	sa.box.first = 0;
+	sa.box.count = 1;
+	sa.box.minx = sa.box.maxx = x;
+	sa.box.miny = sa.box.maxy = y;
+	sa.r = 0;
+	return shape_gap(sa, sb, stop);
+}
+
+void close_pairs_vector_outp(Vector_Outp * v, coord_t d, std::vector<bounds_pair_t> & out)
+{
+	out.clear();
+	std::vector<bounds_pair_t> cand;
+	v->bounds.overlapping_pairs(d, cand);
+	
+	for (unsigned int i=0; i < cand.size(); i++)
+		if (obj_gap(v->bounds.objs[cand[i].first], v->bounds.objs[cand[i].second], d) <= d)
+			out.push_back(cand[i]);
+	
+	DBG_MSG_PF("Close pairs: %ld of %ld box pairs within %.3fum",
+		(long)out.size(), (long)cand.size(), coord_to_um(d));
+}
+
+// Outline distance to one object of the layer, see rtree_box_kernel
+struct obj_gap_kernel {
+	const BoundsTable * t;
+	GerbObj * from;
+	double operator()(unsigned int i, double stop) const
+	{
+		if (t->objs[i] == from)
+			return INFINITY;
+		return obj_gap(from, t->objs[i], stop);
+	};
+};
+
+struct point_gap_kernel {
+	const BoundsTable * t;
+	coord_t x, y;
+	double operator()(unsigned int i, double stop) const
+	{
+		return point_gap(t->objs[i], x, y, stop);
+	};
+};
+
+struct within_collect {
+	std::vector<unsigned int> * out;
+	void operator()(unsigned int i) {out->push_back(i);};
+};
+
+// Distance queries go best first down the R-tree
+static const PackedRTree & layer_rtree(Vector_Outp * v)
+{
+	if (v->index != INDEX_RTREE)
+		index_vector_outp(v, INDEX_RTREE);
+	return v->rtree;
+}
+
+void nearest_vector_outp(Vector_Outp * v, GerbObj * o, unsigned int k, std::vector<struct rtree_hit> & out, double maxd)
+{
+	struct obj_gap_kernel g = {&v->bounds, o};
+	layer_rtree(v).nearest(o->getBounds(), k, g, out, maxd);
+}
+
+void nearest_vector_outp(Vector_Outp * v, coord_t x, coord_t y, unsigned int k, std::vector<struct rtree_hit> & out, double maxd)
+{
+	struct point_gap_kernel g = {&v->bounds, x, y};
+	layer_rtree(v).nearest(Rect(x, y, x, y), k, g, out, maxd);
+}
+
+void within_vector_outp(Vector_Outp * v, GerbObj * o, coord_t d, std::vector<unsigned int> & out)
+{
+	out.clear();
+	struct obj_gap_kernel g = {&v->bounds, o};
+	struct within_collect c = {&out};
+	layer_rtree(v).within(o->getBounds(), d, g, c);
+	std::sort(out.begin(), out.end());
+}
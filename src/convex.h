@@ -0,0 +1,99 @@
+/*
+ *  Portions Copyright 2006,2009 David Carne and 2007,2008 Spark Fun Electronics
+ *
+ *
+ *  This file is part of gerberDRC.
+ *
+ *  gerberDRC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gerberDRC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef _CONVEX_H_
+#define _CONVEX_H_
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+#include "ring.h"
+#include "bounds.h"
+#include "rtree.h"
+
+class GerbObj;
+class PolyTraps;
+class Vector_Outp;
+
+struct cvx_point {
+	double x, y;
+};
+
+// pts[first, first+count), counterclockwise, and its bounding box
+struct convex_piece {
+	unsigned int first, count;
+	double minx, miny, maxx, maxy;
+};
+
+/*
+ * A polygon as convex pieces that together cover it exactly. A convex
+ * outline is its own single piece. Anything else is built from its
+ * trapezoids [PolyTraps], stacking each on the one below while the sides
+ * keep turning inwards
+ */
+class ConvexParts {
+public:
+	ConvexParts(const ring_t & r, const PolyTraps * t);
+	
+	std::vector<struct cvx_point> pts;
+	std::vector<struct convex_piece> pieces;
+	
+	long bytes() const;
+	
+private:
+	void add_piece(const std::vector<struct cvx_point> & p);
+};
+
+typedef boost::shared_ptr<const ConvexParts> sp_ConvexParts;
+
+/*
+ * Distance between two objects' outlines, 0 if they touch or overlap.
+ * Polygons go by their convex pieces, lines as capsules. Once some gap no
+ * more than stop turns up it is returned without looking for a smaller
+ * one, so with stop = 0 this is an overlap test. INFINITY for objects it
+ * can't look inside
+ */
+double obj_gap(GerbObj * a, GerbObj * b, double stop = 0);
+
+// Distance from a point to an object's outline, 0 inside it. stop as
+// for obj_gap
+double point_gap(GerbObj * o, coord_t x, coord_t y, double stop = 0);
+
+// Pairs of the layer's objects no more than d apart, as table entries
+// [Vector_Outp::bounds] in the order of overlapping_pairs
+void close_pairs_vector_outp(Vector_Outp * v, coord_t d, std::vector<bounds_pair_t> & out);
+
+/*
+ * The k objects of the layer nearest to o [not counting o itself] or to a
+ * point, by outline distance and nearest first, up to maxd away. These
+ * search v->rtree, and build it if the layer uses another index
+ */
+void nearest_vector_outp(Vector_Outp * v, GerbObj * o, unsigned int k,
+	std::vector<struct rtree_hit> & out, double maxd = INFINITY);
+void nearest_vector_outp(Vector_Outp * v, coord_t x, coord_t y, unsigned int k,
+	std::vector<struct rtree_hit> & out, double maxd = INFINITY);
+
+// Objects whose outline is no more than d from o's, other than o, as
+// table entries in order
+void within_vector_outp(Vector_Outp * v, GerbObj * o, coord_t d, std::vector<unsigned int> & out);
+
+#endif
@@ -0,0 +1,321 @@
+/*
+ *  Portions Copyright 2006,2009 David Carne and 2007,2008 Spark Fun Electronics
+ *
+ *
+ *  This file is part of gerberDRC.
+ *
+ *  gerberDRC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gerberDRC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <math.h>
+#include <list>
+#include <vector>
+#include <tr1/unordered_map>
+#include <boost/functional/hash.hpp>
+
+#include "dedup.h"
+#include "bounds.h"
+#include "ring.h"
+#include "gerbobj_line.h"
+#include "gerbobj_poly.h"
+#include "main.h"
+
+/*
+ * Duplicate and covered object removal
+ *
+ * Coordinates are on the integer grid, so an exact copy of an object has
+ * exactly the same numbers. Each object is reduced to a key [kind, width,
+ * points, with line ends put in order] and the keys are hashed.
+ *
+ * For the rest, a BoundsTable sweep finds the pairs whose bounds meet.
+ * Each object is dropped if one of the objects it is paired with contains
+ * it. An object that is dropped can't hide another, so two objects that
+ * cover each other [the same outline started at another vertex] keep one.
+ */
+
+typedef std::vector<coord_t> geom_key_t;
+typedef std::tr1::unordered_map<geom_key_t, int, boost::hash<geom_key_t> > key_map_t;
+
+struct dedup_obj {
+	std::list<sp_GerbObj>::iterator pos;
+	GerbObj_Line * l;
+	GerbObj_Poly * p;
+	std::vector<Point> pts;		// polygon outline, without a closing point
+	Rect bounds;
+	bool convex;
+	bool alive;
+};
+
+static inline Point grid_point(coord_t x, coord_t y)
+{
+	Point p;
+	p.x = x;
+	p.y = y;
+	return p;
+}
+
+static void obj_key(const dedup_obj & o, geom_key_t & k)
+{
+	k.clear();
+	if (o.l)
+	{
+		const GerbObj_Line * l = o.l;
+		bool swap = l->ex < l->sx || (l->ex == l->sx && l->ey < l->sy);
+		k.push_back(0);
+		k.push_back(l->lt);
+		k.push_back(l->width);
+		k.push_back(swap ? l->ex : l->sx);
+		k.push_back(swap ? l->ey : l->sy);
+		k.push_back(swap ? l->sx : l->ex);
+		k.push_back(swap ? l->sy : l->ey);
+		return;
+	}
+	
+	k.push_back(1);
+	for (unsigned int i=0; i < o.pts.size(); i++)
+	{
+		k.push_back(o.pts[i].x);
+		k.push_back(o.pts[i].y);
+	}
+}
+
+// Convex, either way round. Repeated and collinear points are allowed
+static bool pts_convex(const std::vector<Point> & r)
+{
+	unsigned int n = r.size();
+	if (n < 3)
+		return false;
+	
+	int sign = 0;
+	for (unsigned int i=0; i < n; i++)
+	{
+		coord_t s = side(r[i], r[(i+1) % n], r[(i+2) % n]);
+		int ss = s > 0 ? 1 : s < 0 ? -1 : 0;
+		if (ss == 0)
+			continue;
+		if (sign != 0 && ss != sign)
+			return false;
+		sign = ss;
+	}
+	if (sign == 0)
+		return false;
+	
+	// A star is locally convex at every vertex but winds twice
+	double turn = 0;
+	for (unsigned int i=0; i < n; i++)
+	{
+		const Point & a = r[i], & b = r[(i+1) % n], & c = r[(i+2) % n];
+		if ((a.x == b.x && a.y == b.y) || (b.x == c.x && b.y == c.y))
+			continue;
+		turn += atan2((double)side(a, b, c),
+			(double)(b.x - a.x) * (c.x - b.x) + (double)(b.y - a.y) * (c.y - b.y));
+	}
+	return fabs(turn) < 3 * M_PI;
+}
+
+// Disc [p, r] inside the convex polygon c
+static bool disc_in_convex(const std::vector<Point> & c, const Point & p, double r)
+{
+	unsigned int n = c.size();
+	double sign = 0;
+	for (unsigned int i=0; i < n && sign == 0; i++)
+	{
+		coord_t s = side(c[i], c[(i+1) % n], c[(i+2) % n]);
+		sign = s > 0 ? 1 : s < 0 ? -1 : 0;
+	}
+	
+	for (unsigned int i=0; i < n; i++)
+	{
+		const Point & a = c[i], & b = c[(i+1) % n];
+		if (a.x == b.x && a.y == b.y)
+			continue;
+		
+		// Signed distance from the edge, positive inside
+		double len = sqrt((double)(b.x - a.x) * (b.x - a.x) + (double)(b.y - a.y) * (b.y - a.y));
+		if (sign * (double)side(a, b, p) < r * len)
+			return false;
+	}
+	return true;
+}
+
+// c contains o
+static bool obj_contains(const dedup_obj & c, const dedup_obj & o)
+{
+	if (!c.bounds.pointInRectClosed(o.bounds.getStartPoint()) ||
+		!c.bounds.pointInRectClosed(o.bounds.getEndPoint()))
+		return false;
+	
+	if (c.l)
+	{
+		// A line is the hull of its end discs, so o is inside if its end
+		// discs, or its points, are
+		if (c.l->lt != LT_STRAIGHT)
+			return false;
+		Point cs = grid_point(c.l->sx, c.l->sy);
+		Point ce = grid_point(c.l->ex, c.l->ey);
+		double r = c.l->width / 2.0;
+		
+		if (o.l)
+		{
+			if (o.l->lt != LT_STRAIGHT)
+				return false;
+			Point os = grid_point(o.l->sx, o.l->sy);
+			Point oe = grid_point(o.l->ex, o.l->ey);
+			double ro = o.l->width / 2.0;
+			return pt_seg_dist(os, cs, ce) + ro <= r && pt_seg_dist(oe, cs, ce) + ro <= r;
+		}
+		
+		for (unsigned int i=0; i < o.pts.size(); i++)
+			if (pt_seg_dist(o.pts[i], cs, ce) > r)
+				return false;
+		return true;
+	}
+	
+	if (!c.convex)
+		return false;
+	
+	if (o.l)
+	{
+		if (o.l->lt != LT_STRAIGHT)
+			return false;
+		Point os = grid_point(o.l->sx, o.l->sy);
+		Point oe = grid_point(o.l->ex, o.l->ey);
+		double ro = o.l->width / 2.0;
+		return disc_in_convex(c.pts, os, ro) && disc_in_convex(c.pts, oe, ro);
+	}
+	
+	for (unsigned int i=0; i < o.pts.size(); i++)
+		if (!disc_in_convex(c.pts, o.pts[i], 0))
+			return false;
+	return true;
+}
+
+// Dedup one dark run
+static void dedup_run(Vector_Outp * v, std::vector<dedup_obj> & objs, struct dedup_stats & st)
+{
+	key_map_t keys;
+	geom_key_t k;
+	for (unsigned int i=0; i < objs.size(); i++)
+	{
+		obj_key(objs[i], k);
+		if (!keys.insert(key_map_t::value_type(k, i)).second)
+		{
+			objs[i].alive = false;
+			st.duplicates++;
+		}
+	}
+	
+	// Broad phase: every pair of live objects whose boxes meet, as a
+	// candidate list per object in index order
+	BoundsTable bt;
+	for (unsigned int i=0; i < objs.size(); i++)
+		bt.append(objs[i].alive ? (*objs[i].pos).get() : NULL, objs[i].alive ? objs[i].bounds : Rect());
+	
+	std::vector<bounds_pair_t> pairs;
+	bt.overlapping_pairs(0, pairs);
+	
+	std::vector<unsigned int> first(objs.size() + 1, 0), cands(pairs.size() * 2);
+	for (unsigned int k=0; k < pairs.size(); k++)
+	{
+		first[pairs[k].first + 1]++;
+		first[pairs[k].second + 1]++;
+	}
+	for (unsigned int i=0; i < objs.size(); i++)
+		first[i + 1] += first[i];
+	std::vector<unsigned int> fill(first.begin(), first.end() - 1);
+	for (unsigned int k=0; k < pairs.size(); k++)
+	{
+		cands[fill[pairs[k].first]++] = pairs[k].second;
+		cands[fill[pairs[k].second]++] = pairs[k].first;
+	}
+	
+	for (unsigned int i=0; i < objs.size(); i++)
+	{
+		dedup_obj & o = objs[i];
+		if (!o.alive)
+			continue;
+		
+		for (unsigned int k=first[i]; k < first[i + 1]; k++)
+		{
+			unsigned int c = cands[k];
+			if (!objs[c].alive)
+				continue;
+			if (obj_contains(objs[c], o))
+			{
+				o.alive = false;
+				st.covered++;
+				break;
+			}
+		}
+	}
+	
+	for (unsigned int i=0; i < objs.size(); i++)
+		if (!objs[i].alive)
+			v->all.erase(objs[i].pos);
+}
+
+struct dedup_stats dedup_vector_outp(Vector_Outp * v)
+{
+	struct dedup_stats st;
+	st.duplicates = 0;
+	st.covered = 0;
+	long before = v->all.size();
+	
+	std::vector<dedup_obj> run;
+	std::list<sp_GerbObj>::iterator it = v->all.begin();
+	while (it != v->all.end())
+	{
+		GerbObj * o = (*it).get();
+		
+		// Objects on either side of a clear object can't replace each
+		// other, the clear object only erases the earlier one
+		if (o->clear)
+		{
+			dedup_run(v, run, st);
+			run.clear();
+			++it;
+			continue;
+		}
+		
+		dedup_obj d;
+		d.pos = it;
+		d.l = dynamic_cast<GerbObj_Line *>(o);
+		d.p = dynamic_cast<GerbObj_Poly *>(o);
+		d.alive = true;
+		d.convex = false;
+		++it;
+		
+		if (d.p)
+		{
+			d.pts.assign(d.p->pointBegin(), d.p->pointEnd());
+			if (d.pts.size() > 1 && d.pts.front().x == d.pts.back().x && d.pts.front().y == d.pts.back().y)
+				d.pts.pop_back();
+			if (d.pts.size() < 3)
+				continue;
+			d.convex = pts_convex(d.pts);
+		} else if (!d.l) {
+			continue;
+		}
+		
+		d.bounds = o->getBounds();
+		run.push_back(d);
+	}
+	dedup_run(v, run, st);
+	reindex_vector_outp(v);
+	
+	DBG_MSG_PF("Dedup: %ld objects -> %ld, %ld duplicates, %ld covered",
+		before, (long)v->all.size(), st.duplicates, st.covered);
+	return st;
+}
@@ -0,0 +1,44 @@
+/*
+ *  Portions Copyright 2006,2009 David Carne and 2007,2008 Spark Fun Electronics
+ *
+ *
+ *  This file is part of gerberDRC.
+ *
+ *  gerberDRC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gerberDRC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef _DEDUP_H_
+#define _DEDUP_H_
+
+#include "gcode_interp.h"
+
+struct dedup_stats {
+	long duplicates;	// exact copies of an earlier object
+	long covered;		// inside another object
+};
+
+/*
+ * Remove objects that add nothing to the layer: exact duplicates [same
+ * kind, width and points] and objects that lie entirely inside another
+ * one. Objects are only compared within the same dark run [between clear
+ * objects], so polarity is unaffected.
+ *
+ * Containment is exact for lines in lines, and for anything in a convex
+ * polygon. Other pairs are kept.
+ */
+struct dedup_stats dedup_vector_outp(Vector_Outp * v);
+
+#endif
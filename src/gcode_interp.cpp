@@ -23,12 +23,17 @@
 #include <string.h>
 #include <assert.h>
 #include <math.h>
+#include <float.h>
+#include <pthread.h>
 
 #include "gerbobj_line.h"
 #include "gerbobj_poly.h"
 
 #include "gcode_interp.h"
 #include "gerber_parse.h"
+#include "polarity.h"
+#include "normalize.h"
+#include "simplify.h"
 #include "main.h"
 #include "types.h"
 
@@ -54,25 +59,112 @@ struct GCODE_state {
 	
 	bool done;
 	
+	// Only track the modal state, don't create any geometry
+	bool dry_run;
+	
+	// Layer polarity [%LPC*%]
+	bool clear;
+	
 	GerbObj_Poly * cpoly;
 	
 	// Destination when we execute
-	double destination_x;
-	double destination_y;
-	double destination_i;
-	double destination_j;
+	coord_t destination_x;
+	coord_t destination_y;
+	coord_t destination_i;
+	coord_t destination_j;
 	
 	// Location before executing
-	double current_x;
-	double current_y;
+	coord_t current_x;
+	coord_t current_y;
 	
 };
 
-static double unit_convert(struct GCODE_state * s, double data)
+/*
+ * Add an object to the output, tagged with the current layer polarity
+ */
+static void add_obj(struct GCODE_state * s, Vector_Outp * v, GerbObj * o)
+{
+	o->clear = s->clear;
+	o->id = v->bounds.size();
+	v->all.push_back(sp_GerbObj(o));
+	v->bounds.append(o);
+	if (v->index != INDEX_SCAN)
+		index_vector_outp(v, INDEX_SCAN);
+	if (s->clear)
+		v->has_clear = true;
+}
+
+/*
+ * Regions [G36/G37] are outlined by hand in the file, and may cross
+ * themselves or wind either way. They are normalized as they are added,
+ * then simplified [arcs come tessellated]
+ */
+static void add_region(struct GCODE_state * s, Vector_Outp * v, GerbObj_Poly * p)
 {
-	if (s->um == UNITMODE_IN)
-		return data * 25400;
-	return data * 1000;
+	struct normalize_stats st;
+	memset(&st, 0, sizeof(st));
+	ring_t r(p->points.begin(), p->points.end());
+	ring_list_t out;
+	if (!ring_normalize(r, out, st))
+	{
+		delete p;
+		return;
+	}
+	for (unsigned int i=0; i < out.size(); i++)
+		simplify_ring(out[i], SIMPLIFY_TOL);
+	
+	p->points.assign(out[0].begin(), out[0].end());
+	p->pointsChanged();
+	add_obj(s, v, p);
+	for (unsigned int i=1; i < out.size(); i++)
+	{
+		GerbObj_Poly * np = new GerbObj_Poly();
+		np->points.assign(out[i].begin(), out[i].end());
+		add_obj(s, v, np);
+	}
+}
+
+void reindex_vector_outp(Vector_Outp * v)
+{
+	obj_id_t id = 0;
+	std::list<sp_GerbObj>::iterator it = v->all.begin();
+	for (; it != v->all.end(); it++)
+		(*it)->id = id++;
+	v->bounds.rebuild(v->all);
+	index_vector_outp(v, INDEX_SCAN);
+}
+
+void index_vector_outp(Vector_Outp * v, enum layer_index_t kind)
+{
+	v->grid.clear();
+	v->rtree.clear();
+	if (kind == INDEX_GRID)
+		v->grid.build(v->bounds);
+	else if (kind == INDEX_RTREE)
+		v->rtree.build(v->bounds);
+	v->index = kind;
+}
+
+void query_vector_outp(const Vector_Outp * v, const Rect & r, std::vector<unsigned int> & out)
+{
+	switch (v->index)
+	{
+		case INDEX_GRID:
+			v->grid.query(r, out);
+			break;
+		case INDEX_RTREE:
+			v->rtree.query(r, out);
+			break;
+		default:
+			out.clear();
+			v->bounds.query(r, out);
+	}
+}
+
+// Put a file coordinate on the coord_t grid
+static coord_t unit_convert(struct GCODE_state * s, const struct RS274X_Program::gcode_coord_t & c)
+{
+	return file_to_coord(c.value, c.frac, s->um);
 }
 
 bool can_trace_aperture(const struct RS274X_Program::aperture * ap)
@@ -99,11 +191,13 @@ bool handle_G_op(struct GCODE_state * s, const struct RS274X_Program::gcode_bloc
 			s->interp_360 = true;
 			break;
 		case 36:
-			s->cpoly = new GerbObj_Poly();
+			if (!s->dry_run)
+				s->cpoly = new GerbObj_Poly();
 			s->poly_fill = true;
 			break;
 		case 37:
-			v->all.push_back(sp_GerbObj(s->cpoly));
+			if (!s->dry_run)
+				add_region(s, v, s->cpoly);
 			s->cpoly = NULL;
 			s->poly_fill = false;
 			break;
@@ -168,16 +262,16 @@ bool handle_coord(struct GCODE_state * s, const struct RS274X_Program::gcode_blo
 	switch (b.op)
 	{
 		case RS274X_Program::GCO_X:
-			s->destination_x = unit_convert(s, b.dbl_data);
+			s->destination_x = unit_convert(s, b.coord_data);
 			break;
 		case RS274X_Program::GCO_Y:
-			s->destination_y = unit_convert(s, b.dbl_data);
+			s->destination_y = unit_convert(s, b.coord_data);
 			break;
 		case RS274X_Program::GCO_I:
-			s->destination_i = unit_convert(s, b.dbl_data);
+			s->destination_i = unit_convert(s, b.coord_data);
 			break;
 		case RS274X_Program::GCO_J:
-			s->destination_j = unit_convert(s, b.dbl_data);
+			s->destination_j = unit_convert(s, b.coord_data);
 			break;
 		default:
 			DBG_ERR_PF("Cannot handle coord for op: %d", b.op);
@@ -188,7 +282,139 @@ bool handle_coord(struct GCODE_state * s, const struct RS274X_Program::gcode_blo
 	return true;
 }
 
-GerbObj * aperture_flash_create_poly(struct GCODE_state *s, const struct RS274X_Program::aperture * ap)
+/*
+ * Copy of a cached macro object, moved to the flash location
+ */
+static GerbObj * translate_macro_obj(const GerbObj * o, coord_t dx, coord_t dy)
+{
+	const GerbObj_Line * l = dynamic_cast<const GerbObj_Line *>(o);
+	if (l)
+	{
+		GerbObj_Line * n = new GerbObj_Line();
+		n->sx = l->sx + dx;
+		n->sy = l->sy + dy;
+		n->ex = l->ex + dx;
+		n->ey = l->ey + dy;
+		n->width = l->width;
+		n->lt = l->lt;
+		n->lc = l->lc;
+		return n;
+	}
+	
+	const GerbObj_Poly * p = dynamic_cast<const GerbObj_Poly *>(o);
+	if (p)
+	{
+		GerbObj_Poly * n = new GerbObj_Poly();
+		n->points.reserve(p->pointCount());
+		GerbObj_Poly::point_iter it = p->pointBegin();
+		for (; it != p->pointEnd(); ++it)
+		{
+			Point q = *it;
+			q.x += dx;
+			q.y += dy;
+			n->addPoint(q);
+		}
+		return n;
+	}
+	
+	return NULL;
+}
+
+/*
+ * Flash a macro aperture. A macro can produce several objects, so they are
+ * added to the output directly. The macro itself is only evaluated on the
+ * first flash of each aperture; later flashes copy the cached geometry
+ */
+bool macro_flash_create_objs(struct GCODE_state *s, RS274X_Program * gerb, Vector_Outp * vect)
+{
+	const Macro_VM::obj_list_t * local = gerb->getMacroGeometry(s->last_ap);
+	if (!local)
+		return false;
+	
+	Macro_VM::obj_list_t::const_iterator it = local->begin();
+	for (; it != local->end(); it++)
+	{
+		GerbObj * o = translate_macro_obj(*it, s->destination_x, s->destination_y);
+		if (o)
+			add_obj(s, vect, o);
+	}
+	
+	return true;
+}
+
+/*
+ * Outline to draw with a macro aperture: the convex hull of what the
+ * macro renders, at the destination. Circles are sampled around their
+ * edge. A concave macro sweeps out its hull, which is a little more than
+ * the macro itself
+ */
+static GerbObj_Poly * macro_hull_poly(struct GCODE_state *s, RS274X_Program * gerb)
+{
+	const Macro_VM::obj_list_t * local = gerb->getMacroGeometry(s->last_ap);
+	if (!local)
+		return NULL;
+	
+	std::vector<std::pair<coord_t, coord_t> > pts;
+	Macro_VM::obj_list_t::const_iterator it = local->begin();
+	for (; it != local->end(); it++)
+	{
+		const GerbObj_Line * l = dynamic_cast<const GerbObj_Line *>(*it);
+		if (l)
+		{
+			double r = l->width / 2.0;
+			for (int i=0; i < 32; i++)
+			{
+				double t = i * M_PI / 16;
+				coord_t ox = coord_round(r * cos(t)), oy = coord_round(r * sin(t));
+				pts.push_back(std::make_pair(l->sx + ox, l->sy + oy));
+				pts.push_back(std::make_pair(l->ex + ox, l->ey + oy));
+			}
+			continue;
+		}
+		
+		const GerbObj_Poly * p = dynamic_cast<const GerbObj_Poly *>(*it);
+		if (p)
+		{
+			for (GerbObj_Poly::point_iter i = p->pointBegin(); i != p->pointEnd(); ++i)
+				pts.push_back(std::make_pair((*i).x, (*i).y));
+		}
+	}
+	
+	std::sort(pts.begin(), pts.end());
+	pts.erase(std::unique(pts.begin(), pts.end()), pts.end());
+	if (pts.size() < 3)
+		return NULL;
+	
+	// Monotone chain, counterclockwise
+	std::vector<std::pair<coord_t, coord_t> > h(2 * pts.size());
+	unsigned int k = 0;
+	for (int pass=0; pass < 2; pass++)
+	{
+		unsigned int base = k;
+		for (unsigned int n=0; n < pts.size(); n++)
+		{
+			const std::pair<coord_t, coord_t> & c = pts[pass ? pts.size() - 1 - n : n];
+			while (k >= base + 2 &&
+				(double)(h[k-1].first - h[k-2].first) * (double)(c.second - h[k-2].second) -
+				(double)(h[k-1].second - h[k-2].second) * (double)(c.first - h[k-2].first) <= 0)
+				k--;
+			h[k++] = c;
+		}
+		k--;
+	}
+	
+	GerbObj_Poly * out = new GerbObj_Poly();
+	for (unsigned int i=0; i < k; i++)
+	{
+		Point q;
+		q.x = h[i].first + s->destination_x;
+		q.y = h[i].second + s->destination_y;
+		out->addPoint(q);
+	}
+	return out;
+}
+
+GerbObj * aperture_flash_create_poly(struct GCODE_state *s, RS274X_Program * gerb, const struct RS274X_Program::aperture * ap)
 {
 	assert(ap != NULL);
 
@@ -201,7 +427,7 @@ GerbObj * aperture_flash_create_poly(struct GCODE_state *s, const struct RS274X_
 				l->sy = s->destination_y;
 				l->ex = s->destination_x;
 				l->ey = s->destination_y;
-				l->width = ap->circle_p.OD;
+				l->width = um_to_coord(ap->circle_p.OD);
 				l->lt = LT_STRAIGHT;
 				l->lc = GerbObj_Line::LC_ROUND;
 				return l;
@@ -211,12 +437,15 @@ GerbObj * aperture_flash_create_poly(struct GCODE_state *s, const struct RS274X_
 			{
 			
 				GerbObj_Poly * p = new GerbObj_Poly();
+				p->points.reserve(4);
 				
+				double hx = um_to_coord(ap->rect_p.XAD) / 2.0;
+				double hy = um_to_coord(ap->rect_p.YAD) / 2.0;
 				
-				p->addPoint(Point(s->destination_x + ap->rect_p.XAD/2, s->destination_y - ap->rect_p.YAD/2));
-				p->addPoint(Point(s->destination_x + ap->rect_p.XAD/2, s->destination_y + ap->rect_p.YAD/2));
-				p->addPoint(Point(s->destination_x - ap->rect_p.XAD/2, s->destination_y + ap->rect_p.YAD/2));		
-				p->addPoint(Point(s->destination_x - ap->rect_p.XAD/2, s->destination_y - ap->rect_p.YAD/2));	
+				p->addPoint(Point(s->destination_x + hx, s->destination_y - hy));
+				p->addPoint(Point(s->destination_x + hx, s->destination_y + hy));
+				p->addPoint(Point(s->destination_x - hx, s->destination_y + hy));		
+				p->addPoint(Point(s->destination_x - hx, s->destination_y - hy));	
 				return p;
 			}
 			
@@ -227,14 +456,16 @@ GerbObj * aperture_flash_create_poly(struct GCODE_state *s, const struct RS274X_
 				
 				GerbObj_Line * l = new GerbObj_Line();
 				
-				double w = fmin(ap->rect_p.YAD,ap->rect_p.XAD);
-				double xs = ap->rect_p.XAD-w;
-				double ys = ap->rect_p.YAD-w;
+				coord_t xd = um_to_coord(ap->rect_p.XAD);
+				coord_t yd = um_to_coord(ap->rect_p.YAD);
+				coord_t w = xd < yd ? xd : yd;
+				coord_t xs = xd-w;
+				coord_t ys = yd-w;
 				
 				l->sx = s->destination_x - xs/2;
 				l->sy = s->destination_y - ys/2;
-				l->ex = s->destination_x + xs/2;
-				l->ey = s->destination_y + ys/2;
+				l->ex = l->sx + xs;
+				l->ey = l->sy + ys;
 				
 				l->width = w;
 				l->lt = LT_STRAIGHT;
@@ -249,7 +480,7 @@ GerbObj * aperture_flash_create_poly(struct GCODE_state *s, const struct RS274X_
 		case RS274X_Program::AP_POLY:
                 {
                     
-                        double r = ap->poly_p.OD / 2;
+                        double r = um_to_coord(ap->poly_p.OD) / 2.0;
 			int si = (int)ap->poly_p.NS;
                         float t = ap->poly_p.DR / 180.0f * M_PI;
                         
@@ -269,20 +500,25 @@ GerbObj * aperture_flash_create_poly(struct GCODE_state *s, const struct RS274X_
 			return NULL;
 			
 		case RS274X_Program::AP_MACRO:
-			return ap->macro_p.compiled_macro->execute(ap->macro_p.params,s->destination_x, s->destination_y);
+			// Macros can produce several objects, see macro_flash_create_objs
+			return NULL;
 	}
 	
 	return NULL;
 }
 
 
-GerbObj * aperture_slide_create_poly_straight(struct GCODE_state *s, const struct RS274X_Program::aperture * ap)
+GerbObj * aperture_slide_create_poly_straight(struct GCODE_state *s, RS274X_Program * gerb, const struct RS274X_Program::aperture * ap)
 {
 	if (ap->type != RS274X_Program::AP_CIRCLE)
 	{
 		
 		// create the aperture
-		GerbObj_Poly * p = dynamic_cast<GerbObj_Poly *>(aperture_flash_create_poly(s,ap));
+		GerbObj_Poly * p;
+		if (ap->type == RS274X_Program::AP_MACRO)
+			p = macro_hull_poly(s, gerb);
+		else
+			p = dynamic_cast<GerbObj_Poly *>(aperture_flash_create_poly(s,gerb,ap));
 
 		if (!p)
 		{
@@ -290,12 +526,12 @@ GerbObj * aperture_slide_create_poly_straight(struct GCODE_state *s, const struc
 			return NULL;
 		}
 		// Now we rotate the aperture so the slide line is on the x;
-		double sl_vec[2] = {s->current_x - s->destination_x, s->current_y - s->destination_y};
+		double sl_vec[2] = {(double)(s->current_x - s->destination_x), (double)(s->current_y - s->destination_y)};
 
 		double theta = -atan2(sl_vec[1], sl_vec[0]);
 
-		double maxY = -1000000;
-		double minY =  1000000;
+		double maxY = -DBL_MAX;
+		double minY =  DBL_MAX;
 		int maxYi = 0;
 		int minYi = 0;
 		int i=0;
@@ -354,7 +590,7 @@ GerbObj * aperture_slide_create_poly_straight(struct GCODE_state *s, const struc
 		
 		obj->lc = GerbObj_Line::LC_ROUND;
 		obj->lt = LT_STRAIGHT;
-		obj->width = ap->circle_p.OD;
+		obj->width = um_to_coord(ap->circle_p.OD);
 		obj->sx = s->destination_x;
 		obj->sy = s->destination_y;
 		obj->ex = s->current_x;
@@ -364,11 +600,11 @@ GerbObj * aperture_slide_create_poly_straight(struct GCODE_state *s, const struc
 
 }
 
-GerbObj * aperture_slide_create_poly(struct GCODE_state *s, const struct RS274X_Program::aperture * ap)
+GerbObj * aperture_slide_create_poly(struct GCODE_state *s, RS274X_Program * gerb, const struct RS274X_Program::aperture * ap)
 {
 	switch(s->G_op){
 		case 1: 
-		return aperture_slide_create_poly_straight(s,ap);
+		return aperture_slide_create_poly_straight(s,gerb,ap);
 	
 		default:
 		return NULL;
@@ -376,25 +612,38 @@ GerbObj * aperture_slide_create_poly(struct GCODE_state *s, const struct RS274X_
 }
 
 	
-GerbObj * create_poly(struct GCODE_state * s, sp_RS274X_Program gerb)
+/*
+ * Create the object[s] for the current operation and add them to the output.
+ * Returns false if the operation could not be handled
+ */
+bool create_poly(struct GCODE_state * s, const sp_RS274X_Program & gerb, Vector_Outp * vect)
 {
 	assert(s->lm != L_OFF);
 
+	const struct RS274X_Program::aperture * ap = gerb->getAperture(s->last_ap);
+	GerbObj * output_poly = NULL;
 	
 	if (s->lm == L_ON)
 	{
-		return aperture_slide_create_poly(s, gerb->getAperture(s->last_ap));
+		output_poly = aperture_slide_create_poly(s, gerb.get(), ap);
 	}
 
 	if (s->lm == L_FLASH)
 	{
-		return aperture_flash_create_poly(s, gerb->getAperture(s->last_ap));
+		if (ap->type == RS274X_Program::AP_MACRO)
+			return macro_flash_create_objs(s, gerb.get(), vect);
+		
+		output_poly = aperture_flash_create_poly(s, gerb.get(), ap);
 	}
 	
-	return NULL;
+	if (output_poly == NULL)
+		return false;
+	
+	add_obj(s, vect, output_poly);
+	return true;
 }
 
-void createPolysForCurve(struct GCODE_state * s, sp_RS274X_Program gerb, Vector_Outp * vect, bool poly_point) {
+void createPolysForCurve(struct GCODE_state * s, const sp_RS274X_Program & gerb, Vector_Outp * vect, bool poly_point) {
 	
 	double cx;
 	double cy;
@@ -420,7 +669,7 @@ void createPolysForCurve(struct GCODE_state * s, sp_RS274X_Program gerb, Vector_
 		return;
 	}
 	
-	double r = sqrt(s->destination_i*s->destination_i + s->destination_j*s->destination_j);
+	double r = sqrt((double)s->destination_i*s->destination_i + (double)s->destination_j*s->destination_j);
 	
 	// hack for poorly spec'ed I/J coords
 	double r2 = sqrt((s->current_x-cx)*(s->current_x-cx) + (s->current_y-cy)*(s->current_y-cy));
@@ -478,15 +727,15 @@ void createPolysForCurve(struct GCODE_state * s, sp_RS274X_Program gerb, Vector_
 		
 			obj->lc = GerbObj_Line::LC_ROUND;
 			obj->lt = LT_STRAIGHT;
-			obj->width = gerb->getAperture(s->last_ap)->circle_p.OD;
-			obj->sx = destination_x;
-			obj->sy = destination_y;
-			obj->ex = x;
-			obj->ey = y;
+			obj->width = um_to_coord(gerb->getAperture(s->last_ap)->circle_p.OD);
+			obj->sx = coord_round(destination_x);
+			obj->sy = coord_round(destination_y);
+			obj->ex = coord_round(x);
+			obj->ey = coord_round(y);
 		
 			
 	
-			vect->all.push_back(sp_GerbObj(obj));
+			add_obj(s, vect, obj);
 		} else {
 			s->cpoly->addPoint(Point(x, y));
 		}
@@ -498,7 +747,7 @@ void createPolysForCurve(struct GCODE_state * s, sp_RS274X_Program gerb, Vector_
 
 }
 
-bool handle_exec(struct GCODE_state * s, sp_RS274X_Program gerb, Vector_Outp * vect)
+bool handle_exec(struct GCODE_state * s, const sp_RS274X_Program & gerb, Vector_Outp * vect)
 {
 	
 	// Check if we've accumulated any coords since the last exec
@@ -521,19 +770,15 @@ bool handle_exec(struct GCODE_state * s, sp_RS274X_Program gerb, Vector_Outp * v
 				return false;
 			case  1:
 			{
-				if (s->lm != L_OFF)
+				if (s->lm != L_OFF && !s->dry_run)
 				{
 					if (!s->poly_fill)
 					{
-						GerbObj * output_poly = create_poly(s,gerb);
-					
-						if (output_poly != NULL)
+						if (!create_poly(s,gerb,vect))
 						{
-							vect->all.push_back(sp_GerbObj(output_poly));
-						} else {
-					
 							DBG_ERR_PF("Unhandled Move from (%lf,%lf) to (%lf,%lf) ap %d light %s", 
-							 s->current_x, s->current_y, s->destination_x, s->destination_y, s->last_ap,
+							 coord_to_um(s->current_x), coord_to_um(s->current_y), 
+							 coord_to_um(s->destination_x), coord_to_um(s->destination_y), s->last_ap,
 							 s->lm == L_OFF ? "off" : s->lm == L_ON ? "on" : "flash");
 
 							return false;
@@ -558,27 +803,23 @@ bool handle_exec(struct GCODE_state * s, sp_RS274X_Program gerb, Vector_Outp * v
 				
 			case  2:
 			case  3:
-				if (!s->poly_fill)
+				if (!s->dry_run && !s->poly_fill)
 				{	if (s->lm == L_ON)
 						createPolysForCurve(s,gerb,vect, true);
 					else if (s->lm == L_FLASH)
 					{	
-						GerbObj * output_poly = create_poly(s,gerb);
-
-						if (output_poly != NULL)
+						if (!create_poly(s,gerb,vect))
 						{
-								vect->all.push_back(sp_GerbObj(output_poly));
-						} else {
-
 								DBG_ERR_PF("Unhandled Move from (%lf,%lf) to (%lf,%lf) ap %d light %s",
-								 s->current_x, s->current_y, s->destination_x, s->destination_y, s->last_ap,
+								 coord_to_um(s->current_x), coord_to_um(s->current_y), 
+								 coord_to_um(s->destination_x), coord_to_um(s->destination_y), s->last_ap,
 								 s->lm == L_OFF ? "off" : s->lm == L_ON ? "on" : "flash");
 								 GErr * e = new GErr();
 
 								 return false;
 						}
 					}
-				} else {
+				} else if (!s->dry_run) {
 					createPolysForCurve(s,gerb,vect, false);
 				}
 				
@@ -608,76 +849,329 @@ bool handle_exec(struct GCODE_state * s, sp_RS274X_Program gerb, Vector_Outp * v
 	return true;
 }
 
-sp_Vector_Outp gcode_run(sp_RS274X_Program gerb)
+/*
+ * Execute a single operation. Returns false if interpretation has to stop
+ */
+static bool exec_op(struct GCODE_state * s, const struct RS274X_Program::gcode_block & op, const sp_RS274X_Program & gerb, Vector_Outp * vect)
 {
+	switch (op.op)
+	{
+		case RS274X_Program::GCO_G:
+			handle_G_op(s, op, vect);
+			break;
+			
+		case RS274X_Program::GCO_M:
+			return handle_M_op(s, op);
+			
+		case RS274X_Program::GCO_D:
+			return handle_D_op(s, op);
+			
+		case RS274X_Program::GCO_X:
+		case RS274X_Program::GCO_Y:
+		case RS274X_Program::GCO_I:
+		case RS274X_Program::GCO_J:
+			handle_coord(s, op);
+			break;
 
-	Vector_Outp * pt = new Vector_Outp();
-		
-	struct GCODE_state plot_state;
-	bzero(&plot_state, sizeof(GCODE_state));
+		case RS274X_Program::GCO_END:
+			if (!handle_exec(s, gerb, vect))
+			{
+				DBG_ERR_PF("Could not execute gcode block!");
+				return false;
+			}
+			break;
+
+		case RS274X_Program::GCO_DIR:
+			if (op.gdd_data.dir == RS274X_Program::LY_LP)
+				s->clear = op.gdd_data.LP_P.lp == RS274X_Program::LP_C;
+			
+			// Other directives are unhandled
+			break;
+	}
+	return true;
+}
+
+static void init_state(struct GCODE_state * s)
+{
+	bzero(s, sizeof(GCODE_state));
 
-	plot_state.um = UNITMODE_IN;
+	s->um = UNITMODE_IN;
 	
 	// HACK: some gerbers assume we start with AP 10.
-	//plot_state.last_ap = 10;
+	//s->last_ap = 10;
 	// TODO: Determine if this needs to be re-enabled.
 	
 	
 	// Eagle doesn't seem to include this :/
-	plot_state.G_op = 1;
+	s->G_op = 1;
+}
+
+/*
+ * Resumable interpreter
+ */
+
+GCODE_Interp::GCODE_Interp(sp_RS274X_Program gerb) :
+	m_gerb(gerb), m_outp(new Vector_Outp()), m_failed(false), m_finished(false)
+{
+	m_state = new GCODE_state();
+	init_state(m_state);
+	
+	m_ci = gerb->m_operations.begin();
+	m_end = gerb->m_operations.end();
 	
 	DBG_MSG_PF("Starting GCODE Virtual Machine\n");
+}
 
-	RS274X_Program::operations_list_t::const_iterator ci = 
-		gerb->m_operations.begin();
-	
-	RS274X_Program::operations_list_t::const_iterator end = 
-		gerb->m_operations.end();
+GCODE_Interp::GCODE_Interp(sp_RS274X_Program gerb, const struct GCODE_state & start,
+	RS274X_Program::operations_list_t::const_iterator begin,
+	RS274X_Program::operations_list_t::const_iterator end) :
+	m_gerb(gerb), m_outp(new Vector_Outp()), m_ci(begin), m_end(end),
+	m_failed(false), m_finished(true)
+{
+	m_state = new GCODE_state(start);
+	m_state->dry_run = false;
+}
+
+GCODE_Interp::~GCODE_Interp()
+{
+	// Region that was never closed
+	delete m_state->cpoly;
+	delete m_state;
+}
+
+bool GCODE_Interp::isDone() const
+{
+	return m_failed || m_ci == m_end || m_state->done;
+}
+
+bool GCODE_Interp::run(long max_blocks, long max_objs)
+{
+	long blocks = 0;
+	std::list<sp_GerbObj>::size_type start_objs = m_outp->all.size();
 	
-	while (ci != end && (!plot_state.done))
+	while (!isDone())
 	{
-		const struct RS274X_Program::gcode_block & cur_op = *ci;
-		switch (cur_op.op)
+		if (max_blocks >= 0 && blocks >= max_blocks)
+			break;
+		if (max_objs >= 0 && (long)(m_outp->all.size() - start_objs) >= max_objs)
+			break;
+		
+		const struct RS274X_Program::gcode_block & cur_op = *m_ci;
+		if (!exec_op(m_state, cur_op, m_gerb, m_outp.get()))
 		{
-			case RS274X_Program::GCO_G:
-				handle_G_op(&plot_state, cur_op, pt);
-				break;
-				
-			case RS274X_Program::GCO_M:
-				if (!handle_M_op(&plot_state, cur_op))
-					return sp_Vector_Outp();
-				break;
-				
-			case RS274X_Program::GCO_D:
-				if (!handle_D_op(&plot_state, cur_op))
-					return sp_Vector_Outp();
-					
-				break;
-				
-			case RS274X_Program::GCO_X:
-			case RS274X_Program::GCO_Y:
-			case RS274X_Program::GCO_I:
-			case RS274X_Program::GCO_J:
-				handle_coord(&plot_state, cur_op);
-				break;
+			m_failed = true;
+			return false;
+		}
+		
+		if (cur_op.op == RS274X_Program::GCO_END)
+			blocks++;
+		
+		m_ci++;
+	}
+	
+	if (isDone() && !m_finished)
+	{
+		m_finished = true;
+		DBG_MSG_PF("GCODE Virtual Machine Finished\n");
+		DBG_MSG_PF("Macro cache: %ld hits, %ld misses", m_gerb->m_macro_cache_hits, m_gerb->m_macro_cache_misses);
+	}
+	
+	return !m_failed;
+}
 
-			case RS274X_Program::GCO_END:
-				if (!handle_exec(&plot_state, gerb, pt))
-				{
-					DBG_ERR_PF("Could not execute gcode block!");
-					return sp_Vector_Outp();
-				}
-				break;
+GCODE_Interp::obj_batch_t GCODE_Interp::runBatch(long max_blocks, long max_objs)
+{
+	std::list<sp_GerbObj> & all = m_outp->all;
+	
+	// Remember where the output currently ends - everything after it is new
+	bool was_empty = all.empty();
+	std::list<sp_GerbObj>::iterator last = all.end();
+	if (!was_empty)
+		last--;
+	
+	run(max_blocks, max_objs);
+	
+	if (was_empty)
+		return obj_batch_t(all.begin(), all.end());
+	
+	return obj_batch_t(++last, all.end());
+}
+
+GCODE_Interp::obj_batch_t GCODE_Interp::runBlocks(long n)
+{
+	return runBatch(n, -1);
+}
+
+GCODE_Interp::obj_batch_t GCODE_Interp::runUntilObjects(long m)
+{
+	return runBatch(-1, m);
+}
+
+sp_Vector_Outp gcode_run(sp_RS274X_Program gerb)
+{
+	GCODE_Interp interp(gerb);
+	
+	if (!interp.run(-1, -1))
+		return sp_Vector_Outp();
+
+	sp_Vector_Outp outp = interp.getOutput();
+	if (outp->has_clear)
+		compose_polarity(outp.get());
+	
+	return outp;
+}
+
+/*
+ * Parallel interpreter
+ *
+ * The only thing linking one block to the next is the modal state, so the
+ * program is first run through the state machine without creating any
+ * geometry, saving the state every few blocks. Each saved state starts an
+ * independent segment, which the workers interpret into their own output.
+ * The segment outputs are joined in program order, so the result is the
+ * same as gcode_run.
+ *
+ * States are only saved outside of G36/G37 regions, since the region
+ * polygon belongs to a single segment.
+ */
+
+struct GCODE_checkpoint {
+	struct GCODE_state state;
+	RS274X_Program::operations_list_t::const_iterator ci;
+};
 
-			case RS274X_Program::GCO_DIR:;
-				//printf("Directive matching unhandled!\n");
-				//return NULL;
+static bool gcode_checkpoint(sp_RS274X_Program gerb, long interval, std::vector<GCODE_checkpoint> & cps)
+{
+	GCODE_checkpoint cp;
+	init_state(&cp.state);
+	cp.state.dry_run = true;
+	cp.ci = gerb->m_operations.begin();
+	cps.push_back(cp);
+	
+	struct GCODE_state & s = cp.state;
+	long blocks = 0;
+	
+	RS274X_Program::operations_list_t::const_iterator end = gerb->m_operations.end();
+	while (cp.ci != end && !s.done)
+	{
+		const struct RS274X_Program::gcode_block & cur_op = *cp.ci;
+		if (!exec_op(&s, cur_op, gerb, NULL))
+			return false;
+		
+		cp.ci++;
+		
+		if (cur_op.op == RS274X_Program::GCO_END && ++blocks >= interval && !s.poly_fill)
+		{
+			cps.push_back(cp);
+			blocks = 0;
 		}
-		ci++;
 	}
-	DBG_MSG_PF("GCODE Virtual Machine Finished\n");
-
-	return sp_Vector_Outp(pt);
+	
+	return true;
 }
 
+struct gcode_par_job {
+	std::vector<GCODE_Interp *> segs;
+	long next;
+};
 
+static void * gcode_par_worker(void * arg)
+{
+	gcode_par_job * job = (gcode_par_job *)arg;
+	
+	while (1)
+	{
+		long i = __sync_fetch_and_add(&job->next, 1);
+		if (i >= (long)job->segs.size())
+			break;
+		
+		job->segs[i]->run(-1, -1);
+	}
+	return NULL;
+}
+
+sp_Vector_Outp gcode_run_parallel(sp_RS274X_Program gerb, int nthreads, long interval)
+{
+	if (nthreads < 1)
+		nthreads = 1;
+	
+	if (interval <= 0)
+	{
+		// A few segments per thread, so an expensive segment [lots of
+		// arcs or macros] doesn't hold up the others. A block is typically
+		// four or so operations
+		interval = gerb->m_operations.size() / (nthreads * 16);
+		if (interval < 1000)
+			interval = 1000;
+	}
+	
+	DBG_MSG_PF("Starting parallel GCODE Virtual Machine\n");
+	
+	std::vector<GCODE_checkpoint> cps;
+	if (!gcode_checkpoint(gerb, interval, cps))
+	{
+		DBG_ERR_PF("Could not checkpoint gcode program");
+		return sp_Vector_Outp();
+	}
+	
+	// Evaluate every macro now, so the workers only ever read the cache
+	RS274X_Program::aperture_map_t::const_iterator ai = gerb->m_ap_map.begin();
+	for (; ai != gerb->m_ap_map.end(); ai++)
+		if ((*ai).second->type == RS274X_Program::AP_MACRO)
+			gerb->getMacroGeometry((*ai).first);
+	
+	gcode_par_job job;
+	job.next = 0;
+	for (unsigned int i=0; i < cps.size(); i++)
+	{
+		RS274X_Program::operations_list_t::const_iterator end = 
+			i + 1 < cps.size() ? cps[i+1].ci : gerb->m_operations.end();
+		job.segs.push_back(new GCODE_Interp(gerb, cps[i].state, cps[i].ci, end));
+	}
+	
+	// The calling thread is one of the workers
+	std::vector<pthread_t> threads;
+	for (int i=1; i < nthreads && i < (int)job.segs.size(); i++)
+	{
+		pthread_t t;
+		if (pthread_create(&t, NULL, gcode_par_worker, &job) != 0)
+		{
+			DBG_WARN_PF("Could not start interpreter thread");
+			break;
+		}
+		threads.push_back(t);
+	}
+	
+	gcode_par_worker(&job);
+	
+	for (unsigned int i=0; i < threads.size(); i++)
+		pthread_join(threads[i], NULL);
+	
+	sp_Vector_Outp outp(new Vector_Outp());
+	bool failed = false;
+	for (unsigned int i=0; i < job.segs.size(); i++)
+	{
+		GCODE_Interp * seg = job.segs[i];
+		if (seg->hasFailed())
+			failed = true;
+		
+		outp->all.splice(outp->all.end(), seg->getOutput()->all);
+		outp->has_clear |= seg->getOutput()->has_clear;
+		delete seg;
+	}
+	
+	if (failed)
+		return sp_Vector_Outp();
+	
+	// Each segment numbered its objects from 0. Composing polarity
+	// renumbers as it goes
+	if (outp->has_clear)
+		compose_polarity(outp.get());
+	else
+		reindex_vector_outp(outp.get());
+	
+	DBG_MSG_PF("GCODE Virtual Machine Finished: %d segments, %d threads\n", (int)job.segs.size(), (int)threads.size() + 1);
+	DBG_MSG_PF("Macro cache: %ld hits, %ld misses", gerb->m_macro_cache_hits, gerb->m_macro_cache_misses);
+	
+	return outp;
+}
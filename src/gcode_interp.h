@@ -38,6 +38,9 @@
 
 #include "gerber_parse.h"
 #include "gerbobj.h"
+#include "bounds.h"
+#include "grid.h"
+#include "rtree.h"
 
 class net_group;
 class Vector_Outp;
@@ -62,14 +65,155 @@ class GErr {
 };
 
 
+// Structure query_vector_outp searches, see index_vector_outp
+enum layer_index_t { INDEX_SCAN, INDEX_GRID, INDEX_RTREE };
+
 class Vector_Outp {
 public:
+	Vector_Outp() : has_clear(false), index(INDEX_SCAN) {};
+	
 	std::list <sp_GerbObj> all;
-	Part2D<GerbObj*> lines;
+	
+	// Some objects in all are clear polarity, see compose_polarity
+	bool has_clear;
+
+	Part2D<obj_id_t> lines;
+	
+	// Bounds of all, in the same order. Appended to as objects are made;
+	// passes that rewrite all rebuild it
+	BoundsTable bounds;
+	
+	// Grid over bounds, see grid_vector_outp. Empty until built, and
+	// dropped whenever bounds changes
+	UniformGrid grid;
+	
+	// Packed R-tree over bounds, see index_vector_outp. Same lifetime as
+	// grid
+	PackedRTree rtree;
+	
+	// Which of the above query_vector_outp uses
+	enum layer_index_t index;
+	
+	// Layer wide render data, see render_vector_outp. Empty until built
+	RenderLayer render;
+	
+	// Per object render data, built as asked for
+	RenderCache cache;
 };
 
 
 typedef boost::shared_ptr<Vector_Outp> sp_Vector_Outp;
+
+struct GCODE_state;
+
+/*
+ * Resumable RS274X interpreter. Holds the modal state between calls, so a
+ * layer can be interpreted a piece at a time and the objects handed to
+ * later stages [indexing, rendering] as they are produced.
+ *
+ * Each batch call returns only the objects created during that call. The
+ * full output so far is available from getOutput(). Clear polarity objects
+ * are returned as they are, tagged with GerbObj::clear - gcode_run applies
+ * them with compose_polarity once the whole layer is interpreted.
+ */
+class GCODE_Interp {
+public:
+	GCODE_Interp(sp_RS274X_Program gerb);
+	
+	// Interpret only [begin, end), starting from a saved modal state
+	GCODE_Interp(sp_RS274X_Program gerb, const struct GCODE_state & start,
+		RS274X_Program::operations_list_t::const_iterator begin,
+		RS274X_Program::operations_list_t::const_iterator end);
+	~GCODE_Interp();
+	
+	typedef std::list<sp_GerbObj> obj_batch_t;
+	
+	// Interpret up to n blocks [each '*' terminated block counts as one]
+	obj_batch_t runBlocks(long n);
+	
+	// Interpret until at least m new objects exist. A single block may
+	// create several objects [arcs, macros], so the batch can overshoot m
+	obj_batch_t runUntilObjects(long m);
+	
+	// Interpret without collecting a batch. Negative limits mean no limit.
+	// Returns false if the program could not be interpreted
+	bool run(long max_blocks, long max_objs);
+	
+	// End of program reached, or interpretation failed
+	bool isDone() const;
+	bool hasFailed() const {return m_failed;};
+	
+	sp_Vector_Outp getOutput() {return m_outp;};
+	
+private:
+	GCODE_Interp(const GCODE_Interp &);
+	GCODE_Interp & operator=(const GCODE_Interp &);
+	
+	obj_batch_t runBatch(long max_blocks, long max_objs);
+	
+	sp_RS274X_Program m_gerb;
+	sp_Vector_Outp m_outp;
+	struct GCODE_state * m_state;
+	
+	RS274X_Program::operations_list_t::const_iterator m_ci;
+	RS274X_Program::operations_list_t::const_iterator m_end;
+	
+	bool m_failed;
+	bool m_finished;
+};
+
 sp_Vector_Outp gcode_run(sp_RS274X_Program gerb);
+
+// Renumber the objects in list order and rebuild v->bounds. For passes
+// that add, remove or move objects
+void reindex_vector_outp(Vector_Outp * v);
+
+// Pack [or unpack] the outline of every polygon in the layer, see
+// PackedPoints. Returns the bytes the outlines now take
+long pack_vector_outp(Vector_Outp * v, bool pack = true);
+
+// Build v->grid over the layer's bounds. cell <= 0 picks the cell size
+// from the objects
+void grid_vector_outp(Vector_Outp * v, coord_t cell = 0);
+
+// Build the spatial index of the given kind over v->bounds and search it
+// from then on. INDEX_SCAN drops both
+void index_vector_outp(Vector_Outp * v, enum layer_index_t kind);
+
+// Objects of v whose box touches r [closed], as entries of v->bounds in
+// table order, from whichever index was picked
+void query_vector_outp(const Vector_Outp * v, const Rect & r, std::vector<unsigned int> & out);
+
+// Call f(i) for each entry query_vector_outp would return, in no
+// particular order and without allocating
+template <class F> void visit_vector_outp(const Vector_Outp * v, const Rect & r, F & f)
+{
+	switch (v->index)
+	{
+		case INDEX_GRID:
+			v->grid.visit(r, f);
+			break;
+		case INDEX_RTREE:
+			v->rtree.visit(r, f);
+			break;
+		default:
+		{
+			const BoundsTable & t = v->bounds;
+			coord_t qx0 = r.getStartPoint().x, qy0 = r.getStartPoint().y;
+			coord_t qx1 = r.getEndPoint().x, qy1 = r.getEndPoint().y;
+			for (unsigned int i=0; i < t.size(); i++)
+				if (t.minx[i] <= qx1 && t.maxx[i] >= qx0 && t.miny[i] <= qy1 && t.maxy[i] >= qy0)
+					f(i);
+		}
+	}
+}
+
+// Build v->render from every object in the layer, replacing what was there
+void render_vector_outp(Vector_Outp * v);
+
+// Same output as gcode_run, interpreted by nthreads threads. The program is
+// split into segments of about interval blocks [0 picks a size from the
+// program length]
+sp_Vector_Outp gcode_run_parallel(sp_RS274X_Program gerb, int nthreads, long interval);
 #endif
 
@@ -33,6 +33,9 @@
 
 #include "macro_vm.h"
 #include "gerber_parse.h"
+#include "gerbobj.h"
+#include "gerbobj_poly.h"
+#include "simplify.h"
 #include "fileio.h"
 #include "main.h"
 
@@ -125,6 +128,79 @@ void append_gcode_block(RS274X_Program * gerb, const struct RS274X_Program::gcod
 	gerb->m_operations.push_back(blk);
 }
 
+/*****************************************************************************
+ * Aperture table + macro geometry cache
+ *
+ * Macro parameters are fixed by the %AD definition, so the only thing that
+ * changes between flashes is the offset. Evaluate each macro aperture once,
+ * centered on the origin, and let the interpreter translate it.
+ * ***************************************************************************/
+
+RS274X_Program::~RS274X_Program()
+{
+	flushMacroCache();
+}
+
+void RS274X_Program::setAperture(int index, struct aperture * ap)
+{
+	m_ap_map[index] = ap;
+	flushMacroCache();
+}
+
+void RS274X_Program::flushMacroCache()
+{
+	macro_cache_t::iterator i = m_macro_cache.begin();
+	for (; i != m_macro_cache.end(); i++)
+	{
+		Macro_VM::obj_list_t * objs = (*i).second;
+		if (!objs)
+			continue;
+		
+		Macro_VM::obj_list_t::iterator j = objs->begin();
+		for (; j != objs->end(); j++)
+			delete *j;
+		delete objs;
+	}
+	
+	m_macro_cache.clear();
+}
+
+const Macro_VM::obj_list_t * RS274X_Program::getMacroGeometry(int index)
+{
+	// Once the cache is warm this is called from several interpreter
+	// threads at once [gcode_run_parallel], so the counters are atomic
+	macro_cache_t::const_iterator ci = m_macro_cache.find(index);
+	if (ci != m_macro_cache.end())
+	{
+		__sync_fetch_and_add(&m_macro_cache_hits, 1);
+		return (*ci).second;
+	}
+	
+	__sync_fetch_and_add(&m_macro_cache_misses, 1);
+	
+	const struct aperture * ap = getAperture(index);
+	if (ap == NULL || ap->type != AP_MACRO || ap->macro_p.compiled_macro == NULL)
+		return NULL;
+	
+	// Failures are cached as well - they would fail the same way next time
+	Macro_VM::obj_list_t * objs = new Macro_VM::obj_list_t();
+	if (!ap->macro_p.compiled_macro->execute(0, 0, *objs))
+	{
+		delete objs;
+		objs = NULL;
+	} else {
+		// Outlines are stored simplified, every flash copies them
+		for (unsigned int i=0; i < objs->size(); i++)
+		{
+			GerbObj_Poly * p = dynamic_cast<GerbObj_Poly *>((*objs)[i]);
+			if (p)
+				simplify_poly(p, SIMPLIFY_TOL);
+		}
+	}
+	m_macro_cache[index] = objs;
+	return objs;
+}
+
 #define INTPREF(a) ((a)[0] << 8) | ((a)[1])
 #define INTPM(a,b) ((a) << 8) | (b)
 
@@ -408,7 +484,10 @@ bool handle_274X_AD(char * block, RS274X_Program * target)
 		ap = new RS274X_Program::aperture();
 		ap->type = RS274X_Program::AP_MACRO;
 		ap->macro_p.macro_name = strndup(parseptr, typestr_len-1);
-		ap->macro_p.compiled_macro = target->m_macro_name_to_aperture[ap->macro_p.macro_name];
+		ap->macro_p.compiled_macro = NULL;
+		ap->macro_p.num_params = 0;
+		
+		Macro_VM * macro = target->m_macro_name_to_aperture[ap->macro_p.macro_name];
 		
 		parseptr += typestr_len;
 		
@@ -437,14 +516,22 @@ bool handle_274X_AD(char * block, RS274X_Program * target)
 				free_delim_list(arg_list);
 			
 			ap->macro_p.params = args;
+			ap->macro_p.num_params = i;
 		} else {
 			ap->macro_p.params = NULL;
 		}
-		DBG_VERBOSE_PF("Looking up macro %s [%p]",ap->macro_p.macro_name, ap->macro_p.compiled_macro);
+		DBG_VERBOSE_PF("Looking up macro %s [%p]",ap->macro_p.macro_name, macro);
+		
+		// Parameters are fixed from here on, so specialise the macro now
+		if (macro)
+			ap->macro_p.compiled_macro = macro->compile(ap->macro_p.params, ap->macro_p.num_params);
+		
+		if (!ap->macro_p.compiled_macro)
+			DBG_ERR_PF("Could not compile macro %s for aperture %ld", ap->macro_p.macro_name, ap_num);
 	}
 	
 	DBG_VERBOSE_PF("Assigning macro %ld == %p", ap_num, ap);
-	target->m_ap_map[ap_num] = ap;
+	target->setAperture(ap_num, ap);
 
 	return true;	
 }
@@ -1057,7 +1144,9 @@ bool handle_274D_G(int code, RS274X_Program * target)
 }
 
 // Returns the parsed coord [native form - uncorrected for mm / inches]
-bool parse_274D_coord(char ** coord_data_start, double * retval, char axis, struct RS274X_Program::parse_info * pi)
+// The digits are kept as an integer, so nothing is lost before the
+// interpreter converts to the coordinate grid
+bool parse_274D_coord(char ** coord_data_start, struct RS274X_Program::gcode_coord_t * retval, char axis, struct RS274X_Program::parse_info * pi)
 {
 	int lead, trail;
 
@@ -1073,7 +1162,7 @@ bool parse_274D_coord(char ** coord_data_start, double * retval, char axis, stru
 
 	bool parse_finished = false;
 
-	double digit_buf = 0;
+	long long digit_buf = 0;
 	int digit_count = 0;
 	char * coord_data = *coord_data_start;
 	
@@ -1089,9 +1178,14 @@ bool parse_274D_coord(char ** coord_data_start, double * retval, char axis, stru
 
 		if (isdigit(*coord_data))
 		{
+			if (digit_count >= 18)
+			{
+				DBG_ERR_PF("Numeric constant too long");
+				return false;
+			}
 			
 			digit_count++;
-			digit_buf *= 10.0;
+			digit_buf *= 10;
 			digit_buf += *coord_data - '0';
 			
 			hit_numeric = true;
@@ -1124,7 +1218,7 @@ bool parse_274D_coord(char ** coord_data_start, double * retval, char axis, stru
 		
 		while (digit_count < lead+trail)
 		{
-			digit_buf *= 10.0;
+			digit_buf *= 10;
 			digit_count++;
 		}
 	}
@@ -1132,13 +1226,8 @@ bool parse_274D_coord(char ** coord_data_start, double * retval, char axis, stru
 	if (!is_pos)
 		digit_buf *= -1;
 	
-	while (trail > 0)
-	{
-		trail--;
-		digit_buf = digit_buf / 10.0;
-	}
-	
-	*retval = digit_buf;
+	retval->value = digit_buf;
+	retval->frac = trail;
 	*coord_data_start = coord_data;
 	return true;
 }
@@ -1262,7 +1351,7 @@ bool parse_274D_command_word(char ** cur_ptr, char * end_ptr, RS274X_Program * t
 				{
 					char coord_dest = *temp_ptr;
 					temp_ptr++;
-					double rv;
+					struct RS274X_Program::gcode_coord_t rv;
 					if (!parse_274D_coord(&temp_ptr, &rv, 
 							((coord_dest == 'X') || (coord_dest == 'I')) ? 'X' : 'Y',
 						       	&target->m_parse_settings))
@@ -1289,7 +1378,7 @@ bool parse_274D_command_word(char ** cur_ptr, char * end_ptr, RS274X_Program * t
 							break;
 					}	
 	
-					b.dbl_data = rv;
+					b.coord_data = rv;
 					append_gcode_block(target, b);
 					break;
 				}	
@@ -269,6 +269,13 @@ public:
 		};
 	};
 	
+	// A coordinate exactly as written in the file: value * 10^-frac in the
+	// units of the file. The interpreter puts it on the coord_t grid
+	struct gcode_coord_t {
+		long long value;
+		int frac;
+	};
+	
 	enum unit_mode parse_um;
 	struct gcode_block {
 		enum gcode_op_type op;
@@ -276,7 +283,7 @@ public:
 		// No need to store all at once -
 		union {
 			int int_data;
-			double dbl_data;
+			struct gcode_coord_t coord_data;
 			struct gcode_directive_data_t gdd_data;
 		};
 	};
@@ -288,8 +295,8 @@ public:
 	// Maps aperture IDs to aperture objects
 	typedef std::map<int, struct aperture *> aperture_map_t;
 	aperture_map_t		m_ap_map;
-	
-	
+
+
 	const struct aperture * getAperture(int index) const
 	{
 		aperture_map_t::const_iterator ci = m_ap_map.find(index);
@@ -297,7 +304,27 @@ public:
 			return NULL;
 		return (*ci).second;
 	}
-	
+
+	// Define [or redefine] an aperture. Any cached macro geometry is
+	// dropped, since it was evaluated against the old table
+	void setAperture(int index, struct aperture * ap);
+
+	// Geometry of a macro aperture, evaluated once per aperture definition
+	// in aperture-local coordinates [flash point at 0,0]. The caller
+	// translates it to the flash location. Returns NULL if the macro
+	// could not be evaluated
+	const Macro_VM::obj_list_t * getMacroGeometry(int index);
+	void flushMacroCache();
+
+	// Maps aperture IDs to evaluated macro geometry
+	typedef std::map<int, Macro_VM::obj_list_t *> macro_cache_t;
+	macro_cache_t		m_macro_cache;
+	long				m_macro_cache_hits;
+	long				m_macro_cache_misses;
+
+	RS274X_Program() : m_macro_cache_hits(0), m_macro_cache_misses(0) {};
+	~RS274X_Program();
+
 	// Sequential list of operations to be performed by the virtual machine
 	typedef std::list<struct gcode_block> operations_list_t;
 	operations_list_t		m_operations;
@@ -305,6 +332,9 @@ public:
 	
 	std::map<std::string, Macro_VM *>	m_macro_name_to_aperture;
 private:
+	// Owns the cached geometry, so copies would free it twice
+	RS274X_Program(const RS274X_Program &);
+	RS274X_Program & operator=(const RS274X_Program &);
 };
 
 typedef boost::shared_ptr<RS274X_Program> sp_RS274X_Program;
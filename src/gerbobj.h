@@ -42,24 +42,52 @@ enum line_trace_type_t
 class GerbObj {
 public:
 	
-	RenderPoly* getPolyData()
+	/*
+	 * This object's render data. A layer caches render data for its
+	 * objects in Vector_Outp::cache; asked for on its own, an object
+	 * goes through object_render_cache
+	 */
+	sp_RenderPoly getPolyData()
 	{
-		if (!cached)
-			cached = createPolyData();
-		return cached;
+		return object_render_cache().get(this);
+	}
+	
+	// Build the render data afresh, without any cache
+	sp_RenderPoly buildPolyData()
+	{
+		return sp_RenderPoly(createPolyData());
 	}
 	
 	friend void add_to_group(Vector_Outp * f, net_group * n, GerbObj * o);
 	
 	net_group* getOwner() {return owner;};
 	
-
+	// Unique for the life of the process, unlike the object's address
+	unsigned long getSerial() const {return serial;};
+	
+	// Call after changing the object in place. It takes a new serial, so
+	// no cache hands out render data for the old geometry
+	void geometryChanged() {serial = next_serial();};
 	
 	
 	enum flagerr_t flag;
 	
+	// Dense index of the object in its layer's all list [0..n-1], set as
+	// it is added and by reindex_vector_outp. Tables of per object data
+	// [BoundsTable, group ids] are indexed by it. OBJ_ID_NONE until then
+	obj_id_t id;
+	
+	// Clear polarity [%LPC*%]. Erases the dark objects drawn before it,
+	// see compose_polarity
+	bool clear;
+	
 	virtual Rect getBounds()=0;
-	~GerbObj()
+	
+	// Append this object's outline to a layer wide buffer, see
+	// render_vector_outp
+	virtual void appendRenderData(RenderLayer & l);
+	
+	virtual ~GerbObj()
 	{
 	}
 	
@@ -70,15 +98,34 @@ protected:
 	
 	GerbObj()
 	{
-		cached = NULL;
 		owner = NULL;
+		id = OBJ_ID_NONE;
 		flag = FLG_NONE;
+		clear = false;
+		serial = next_serial();
+	}
+	
+	// A copy is a new object as far as caches go
+	GerbObj(const GerbObj & o) : flag(o.flag), id(OBJ_ID_NONE), clear(o.clear), owner(o.owner), serial(next_serial()) {}
+	GerbObj & operator=(const GerbObj & o)
+	{
+		flag = o.flag;
+		clear = o.clear;
+		owner = o.owner;
+		serial = next_serial();
+		return *this;
 	}
 	
 	
 	
 private:
-	RenderPoly * cached;
+	static unsigned long next_serial()
+	{
+		static unsigned long last = 0;
+		return __sync_add_and_fetch(&last, 1);
+	}
+	
+	unsigned long serial;
 };
 
 
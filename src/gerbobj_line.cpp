@@ -25,75 +25,74 @@
 #include "render.h"
 #include "gerbobj_line.h"
 
-struct point_line * alloc_point_line()
-{
-	return (struct point_line *)malloc(sizeof(struct point_line));
-}
-
-
-#define aPL alloc_point_line
-#define sPLp struct point_line *
-
-RenderPoly * createRoundCapPoly(GerbObj_Line * r)
+/*
+ * Outline of a round capped line, appended to segs
+ *
+ * 4 Segments:
+ * [terms for a right pointing line]
+ *
+ * Below_start -> Below_end
+ * Arc Below_end -> Above_end
+ * Above_end -> Above_start
+ * Arc Above_start -> Below_start
+ */
+static void round_cap_segs(const GerbObj_Line * r, render_segs_t & segs)
 {
-	double dx = r->sx - r->ex;
-	double dy = r->sy - r->ey;
+	double sx = coord_to_um(r->sx), sy = coord_to_um(r->sy);
+	double ex = coord_to_um(r->ex), ey = coord_to_um(r->ey);
+	double dx = sx - ex;
+	double dy = sy - ey;
 	double angle;
 
 	angle = atan2(dy, dx);
 
-	double radius = r->width / 2;
+	double radius = coord_to_um(r->width) / 2;
 	
 	double pdx = cos(angle + 3.0 * M_PI / 2.0) * radius;
 	double pdy = sin(angle + 3.0 * M_PI / 2.0) * radius;
 	
-	// 4 Segments:
-	// [terms for a right pointing line]
-	// 
-	// Below_start -> Below_end
-	// Arc Below_end -> Above_end
-	// Above_end -> Above_start
-	// Arc Above_start -> Below_start
-	
-	RenderPoly * obj = new RenderPoly();
-	
-	obj->fillptx = r->sx;
-	obj->fillpty = r->sy;
-	
-	struct point_line * pt;
+	struct point_line pt;
 
 	// Below_start
-	pt = aPL();
-	pt->lt = point_line::LR_STRAIGHT;
-	pt->x = r->ex + pdx;
-	pt->y = r->ey + pdy;
-	obj->segs.push_back(pt);
-	
+	pt.lt = point_line::LR_STRAIGHT;
+	pt.x = ex + pdx;
+	pt.y = ey + pdy;
+	pt.cx = pt.cy = 0;
+	segs.push_back(pt);
 	
 	// Below_end
-	pt = aPL();
-	pt->lt = point_line::LR_ARC;
-	pt->x = r->sx + pdx;
-	pt->y = r->sy + pdy;
-	pt->cx = r->sx;
-	pt->cy = r->sy;
-	obj->segs.push_back(pt);
+	pt.lt = point_line::LR_ARC;
+	pt.x = sx + pdx;
+	pt.y = sy + pdy;
+	pt.cx = sx;
+	pt.cy = sy;
+	segs.push_back(pt);
 
 	// Above_end
-	pt = aPL();
-	pt->lt = point_line::LR_STRAIGHT;
-	pt->x = r->sx - pdx;
-	pt->y = r->sy - pdy;
-	obj->segs.push_back(pt);	
+	pt.lt = point_line::LR_STRAIGHT;
+	pt.x = sx - pdx;
+	pt.y = sy - pdy;
+	pt.cx = pt.cy = 0;
+	segs.push_back(pt);	
 
 	// Above_start
-	pt = aPL();
-	pt->lt = point_line::LR_ARC;
-	pt->x = r->ex - pdx;
-	pt->y = r->ey - pdy;
-	pt->cx = r->ex;
-	pt->cy = r->ey;
-	obj->segs.push_back(pt);
+	pt.lt = point_line::LR_ARC;
+	pt.x = ex - pdx;
+	pt.y = ey - pdy;
+	pt.cx = ex;
+	pt.cy = ey;
+	segs.push_back(pt);
+}
+
+RenderPoly * createRoundCapPoly(GerbObj_Line * r)
+{
+	RenderPoly * obj = new RenderPoly();
+	
+	obj->fillptx = coord_to_um(r->sx);
+	obj->fillpty = coord_to_um(r->sy);
+	
+	obj->segs.reserve(4);
+	round_cap_segs(r, obj->segs);
 	
 	obj->flag = r->flag;
 	/*
@@ -109,6 +108,19 @@ RenderPoly * createRoundCapPoly(GerbObj_Line * r)
 	
 	return obj;
 }
+
+void GerbObj_Line::appendRenderData(RenderLayer & l)
+{
+	struct render_span sp;
+	sp.first = l.segs.size();
+	sp.count = 4;
+	sp.flag = flag;
+	sp.fillptx = coord_to_um(sx);
+	sp.fillpty = coord_to_um(sy);
+	round_cap_segs(this, l.segs);
+	l.polys.push_back(sp);
+}
+
 RenderPoly * GerbObj_Line::createPolyData()
 {
 	
@@ -31,18 +31,21 @@ public:
 	GerbObj_Line() : GerbObj() {};
 	
 	// Start coordinate, [optional center point for arc]
-	double sx,sy,ex,ey,cx,cy;
+	coord_t sx,sy,ex,ey,cx,cy;
 	
-	double width;
+	coord_t width;
 	
 	Rect getBounds()
 	{
+		// Exact for the round capped outline. Clearance searches widen
+		// their query instead [BoundsTable::overlapping_pairs]
 		Rect r = Rect(sx,sy,ex,ey);
-		// TODO: Feather needs to take into account trace spacing if it is to handle drc right
-		r.feather(width);
+		r.feather(width / 2);
 		return r;
 	}
 	
+	void appendRenderData(RenderLayer & l);
+	
 
 	
 	// This enumeration seems unused. Not sure if functionality will be needed later, so keep.
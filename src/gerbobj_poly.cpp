@@ -24,60 +24,152 @@
 
 #include <math.h>
 #include <assert.h>
+#include <algorithm>
 #include "gcode_interp.h"
 #include "render.h"
 
-static struct point_line * alloc_point_line()
-{
-	return (struct point_line *)malloc(sizeof(struct point_line));
-}
-
-	
 bool GerbObj_Poly::is_ccw()
 {
-	if (points.size() == 0)
+	unsigned int n = pointCount();
+	if (n == 0)
 		return false;
-	if (points.size() == 1)
+	if (n == 1)
 		return true;
 
-	i_point_list_t i = points.begin();
+	// Shoelace, walking the outline once so packed polygons aren't expanded
+	point_iter it = pointBegin();
+	Point first = *it, prev = first;
+	double a = 0;
+	for (++it; it != pointEnd(); ++it)
+	{
+		a += (double)prev.x*it->y-(double)it->x*prev.y;
+		prev = *it;
+	}
+	a += (double)prev.x*first.y-(double)first.x*prev.y;
+	return a >= 0;
+}
+
+void GerbObj_Poly::pack()
+{
+	if (points.empty())
+		return;
+	packed.pack(&points[0], points.size());
+	point_list_t().swap(points);
+}
+
+void GerbObj_Poly::unpack()
+{
+	if (packed.empty())
+		return;
+	points.assign(packed.begin(), packed.end());
+	packed.clear();
+}
+
+sp_PolyTraps GerbObj_Poly::getTraps()
+{
+	if (!poly_traps_enabled())
+	{
+		traps.reset();
+		return traps;
+	}
+	if (!traps)
+		traps.reset(new PolyTraps(ring_t(pointBegin(), pointEnd())));
+	return traps;
+}
+
+sp_ConvexParts GerbObj_Poly::getParts()
+{
+	if (parts)
+		return parts;
+	
+	ring_t r(pointBegin(), pointEnd());
+	if (ring_convex(r))
+	{
+		parts.reset(new ConvexParts(r, NULL));
+		return parts;
+	}
+	
+	sp_PolyTraps t = getTraps();
+	if (!t)
+		t.reset(new PolyTraps(r));
+	parts.reset(new ConvexParts(r, t.get()));
+	return parts;
+}
+
+bool GerbObj_Poly::containsPoint(const Point & p)
+{
+	sp_PolyTraps t = getTraps();
+	if (t)
+		return t->contains(p);
 	
-	bool debug = false;
+	// Nonzero winding, as the trapezoids are filled
+	int w = 0;
+	unsigned int n = pointCount();
+	if (n < 3)
+		return false;
+	point_iter it = pointBegin();
+	Point first = *it, a = first;
+	for (unsigned int i=0; i < n; i++)
+	{
+		Point b = i + 1 < n ? *++it : first;
+		coord_t s = side(a, b, p);
+		if (s == 0 && p.x >= std::min(a.x, b.x) && p.x <= std::max(a.x, b.x) &&
+			p.y >= std::min(a.y, b.y) && p.y <= std::max(a.y, b.y))
+			return true;
+		if (a.y <= p.y)
+		{
+			if (b.y > p.y && s > 0)
+				w++;
+		} else if (b.y <= p.y && s < 0) {
+			w--;
+		}
+		a = b;
+	}
+	return w != 0;
+}
 
-	const Point & first_point = *i;
-	Point last_point = first_point;
-	i++;
+double GerbObj_Poly::area()
+{
+	sp_PolyTraps t = getTraps();
+	if (t)
+		return t->area();
 	
+	// Shoelace, right for the simple outlines normalization leaves
+	unsigned int n = pointCount();
+	if (n < 3)
+		return 0;
+	point_iter it = pointBegin();
+	Point first = *it, prev = first;
 	double a = 0;
-	for (;i!=points.end();i++)
+	for (++it; it != pointEnd(); ++it)
 	{
-		const Point & cur_point = *i;
-		double area = last_point.x*cur_point.y-cur_point.x*last_point.y;
-		a += area;
-		last_point = cur_point;
+		a += (double)prev.x*it->y-(double)it->x*prev.y;
+		prev = *it;
 	}
-	a += last_point.x*first_point.y-first_point.x*last_point.y;
-	return a >= 0;
+	a += (double)prev.x*first.y-(double)first.x*prev.y;
+	return fabs(a) / 2;
 }
 
-#define aPL alloc_point_line
-#define sPLp struct point_line *
+// Outline as straight segments, appended to segs
+static void poly_segs(const GerbObj_Poly & p, render_segs_t & segs)
+{
+	struct point_line pt;
+	pt.lt = point_line::LR_STRAIGHT;
+	pt.cx = pt.cy = 0;
+	for (GerbObj_Poly::point_iter i = p.pointBegin(); i != p.pointEnd(); ++i)
+	{
+		pt.x = coord_to_um(i->x);
+		pt.y = coord_to_um(i->y);
+		segs.push_back(pt);
+	}
+}
 
 RenderPoly * GerbObj_Poly::createPolyData()
 {
 	RenderPoly * rp = new RenderPoly();
-	sPLp pt;
 	
-	i_point_list_t it = points.begin();
-	
-	for (;it != points.end();it++)
-	{
-		pt = aPL();
-		pt->lt = point_line::LR_STRAIGHT;
-		pt->x = (*it).x;
-		pt->y = (*it).y;
-		rp->segs.push_back(pt);
-	}
+	rp->segs.reserve(pointCount());
+	poly_segs(*this, rp->segs);
 	
 	rp->flag = flag;
 	
@@ -95,3 +187,14 @@ RenderPoly * GerbObj_Poly::createPolyData()
 	return rp;
 }
 
+void GerbObj_Poly::appendRenderData(RenderLayer & l)
+{
+	struct render_span sp;
+	sp.first = l.segs.size();
+	sp.count = pointCount();
+	sp.flag = flag;
+	sp.fillptx = 0;
+	sp.fillpty = 0;
+	poly_segs(*this, l.segs);
+	l.polys.push_back(sp);
+}
@@ -24,33 +24,99 @@
 #define _GERBOBJ_POLY_H_
 
 #include "gerbobj.h"
-#include <list>
+#include "packed_points.h"
+#include "trapezoid.h"
+#include "convex.h"
+#include <vector>
 
 class GerbObj_Poly : public GerbObj {
 public:
 	
 	GerbObj_Poly() : GerbObj() {cached = false;};
 	
-	typedef std::list<Point> point_list_t;
+	// One contiguous buffer per polygon. Readers that want raw arrays
+	// [InPoly, rendering] can use &points[0]
+	typedef std::vector<Point> point_list_t;
 	typedef point_list_t::iterator i_point_list_t;
 	
+	/*
+	 * The outline, whichever form it is in. Code that only reads it
+	 * should go through these rather than points, which is empty while
+	 * the polygon is packed
+	 */
+	class point_iter {
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef Point value_type;
+		typedef ptrdiff_t difference_type;
+		typedef const Point * pointer;
+		typedef const Point & reference;
+		
+		point_iter(const Point * p) : m_raw(p) {};
+		point_iter(const PackedPoints::const_iterator & i) : m_raw(NULL), m_packed(i) {};
+		
+		const Point & operator*() const {return m_raw ? *m_raw : *m_packed;};
+		const Point * operator->() const {return &**this;};
+		point_iter & operator++() {if (m_raw) m_raw++; else ++m_packed; return *this;};
+		point_iter operator++(int) {point_iter t = *this; ++*this; return t;};
+		bool operator==(const point_iter & o) const {return m_raw ? m_raw == o.m_raw : m_packed == o.m_packed;};
+		bool operator!=(const point_iter & o) const {return !(*this == o);};
+		
+	private:
+		const Point * m_raw;
+		PackedPoints::const_iterator m_packed;
+	};
+	
+	point_iter pointBegin() const {return packed.empty() ? point_iter(points.data()) : point_iter(packed.begin());};
+	point_iter pointEnd() const {return packed.empty() ? point_iter(points.data() + points.size()) : point_iter(packed.end());};
+	unsigned int pointCount() const {return packed.empty() ? points.size() : packed.size();};
+	
+	// Move the outline into / out of the compact form [PackedPoints]
+	void pack();
+	void unpack();
+	bool isPacked() const {return !packed.empty();};
+	long pointBytes() const {return packed.empty() ? points.capacity() * sizeof(Point) : packed.bytes();};
+	
 	void addPoint(Point p)
 	{
+		if (!packed.empty())
+			unpack();
 		points.push_back(p);
+		cached = false;
+		traps.reset();
+		parts.reset();
+		geometryChanged();
 	}
 	
+	// Call after editing points directly, so getBounds, getTraps and
+	// getParts look again
+	void pointsChanged() {cached = false; traps.reset(); parts.reset(); geometryChanged();};
+	
+	/*
+	 * The outline cut into trapezoids, built the first time it's asked
+	 * for and kept until the points change. NULL while turned off
+	 * [set_poly_traps_enabled]. Not safe to call from two threads on the
+	 * same polygon
+	 */
+	sp_PolyTraps getTraps();
+	
+	// The outline in convex pieces [ConvexParts], kept like the trapezoids
+	// but whether or not those are turned off
+	sp_ConvexParts getParts();
+	
+	// Use the trapezoids when there are some, or else scan the outline
+	bool containsPoint(const Point & p);
+	double area();
+	
 	bool is_ccw(void);
+	void appendRenderData(RenderLayer & l);
 	Rect getBounds()
 	{
 		if (!cached)
 		{
 			cached_rect = Rect();
-			i_point_list_t i = points.begin();
-			
-			for (;i!=points.end();i++)
-			{
+			for (point_iter i = pointBegin(); i != pointEnd(); ++i)
 				cached_rect.mergePoint(*i);
-			}
 		}	
 		
 		cached = true;
@@ -63,6 +129,10 @@ public:
 private:	
 	Rect cached_rect;
 	bool cached;
+	
+	PackedPoints packed;
+	sp_PolyTraps traps;
+	sp_ConvexParts parts;
 
 protected:
 	RenderPoly * createPolyData();
@@ -0,0 +1,186 @@
+/*
+ *  Portions Copyright 2006,2009 David Carne and 2007,2008 Spark Fun Electronics
+ *
+ *
+ *  This file is part of gerberDRC.
+ *
+ *  gerberDRC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gerberDRC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <math.h>
+#include <limits.h>
+#include <algorithm>
+
+#include "grid.h"
+#include "gcode_interp.h"
+#include "main.h"
+
+// Entries with a real box [not the inverted one of an empty object]
+static inline bool has_extent(const BoundsTable & t, unsigned int i)
+{
+	return t.minx[i] <= t.maxx[i] && t.miny[i] <= t.maxy[i];
+}
+
+coord_t UniformGrid::tune_cell(const BoundsTable & t)
+{
+	std::vector<coord_t> sides;
+	sides.reserve(t.size());
+	coord_t x0 = LLONG_MAX, y0 = LLONG_MAX, x1 = LLONG_MIN, y1 = LLONG_MIN;
+	for (unsigned int i=0; i < t.size(); i++)
+	{
+		if (!has_extent(t, i))
+			continue;
+		sides.push_back(std::max(t.maxx[i] - t.minx[i], t.maxy[i] - t.miny[i]));
+		x0 = std::min(x0, t.minx[i]);
+		y0 = std::min(y0, t.miny[i]);
+		x1 = std::max(x1, t.maxx[i]);
+		y1 = std::max(y1, t.maxy[i]);
+	}
+	if (sides.empty())
+		return 1;
+	
+	std::nth_element(sides.begin(), sides.begin() + sides.size() / 2, sides.end());
+	double cell = sides[sides.size() / 2];
+	
+	double least = sqrt((double)(x1 - x0) * (double)(y1 - y0) / ((double)GRID_CELLS_PER_OBJ * sides.size()));
+	cell = fmax(cell, least);
+	return std::max((coord_t)ceil(cell), (coord_t)1);
+}
+
+int UniformGrid::cell_x(coord_t x) const
+{
+	if (x <= m_x0)
+		return 0;
+	coord_t c = (x - m_x0) / m_cell;
+	return c >= m_nx ? m_nx - 1 : (int)c;
+}
+
+int UniformGrid::cell_y(coord_t y) const
+{
+	if (y <= m_y0)
+		return 0;
+	coord_t c = (y - m_y0) / m_cell;
+	return c >= m_ny ? m_ny - 1 : (int)c;
+}
+
+/*
+ * Counting sort: one pass to size every cell, a running sum for the
+ * offsets, and a second pass to drop the ids in place
+ */
+void UniformGrid::build(const BoundsTable & t, coord_t cell)
+{
+	clear();
+	m_table = &t;
+	m_cell = cell > 0 ? cell : tune_cell(t);
+	
+	coord_t x1 = LLONG_MIN, y1 = LLONG_MIN;
+	m_x0 = m_y0 = LLONG_MAX;
+	for (unsigned int i=0; i < t.size(); i++)
+	{
+		if (!has_extent(t, i))
+			continue;
+		m_x0 = std::min(m_x0, t.minx[i]);
+		m_y0 = std::min(m_y0, t.miny[i]);
+		x1 = std::max(x1, t.maxx[i]);
+		y1 = std::max(y1, t.maxy[i]);
+	}
+	if (x1 == LLONG_MIN)
+	{
+		m_x0 = m_y0 = 0;
+		m_nx = m_ny = 1;
+		offsets.assign(2, 0);
+		return;
+	}
+	
+	// Very fine cells asked for over a wide extent would take all memory
+	double most = (double)GRID_CELLS_PER_OBJ * 16 * std::max(t.size(), 1024u);
+	while ((double)((x1 - m_x0) / m_cell + 1) * (double)((y1 - m_y0) / m_cell + 1) > most)
+		m_cell *= 2;
+	m_nx = (x1 - m_x0) / m_cell + 1;
+	m_ny = (y1 - m_y0) / m_cell + 1;
+	
+	offsets.assign((long)m_nx * m_ny + 1, 0);
+	std::vector<unsigned char> is_big(t.size(), 0);
+	for (unsigned int i=0; i < t.size(); i++)
+	{
+		if (!has_extent(t, i))
+			continue;
+		int cx0 = cell_x(t.minx[i]), cx1 = cell_x(t.maxx[i]);
+		int cy0 = cell_y(t.miny[i]), cy1 = cell_y(t.maxy[i]);
+		if ((long)(cx1 - cx0 + 1) * (cy1 - cy0 + 1) > GRID_BIG_CELLS)
+		{
+			is_big[i] = 1;
+			big.push_back(i);
+			continue;
+		}
+		for (int y=cy0; y <= cy1; y++)
+			for (int x=cx0; x <= cx1; x++)
+				offsets[(long)y * m_nx + x + 1]++;
+	}
+	for (unsigned long c=1; c < offsets.size(); c++)
+		offsets[c] += offsets[c - 1];
+	
+	ids.resize(offsets.back());
+	std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	for (unsigned int i=0; i < t.size(); i++)
+	{
+		if (!has_extent(t, i) || is_big[i])
+			continue;
+		int cx0 = cell_x(t.minx[i]), cx1 = cell_x(t.maxx[i]);
+		int cy0 = cell_y(t.miny[i]), cy1 = cell_y(t.maxy[i]);
+		for (int y=cy0; y <= cy1; y++)
+			for (int x=cx0; x <= cx1; x++)
+				ids[fill[(long)y * m_nx + x]++] = i;
+	}
+	
+	DBG_MSG_PF("Grid: %u objects, %d x %d cells of %.3fum, %ld entries, %ld kept aside",
+		t.size(), m_nx, m_ny, coord_to_um(m_cell), (long)ids.size(), (long)big.size());
+}
+
+void UniformGrid::clear()
+{
+	m_table = NULL;
+	m_cell = 0;
+	m_nx = m_ny = 0;
+	std::vector<unsigned int>().swap(offsets);
+	std::vector<unsigned int>().swap(ids);
+	std::vector<unsigned int>().swap(big);
+}
+
+// Collects what a visit reports
+struct grid_collect {
+	std::vector<unsigned int> * out;
+	void operator()(unsigned int i) {out->push_back(i);};
+};
+
+void UniformGrid::query(const Rect & r, std::vector<unsigned int> & out) const
+{
+	out.clear();
+	struct grid_collect c = {&out};
+	visit(r, c);
+	std::sort(out.begin(), out.end());
+}
+
+long UniformGrid::bytes() const
+{
+	return sizeof(*this) + (offsets.capacity() + ids.capacity() + big.capacity()) * sizeof(unsigned int);
+}
+
+void grid_vector_outp(Vector_Outp * v, coord_t cell)
+{
+	v->rtree.clear();
+	v->grid.build(v->bounds, cell);
+	v->index = INDEX_GRID;
+}
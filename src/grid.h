@@ -0,0 +1,133 @@
+/*
+ *  Portions Copyright 2006,2009 David Carne and 2007,2008 Spark Fun Electronics
+ *
+ *
+ *  This file is part of gerberDRC.
+ *
+ *  gerberDRC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gerberDRC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef _GRID_H_
+#define _GRID_H_
+
+#include <vector>
+#include <algorithm>
+
+#include "util_type.h"
+#include "bounds.h"
+
+// Objects covering more cells than this are kept aside and checked on
+// every query, rather than filling the grid
+#define GRID_BIG_CELLS 256
+
+// Auto-tuned grids have no more than this many cells per object
+#define GRID_CELLS_PER_OBJ 4
+
+/*
+ * Uniform grid over the boxes of a BoundsTable, built in one go. Cell
+ * (ix, iy) is number iy * nx + ix, so no two cells share a key, and the
+ * cells are stored flat: cell c holds ids[offsets[c], offsets[c+1]).
+ *
+ * An object in several cells is reported from one of them only [visit],
+ * so nothing has to be deduplicated.
+ *
+ * The grid refers to the table it was built from, which has to stay
+ * unchanged; a copy of the grid starts out empty.
+ */
+class UniformGrid {
+public:
+	UniformGrid() : m_table(NULL), m_cell(0), m_x0(0), m_y0(0), m_nx(0), m_ny(0) {};
+	UniformGrid(const UniformGrid &) : m_table(NULL), m_cell(0), m_x0(0), m_y0(0), m_nx(0), m_ny(0) {};
+	UniformGrid & operator=(const UniformGrid &) {clear(); return *this;};
+	
+	// cell <= 0 picks one from the sizes of the objects [tune_cell]
+	void build(const BoundsTable & t, coord_t cell = 0);
+	void clear();
+	bool built() const {return m_table != NULL;};
+	
+	// Entries whose box touches r [closed], in table order
+	void query(const Rect & r, std::vector<unsigned int> & out) const;
+	
+	// Call f(i) once for each entry query would return, in no particular
+	// order and without allocating
+	template <class F> void visit(const Rect & r, F & f) const;
+	
+	coord_t cellSize() const {return m_cell;};
+	long cells() const {return (long)m_nx * m_ny;};
+	long entries() const {return ids.size();};
+	long bigCount() const {return big.size();};
+	long bytes() const;
+	
+	/*
+	 * The median of the larger side of the boxes, so a typical object
+	 * sits in one to four cells. Raised if that would make more than
+	 * GRID_CELLS_PER_OBJ cells per object over the extent
+	 */
+	static coord_t tune_cell(const BoundsTable & t);
+	
+	std::vector<unsigned int> offsets;
+	std::vector<unsigned int> ids;
+	std::vector<unsigned int> big;
+	
+private:
+	int cell_x(coord_t x) const;
+	int cell_y(coord_t y) const;
+	
+	const BoundsTable * m_table;
+	coord_t m_cell;
+	coord_t m_x0, m_y0;
+	int m_nx, m_ny;
+};
+
+/*
+ * An object in several cells is only reported from the cell holding the
+ * lower left corner of its overlap with the query
+ */
+template <class F> void UniformGrid::visit(const Rect & r, F & f) const
+{
+	if (!m_table || !r.isSet())
+		return;
+	const BoundsTable & t = *m_table;
+	
+	coord_t qx0 = r.getStartPoint().x, qy0 = r.getStartPoint().y;
+	coord_t qx1 = r.getEndPoint().x, qy1 = r.getEndPoint().y;
+	
+	int cx0 = cell_x(qx0), cx1 = cell_x(qx1);
+	int cy0 = cell_y(qy0), cy1 = cell_y(qy1);
+	for (int y=cy0; y <= cy1; y++)
+		for (int x=cx0; x <= cx1; x++)
+		{
+			long c = (long)y * m_nx + x;
+			for (unsigned int k=offsets[c]; k < offsets[c+1]; k++)
+			{
+				unsigned int i = ids[k];
+				if (t.minx[i] > qx1 || t.maxx[i] < qx0 || t.miny[i] > qy1 || t.maxy[i] < qy0)
+					continue;
+				if (cell_x(std::max(t.minx[i], qx0)) != x || cell_y(std::max(t.miny[i], qy0)) != y)
+					continue;
+				f(i);
+			}
+		}
+	
+	for (unsigned int k=0; k < big.size(); k++)
+	{
+		unsigned int i = big[k];
+		if (t.minx[i] <= qx1 && t.maxx[i] >= qx0 && t.miny[i] <= qy1 && t.maxy[i] >= qy0)
+			f(i);
+	}
+}
+
+#endif
@@ -26,6 +26,7 @@
 #include "polymath.h"
 
 #include "groupize.h"
+#include "convex.h"
 #include "partitioning.h"
 
 #include <deque>
@@ -45,77 +46,13 @@ double pointPointDistance(double x, double y, double u, double v)
 	return sqrt(a*a+b*b);
 }
 
-bool point_in_poly(const Point & a, GerbObj_Poly * p);
-
-float naive_poly_comparison(GerbObj_Poly * a, GerbObj_Poly * b)
-{
-	if (!a->getBounds().intersectsWith(b->getBounds()))
-		return INFINITY;
-	
-	GerbObj_Poly::i_point_list_t it = a->points.begin();
-	for (; it!=a->points.end();it++)
-		if (point_in_poly(*it, b))
-			return 0;
-		
-	GerbObj_Poly::i_point_list_t itb = b->points.begin();
-	for (; itb!=b->points.end();itb++)
-		if (point_in_poly(*itb, a))
-			return 0;
-
-	return INFINITY;
-}
-
-
-#define DIM     2               /* Dimension of points */
-typedef double  tPointd[DIM];   /* type double point */
-typedef tPointd * tPolygond;/* type double polygon */
-char	InPoly( tPointd q, tPolygond P, int n );
-
-Vector_Outp * tmp;
-bool point_in_poly(const Point & a, GerbObj_Poly * p)
-{
-	if (!p->getBounds().pointInRectClosed(a))
-		return false;
-
-	tPolygond p_n = new tPointd[p->points.size()];
-	
-	GerbObj_Poly::i_point_list_t it = p->points.begin();
-	int i=0;
-	float lx;
-	float ly;
-	for (; it!=p->points.end(); it++)
-	{
-		p_n[i][0] = (*it).x;
-		p_n[i][1] = (*it).y;
-		i++;
-		lx = (*it).x;
-		ly = (*it).y;
-	}
-	
-	tPointd c;
-	c[0] = a.x;
-	c[1] = a.y;
-	
-	char pointstat = InPoly(c, p_n, p->points.size());
-	delete p_n;
-
-	if (pointstat != 'o')
-		return true;
-
-	return false;
-}
-
+/*
+ * Exact, by convex pieces [obj_gap]. Testing each polygon's vertices
+ * against the other missed shapes that only cross at their edges
+ */
 float distanceBetween(GerbObj * a, GerbObj * b)
 {
-	GerbObj_Poly * p_a = dynamic_cast<GerbObj_Poly*>(a);
-	GerbObj_Poly * p_b = dynamic_cast<GerbObj_Poly*>(b);
-	
-	
-	if (p_a && p_b)
-		return naive_poly_comparison(p_a , p_b);
-
-	printf("Cannot handle Line comparisons anymore - convert to polys first!\n");
-	return INFINITY;
+	return obj_gap(a, b);
 }
 
 GH_vertex * createGHForGerbObj_Poly(GerbObj_Poly * p)
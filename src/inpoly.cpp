@@ -33,6 +33,7 @@ not removed.
 */
 #include	<stdio.h>
 #include	<math.h>
+#include	"util_type.h"
 #define	X	0
 #define	Y	1
 
@@ -118,3 +119,38 @@ char InPoly( tPointd q, tPolygond P, int n )
 }
 
 
+
+/*
+InPoly on a GerbObj_Poly's vertex buffer, read in place. Same results as
+above; the shift to q is done per vertex so the polygon is left alone.
+*/
+char InPolyPts( const Point & q, const Point * P, int n )
+{
+  int	 i, i1;
+  double x;
+  int	 Rcross = 0;
+  int    Lcross = 0;
+
+  for( i = 0; i < n; i++ ) {
+    double px = (double)(P[i].x - q.x), py = (double)(P[i].y - q.y);
+    if ( px==0 && py==0 ) return 'v';
+    i1 = ( i + n - 1 ) % n;
+    double p1x = (double)(P[i1].x - q.x), p1y = (double)(P[i1].y - q.y);
+
+    if( ( py > 0 ) != ( p1y > 0 ) ) {
+      x = (px * p1y - p1x * py) / (p1y - py);
+      if (x > 0) Rcross++;
+    }
+
+    if ( ( py < 0 ) != ( p1y < 0 ) ) {
+      x = (px * p1y - p1x * py) / (p1y - py);
+      if (x < 0) Lcross++;
+    }
+  }
+
+  if( ( Rcross % 2 ) != (Lcross % 2 ) )
+    return 'e';
+  if( (Rcross % 2) == 1 )
+    return 'i';
+  return 'o';
+}
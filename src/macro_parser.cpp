@@ -146,11 +146,11 @@ int strtol_b(std::vector<char>::iterator start, std::vector<char>::iterator end)
 }
 
 /*
- * Convert a string to a float given a start and end iterator
+ * Convert a string to a double given a start and end iterator
  */
-float strtof_b(std::vector<char>::iterator start, std::vector<char>::iterator end)
+double strtod_b(std::vector<char>::iterator start, std::vector<char>::iterator end)
 {
-		return strtof(std::string(start,end).c_str(),NULL);
+		return strtod(std::string(start,end).c_str(),NULL);
 }
 
 /* 
@@ -215,7 +215,7 @@ void eval_expression(iter_t const& i, Macro_VM * vm)
 		vm->addInstr(OP_FETCH,0,strtol_b(i->value.begin(), i->value.end()));
 	} else if (i->value.id() == macroblock::valueID) {
 		// constants are just a PUSH, float value being the value of the constant
-		vm->addInstr(OP_PUSH,strtof_b(i->value.begin(), i->value.end()),0);
+		vm->addInstr(OP_PUSH,strtod_b(i->value.begin(), i->value.end()),0);
 	} else {
 		// No code required for any other tokens
 	}
@@ -19,110 +19,601 @@
  *
  */
 
+#include <assert.h>
+
 #include "gcode_interp.h"
 #include "macro_vm.h"
+#include "main.h"
 #include "math.h"
 
+#include "gerbobj_line.h"
 #include "gerbobj_poly.h"
+#include "ring.h"
+
+// Macro parameters are in file units, geometry is on the coord_t grid
+double Macro_VM::convert_unit(double v)
+{
+	if (m_um == UNITMODE_IN) return v * (25400.0 * COORD_PER_UM);
+	return v * (1000.0 * COORD_PER_UM);
+}
+
+// Number of segments used for a curved primitive edge spanning theta
+// radians. Matches the arc tessellation of the interpreter
+static int arc_steps(double theta)
+{
+	int steps = (int)(20 * fabs(theta));
+	if (steps < 2)
+		steps = 2;
+	return steps;
+}
+
+/* Map a macro-local point to layer coordinates: rotate about the macro
+ * origin by rot [radians], convert units and offset to the flash location */
+Point Macro_VM::place(double px, double py, double rot, double x, double y)
+{
+	double c = cos(rot);
+	double s = sin(rot);
+	return Point(convert_unit(px * c - py * s) + x, convert_unit(px * s + py * c) + y);
+}
+
+/* Circles are emitted as zero length round lines, the same representation
+ * as a flashed circular aperture. Bounds and distances stay exact */
+GerbObj * Macro_VM::createCircle(double xc, double yc, double diam, double rot, double x, double y)
+{
+	Point c = place(xc, yc, rot, x, y);
+	
+	GerbObj_Line * l = new GerbObj_Line();
+	l->sx = l->ex = c.x;
+	l->sy = l->ey = c.y;
+	l->width = coord_round(convert_unit(diam));
+	l->lt = LT_STRAIGHT;
+	l->lc = GerbObj_Line::LC_ROUND;
+	return l;
+}
 
-float Macro_VM::convert_unit(float v)
+/* A w by h rectangle centered on xc,yc, turned by angle about its own
+ * center and then by rot about the macro origin */
+GerbObj_Poly * Macro_VM::createRect(double xc, double yc, double w, double h, double angle, double rot, double x, double y)
 {
-	if (m_um == UNITMODE_IN) return v * 25400;
-	return v * 1000;
+	double c = cos(angle);
+	double s = sin(angle);
+	
+	double dx[4] = { w/2,  w/2, -w/2, -w/2 };
+	double dy[4] = { h/2, -h/2, -h/2,  h/2 };
+	
+	GerbObj_Poly * p = new GerbObj_Poly();
+	for (int i=0; i<4; i++)
+		p->addPoint(place(xc + dx[i] * c - dy[i] * s, yc + dx[i] * s + dy[i] * c, rot, x, y));
+	return p;
+}
+
+/* Append an arc of radius r about xc,yc running from a0 to a1 [radians, 
+ * either direction] to p. Both endpoints are included */
+void Macro_VM::addArc(GerbObj_Poly * p, double xc, double yc, double r, double a0, double a1, double rot, double x, double y)
+{
+	int steps = arc_steps(a1 - a0);
+	double step = (a1 - a0) / steps;
+	
+	for (int i=0; i<=steps; i++)
+	{
+		double theta = a0 + step * i;
+		p->addPoint(place(xc + cos(theta) * r, yc + sin(theta) * r, rot, x, y));
+	}
+}
+
+/* Circle primitive
+ * Args are exposure, diameter, center x, center y [, rotation] */
+bool Macro_VM::renderPrim1(obj_list_t & out, const double * a, int argc, double x, double y)
+{
+	if (argc < 4)
+	{
+		return false;
+	}
+	
+	double rot = argc > 4 ? a[4] / 180.0 * M_PI : 0;
+	
+	out.push_back(createCircle(a[2], a[3], a[1], rot, x, y));
+	return true;
 }
 
 /* Render a n-gon primitive
- * p: destination polygon
+ * out: destination object list
+ * a: primitive arguments, argc of them
  * x,y: head location at macro invocation
  *
  */
-bool Macro_VM::renderPrim5(GerbObj_Poly * p, float x, float y)
+bool Macro_VM::renderPrim5(obj_list_t & out, const double * a, int argc, double x, double y)
 {
-	if (mem_stack.size() < 6)
+	if (argc < 6)
 	{
 		return false;
 	}
-	float rot = mem_stack.top(); mem_stack.pop();
-	float diam = mem_stack.top(); mem_stack.pop();
-	float yc = mem_stack.top(); mem_stack.pop();
-	float xc = mem_stack.top(); mem_stack.pop();
-	int verts = (int)mem_stack.top(); mem_stack.pop();
-	int exposure = (int)mem_stack.top(); mem_stack.pop();
+	int verts = (int)a[1];
+	double xc = a[2];
+	double yc = a[3];
+	double diam = a[4];
+	double rot = a[5];
 
 	diam/=2;
 	rot /= 180.0;
 	rot *= M_PI;
-	float thetaStep = 2*M_PI/verts;
+	double thetaStep = 2*M_PI/verts;
+	
+	GerbObj_Poly * p = new GerbObj_Poly();
 	for (int i=0; i< verts; i++)
 	{
-		float theta = i*thetaStep+rot;
+		double theta = i*thetaStep+rot;
 		p->addPoint(Point(convert_unit(cos(theta)*diam+xc)+x, convert_unit(sin(theta)*diam+yc)+y));
 	}
+	out.push_back(p);
 	return true;
 }
 
-/* Render an outline primitive [aka, polygon defined by points] */
-bool Macro_VM::renderPrim4(GerbObj_Poly * p, float x, float y)
+/* Render an outline primitive [aka, polygon defined by points]
+ * Args are exposure, point count, the points, then rotation about the origin */
+bool Macro_VM::renderPrim4(obj_list_t & out, const double * a, int argc, double x, double y)
 {
-	if (mem_stack.size() < 2)
+	if (argc < 3)
 	{
 		return false;
 	}
 
-	float rot = mem_stack.top(); mem_stack.pop();
+	double rot = a[argc-1] / 180.0 * M_PI;
+	
+	GerbObj_Poly * p = new GerbObj_Poly();
+	for (int i=2; i+1 < argc-1; i+=2)
+		p->addPoint(place(a[i], a[i+1], rot, x, y));
+	
+	out.push_back(p);
+	return true;
+}
 
-	while (mem_stack.size() > 2)
+/* Moire primitive
+ * Args are center x, center y, outer diameter, ring thickness, ring gap,
+ * max rings, crosshair thickness, crosshair length, rotation */
+bool Macro_VM::renderPrim6(obj_list_t & out, const double * a, int argc, double x, double y)
+{
+	if (argc < 9)
 	{
-		float ay = mem_stack.top(); mem_stack.pop();
-		float ax = mem_stack.top(); mem_stack.pop();
+		return false;
+	}
+	
+	double xc = a[0];
+	double yc = a[1];
+	double thick = a[3];
+	double gap = a[4];
+	int rings = (int)a[5];
+	double rot = a[8] / 180.0 * M_PI;
+	
+	for (int i=0; i<rings; i++)
+	{
+		double ro = a[2]/2 - i * (thick + gap);
+		double ri = ro - thick;
+		
+		if (ro <= 0)
+			break;
+		
+		// The innermost ring may close up into a plain disc
+		if (ri <= 0)
+		{
+			out.push_back(createCircle(xc, yc, ro * 2, rot, x, y));
+			break;
+		}
+		
+		// Keyholed ring - outer edge one way, inner edge back
+		GerbObj_Poly * p = new GerbObj_Poly();
+		addArc(p, xc, yc, ro, 0, 2*M_PI, rot, x, y);
+		addArc(p, xc, yc, ri, 2*M_PI, 0, rot, x, y);
+		out.push_back(p);
+	}
+	
+	// Crosshairs
+	if (a[6] > 0 && a[7] > 0)
+	{
+		out.push_back(createRect(xc, yc, a[7], a[6], 0, rot, x, y));
+		out.push_back(createRect(xc, yc, a[6], a[7], 0, rot, x, y));
+	}
+	return true;
+}
 
-		p->addPoint(Point(convert_unit(ax)+x, convert_unit(ay)+y));
+/* Thermal primitive - a ring broken by a cross shaped gap. Emitted as the
+ * four remaining ring quadrants
+ * Args are center x, center y, outer diameter, inner diameter, gap
+ * thickness, rotation */
+bool Macro_VM::renderPrim7(obj_list_t & out, const double * a, int argc, double x, double y)
+{
+	if (argc < 6)
+	{
+		return false;
+	}
+	
+	double xc = a[0];
+	double yc = a[1];
+	double ro = a[2] / 2;
+	double ri = a[3] / 2;
+	double g = a[4] / 2;
+	double rot = a[5] / 180.0 * M_PI;
+	
+	// Gap swallows the whole ring. Past ro / sqrt(2) the two gap edges
+	// meet before they reach the outer circle, so nothing is left
+	if (ro <= ri || g * M_SQRT2 >= ro)
+		return true;
+	
+	double ao = asin(g / ro);
+	
+	for (int q=0; q<4; q++)
+	{
+		double base = q * M_PI / 2;
+		GerbObj_Poly * p = new GerbObj_Poly();
+		
+		addArc(p, xc, yc, ro, base + ao, base + M_PI/2 - ao, rot, x, y);
+		
+		if (g < ri)
+		{
+			double ai = asin(g / ri);
+			addArc(p, xc, yc, ri, base + M_PI/2 - ai, base + ai, rot, x, y);
+		} else {
+			// Gap is wider than the hole - the inner edge is the gap corner
+			double t = base + M_PI/4;
+			p->addPoint(place(xc + cos(t) * g * M_SQRT2, yc + sin(t) * g * M_SQRT2, rot, x, y));
+		}
+		out.push_back(p);
 	}
-	while (mem_stack.size() > 0)
+	return true;
+}
+
+/* Vector line - square ended line between two points
+ * Args are exposure, width, start x, start y, end x, end y, rotation */
+bool Macro_VM::renderPrim20(obj_list_t & out, const double * a, int argc, double x, double y)
+{
+	if (argc < 7)
 	{
-		mem_stack.pop();
+		return false;
 	}
-	// last two are exp + verts
+	
+	double dx = a[4] - a[2];
+	double dy = a[5] - a[3];
+	double rot = a[6] / 180.0 * M_PI;
+	
+	out.push_back(createRect((a[2] + a[4]) / 2, (a[3] + a[5]) / 2, 
+		sqrt(dx*dx + dy*dy), a[1], atan2(dy, dx), rot, x, y));
 	return true;
 }
 
 // Render a line defined by width, height and center point
-bool Macro_VM::renderPrim21(GerbObj_Poly * p, float x, float y)
+bool Macro_VM::renderPrim21(obj_list_t & out, const double * a, int argc, double x, double y)
 {
-	if (mem_stack.size() < 6)
+	if (argc < 6)
 	{
 		return false;
 	}
 
-	float rot = mem_stack.top(); mem_stack.pop();
-	float yc = mem_stack.top(); mem_stack.pop();
-	float xc = mem_stack.top(); mem_stack.pop();
-	float yh = mem_stack.top(); mem_stack.pop();
-	float xh = mem_stack.top(); mem_stack.pop();
-	int exposure = (int)mem_stack.top(); mem_stack.pop();
+	double rot = a[5] / 180.0 * M_PI;
+	
+	out.push_back(createRect(a[3], a[4], a[1], a[2], 0, rot, x, y));
+	return true;
+}
 
-	rot = rot/180.0 * M_PI;
+// Render a line defined by width, height and lower left point
+bool Macro_VM::renderPrim22(obj_list_t & out, const double * a, int argc, double x, double y)
+{
+	if (argc < 6)
+	{
+		return false;
+	}
 
-	float t = atan(yh / xh);
-	float r = sqrt(xh*xh / 4 + yh*yh / 4);
+	double rot = a[5] / 180.0 * M_PI;
+	
+	out.push_back(createRect(a[3] + a[1]/2, a[4] + a[2]/2, a[1], a[2], 0, rot, x, y));
+	return true;
+}
 
-	p->addPoint(Point(convert_unit(cos(rot + t)*r)+x, convert_unit(sin(rot + t)*r+y)));
-	p->addPoint(Point(convert_unit(cos(rot - t)*r)+x, convert_unit(sin(rot - t)*r+y)));
+// Outline of a macro object. Circles [zero length round lines] are
+// traced with the arc step count
+static void macro_obj_ring(GerbObj * o, ring_t & r)
+{
+	r.clear();
+	
+	GerbObj_Poly * p = dynamic_cast<GerbObj_Poly *>(o);
+	if (p)
+	{
+		r.assign(p->pointBegin(), p->pointEnd());
+		return;
+	}
+	
+	GerbObj_Line * l = dynamic_cast<GerbObj_Line *>(o);
+	if (l)
+	{
+		int steps = arc_steps(2 * M_PI);
+		double rad = l->width / 2;
+		for (int i=0; i<steps; i++)
+		{
+			double theta = 2 * M_PI * i / steps;
+			r.push_back(Point(l->sx + cos(theta) * rad, l->sy + sin(theta) * rad));
+		}
+	}
+}
+
+static GerbObj_Poly * ring_poly(const ring_t & r)
+{
+	GerbObj_Poly * p = new GerbObj_Poly();
+	for (unsigned int i=0; i<r.size(); i++)
+		p->addPoint(r[i]);
+	return p;
+}
 
-	p->addPoint(Point(convert_unit(cos(rot + t + M_PI)*r)+x, convert_unit(sin(rot + t + M_PI)*r)+y));
-	p->addPoint(Point(convert_unit(cos(rot - t + M_PI)*r)+x, convert_unit(sin(rot - t + M_PI)*r)+y));
-	// last two are exp + verts
+// Cut c out of every ring in pieces. Returns false if it touched none
+static bool cut_pieces(ring_list_t & pieces, const struct ring_cutter & c)
+{
+	bool cut = false;
+	ring_list_t next;
+	for (unsigned int i=0; i<pieces.size(); i++)
+	{
+		if (ring_subtract(pieces[i], c, next) == RING_CUT_NONE)
+			next.push_back(pieces[i]);
+		else
+			cut = true;
+	}
+	pieces.swap(next);
+	return cut;
+}
+
+/*
+ * Apply the exposure of the primitive whose objects start at out[prim].
+ * On [1] draws it as it is. Off [0] cuts it out of the primitives drawn
+ * before it, and toggle [2] does the same and then draws what is left of
+ * it outside of them.
+ *
+ * Only the objects of this macro [from out[first]] are cut, and what is
+ * left of them goes back as polygons, so the macro always comes out
+ * dark. A flash of it can then be moved into place under either
+ * polarity.
+ */
+void Macro_VM::applyExposure(obj_list_t & out, obj_list_t::size_type first, obj_list_t::size_type prim, int exposure)
+{
+	if (exposure == 1)
+		return;
+	
+	std::vector<struct ring_cutter> cuts(out.size() - prim);
+	ring_list_t fresh;
+	for (obj_list_t::size_type i = prim; i < out.size(); i++)
+	{
+		struct ring_cutter & c = cuts[i - prim];
+		macro_obj_ring(out[i], c.ring);
+		delete out[i];
+		
+		ring_clean(c.ring);
+		if (c.ring.size() < 3)
+		{
+			c.ring.clear();
+			continue;
+		}
+		ring_cutter_prepare(c);
+		if (exposure == 2)
+			fresh.push_back(c.ring);
+	}
+	out.resize(prim);
+	
+	obj_list_t kept;
+	for (obj_list_t::size_type i = first; i < prim; i++)
+	{
+		Rect b = out[i]->getBounds();
+		struct ring_cutter under;
+		ring_list_t pieces;
+		bool cut = false;
+		
+		for (unsigned int k=0; k<cuts.size(); k++)
+		{
+			if (cuts[k].ring.empty() || !b.intersectsWith(cuts[k].bounds))
+				continue;
+			
+			if (under.ring.empty())
+			{
+				macro_obj_ring(out[i], under.ring);
+				ring_clean(under.ring);
+				if (under.ring.size() < 3)
+					break;
+				pieces.push_back(under.ring);
+			}
+			if (cut_pieces(pieces, cuts[k]))
+				cut = true;
+		}
+		
+		// Toggled primitives are off where this object was drawn
+		if (exposure == 2 && under.ring.size() >= 3)
+		{
+			ring_cutter_prepare(under);
+			cut_pieces(fresh, under);
+		}
+		
+		if (!cut)
+		{
+			kept.push_back(out[i]);
+			continue;
+		}
+		
+		delete out[i];
+		for (unsigned int j=0; j<pieces.size(); j++)
+			kept.push_back(ring_poly(pieces[j]));
+	}
+	
+	for (unsigned int j=0; j<fresh.size(); j++)
+		kept.push_back(ring_poly(fresh[j]));
+	
+	out.resize(first);
+	out.insert(out.end(), kept.begin(), kept.end());
+}
+
+/*
+ * Compile the macro for a given set of %AD parameters.
+ *
+ * All parameters are known at this point, so the program is evaluated
+ * symbolically here and every expression collapses to a constant. What is
+ * left is a list of PUSH constant; ...; PRIM n sequences which execute()
+ * runs with no variable lookups or arithmetic.
+ */
+Macro_VM * Macro_VM::compile(const double * params, int num_params)
+{
+	// $n lives in v[n]. Variables that are never defined read as 0
+	std::vector<double> v(num_params + 1, 0);
+	for (int i=0; i<num_params; i++)
+		v[i+1] = params[i];
+	
+	std::vector<double> st;
+	Macro_VM * out = new Macro_VM(m_um);
+	
+	i_code_type_t i = code.begin();
+	for (; i!=code.end(); i++)
+	{
+		Macro_OP & m = *i;
+		switch (m.op)
+		{
+			case OP_NOP:
+				break;
+			
+			case OP_ADD:
+			case OP_SUB:
+			case OP_MUL:
+			case OP_DIV:
+			{
+				if (st.size() < 2)
+				{
+					DBG_ERR_PF("Macro stack underflow");
+					delete out;
+					return NULL;
+				}
+				double a = st.back(); st.pop_back();
+				double b = st.back(); st.pop_back();
+				
+				if (m.op == OP_ADD)
+					st.push_back(b + a);
+				else if (m.op == OP_SUB)
+					st.push_back(b - a);
+				else if (m.op == OP_MUL)
+					st.push_back(b * a);
+				else
+					st.push_back(b / a);
+				break;
+			}
+			
+			case OP_PUSH:
+				st.push_back(m.fval);
+				break;
+			
+			case OP_FETCH:
+				if (m.ival < 0 || m.ival >= (int)v.size())
+				{
+					DBG_WARN_PF("Macro variable $%d undefined, using 0", m.ival);
+					st.push_back(0);
+				} else {
+					st.push_back(v[m.ival]);
+				}
+				break;
+			
+			case OP_STORE:
+				if (st.empty() || m.ival < 1)
+				{
+					DBG_ERR_PF("Invalid macro assignment to $%d", m.ival);
+					delete out;
+					return NULL;
+				}
+				if (m.ival >= (int)v.size())
+					v.resize(m.ival + 1, 0);
+				v[m.ival] = st.back(); st.pop_back();
+				break;
+			
+			case OP_PRIM:
+			{
+				std::vector<double>::iterator j = st.begin();
+				for (; j != st.end(); j++)
+					out->addInstr(OP_PUSH, *j, 0);
+				out->addInstr(OP_PRIM, 0, m.ival);
+				st.clear();
+				break;
+			}
+		}
+	}
+	
+	if (!out->verify())
+	{
+		delete out;
+		return NULL;
+	}
+	
+	return out;
+}
+
+/*
+ * Walk the program tracking stack depth. Rejects programs that underflow,
+ * and sizes the stack + variable table so execute can run unchecked
+ */
+bool Macro_VM::verify()
+{
+	int depth = 0;
+	m_max_depth = 0;
+	m_num_vars = 0;
+	
+	i_code_type_t i = code.begin();
+	for (; i!=code.end(); i++)
+	{
+		switch (i->op)
+		{
+			case OP_NOP:
+				break;
+			case OP_ADD:
+			case OP_SUB:
+			case OP_MUL:
+			case OP_DIV:
+				if (depth < 2)
+					return false;
+				depth--;
+				break;
+			case OP_PUSH:
+				depth++;
+				break;
+			case OP_FETCH:
+				if (i->ival < 0)
+					return false;
+				depth++;
+				break;
+			case OP_STORE:
+				if (depth < 1 || i->ival < 0)
+					return false;
+				depth--;
+				break;
+			case OP_PRIM:
+				// Primitives consume everything pushed since the last statement
+				depth = 0;
+				break;
+		}
+		
+		if (depth > m_max_depth)
+			m_max_depth = depth;
+		
+		if ((i->op == OP_FETCH || i->op == OP_STORE) && i->ival > m_num_vars)
+			m_num_vars = i->ival;
+	}
+	
+	mem_stack.assign(m_max_depth + 1, 0);
+	vars.assign(m_num_vars + 1, 0);
 	return true;
 }
 
 /*
- * Execute the macro, and return the generated polygon
+ * Execute the macro, appending the generated objects to out. Only valid on
+ * a VM returned from compile()
  */
-GerbObj_Poly * Macro_VM::execute(double * params, float x, float y)
+bool Macro_VM::execute(double x, double y, obj_list_t & out)
 {
-	GerbObj_Poly * p = new GerbObj_Poly();
+	assert(!mem_stack.empty());
+	
+	obj_list_t::size_type first = out.size();
 	i_code_type_t i = code.begin();
 	
+	double * st = &mem_stack[0];
+	double * var = &vars[0];
+	int sp = 0;
+	
 	for(;i!=code.end(); i++)
 	{
 		Macro_OP & m = *i;
@@ -134,79 +625,104 @@ GerbObj_Poly * Macro_VM::execute(double * params, float x, float y)
 			}
 			case OP_ADD:
 			{
-				float a = mem_stack.top(); mem_stack.pop();
-				float b = mem_stack.top(); mem_stack.pop();
-				mem_stack.push(a+b);
+				sp--;
+				st[sp-1] = st[sp-1] + st[sp];
 				break;
 			}
 			case OP_SUB:
 			{
-				float a = mem_stack.top(); mem_stack.pop();
-				float b = mem_stack.top(); mem_stack.pop();
-				mem_stack.push(b-a);
+				sp--;
+				st[sp-1] = st[sp-1] - st[sp];
 				break;
 			}
 			case OP_MUL:
 			{
-				float a = mem_stack.top(); mem_stack.pop();
-				float b = mem_stack.top(); mem_stack.pop();
-				mem_stack.push(a * b);
+				sp--;
+				st[sp-1] = st[sp-1] * st[sp];
 				break;
 			}
 			case OP_DIV:
 			{
-				float denom = mem_stack.top(); mem_stack.pop();
-				float num = mem_stack.top(); mem_stack.pop();
-				mem_stack.push(num/denom);
+				sp--;
+				st[sp-1] = st[sp-1] / st[sp];
 				break;
 			}
 			
 			case OP_PUSH:
-				mem_stack.push(m.fval);
+				st[sp++] = m.fval;
 				break;
 				
 			case OP_FETCH:
-				mem_stack.push(params[m.ival-1]);
+				st[sp++] = var[m.ival];
 				break;
 			
 			case OP_STORE:
-				params[m.ival] = mem_stack.top(); mem_stack.pop();
+				var[m.ival] = st[--sp];
 				break;
 				
 			case OP_PRIM:
-				// No other primitives than the following have been seen in production
-				// Adding them shouldn't be a big deal if they show up
+			{
+				obj_list_t::size_type prim = out.size();
+				bool exposure = true;
+				bool ok = true;
 				switch (m.ival){
-					case 5:
-						if (!renderPrim5(p,x,y))
-						{
-							delete p;
-							return NULL;
-						}
+					case 1:
+						ok = renderPrim1(out,st,sp,x,y);
 						break;
 					case 4:
-						if (!renderPrim4(p,x,y))
-						{
-							delete p;
-							return NULL;
-						}
+						ok = renderPrim4(out,st,sp,x,y);
+						break;
+					case 5:
+						ok = renderPrim5(out,st,sp,x,y);
+						break;
+					case 6:
+						ok = renderPrim6(out,st,sp,x,y);
+						exposure = false;
+						break;
+					case 7:
+						ok = renderPrim7(out,st,sp,x,y);
+						exposure = false;
+						break;
+					case 2:
+					case 20:
+						ok = renderPrim20(out,st,sp,x,y);
 						break;
 					case 21:
-						if (!renderPrim21(p,x,y))
-						{
-							delete p;
-							return NULL;
-						}
+						ok = renderPrim21(out,st,sp,x,y);
+						break;
+					case 22:
+						ok = renderPrim22(out,st,sp,x,y);
+						break;
+					case 0:
+						// Comment
+						exposure = false;
+						break;
+					default:
+						DBG_WARN_PF("Unhandled macro primitive %d", m.ival);
+						exposure = false;
 						break;
-					
 				}
-				break;
 				
+				if (!ok)
+				{
+					DBG_ERR_PF("Malformed macro primitive %d", m.ival);
+					for (obj_list_t::size_type j = first; j < out.size(); j++)
+						delete out[j];
+					out.resize(first);
+					return false;
+				}
+				
+				// Moire and thermal have no exposure, they are always on
+				if (exposure)
+					applyExposure(out, first, prim, (int)st[0]);
+				sp = 0;
+				break;
+			}
 				
 		}
 	}
 	
-	return p;
+	return true;
 }
 
 /*
@@ -23,7 +23,6 @@
 #define MACRO_VM
 
 #include <list>
-#include <stack>
 #include <vector>
 #include "types.h"
 
@@ -46,19 +45,33 @@ enum MACRO_OP_TYPE
 struct Macro_OP {	
 	MACRO_OP_TYPE op;	// Operand
 	int ival;			// Integer value of operand [if any]
-	float fval;			// Floating point value of operand [if any]
+	double fval;		// Floating point value of operand [if any]
 };
 
+class GerbObj;
 class GerbObj_Poly;
+class Point;
 
 class Macro_VM {
 
 	public:
-	Macro_VM(enum unit_mode um) : m_um(um) {};
+	Macro_VM(enum unit_mode um) : m_max_depth(0), m_num_vars(0), m_um(um) {};
 	
-	GerbObj_Poly * execute(double * params, float x, float y);
+	/* Specialise the macro for one aperture definition. The %AD parameters
+	 * are substituted, every expression is folded down to a constant, and
+	 * the stack depth of the resulting program is checked. Returns a new VM
+	 * ready to execute, or NULL if the macro is malformed */
+	Macro_VM * compile(const double * params, int num_params);
 	
-	void addInstr(MACRO_OP_TYPE t, float fval, int ival)
+	// One object per primitive - circles come out as round flashes, 
+	// everything else as polygons
+	typedef std::vector<GerbObj *> obj_list_t;
+	
+	/* Execute the macro, appending the generated objects to out. Returns
+	 * false [and appends nothing] if a primitive was malformed */
+	bool execute(double x, double y, obj_list_t & out);
+	
+	void addInstr(MACRO_OP_TYPE t, double fval, int ival)
 	{
 		struct Macro_OP o;
 		o.op = t;
@@ -69,15 +82,32 @@ class Macro_VM {
 	
 	void print();
 	private:
-		bool renderPrim5(GerbObj_Poly * p, float x, float y);
-		bool renderPrim4(GerbObj_Poly * p, float x, float y);
-		bool renderPrim21(GerbObj_Poly * p, float x, float y);
-		float convert_unit(float v);
+		bool verify();
+		bool renderPrim1(obj_list_t & out, const double * a, int argc, double x, double y);
+		bool renderPrim4(obj_list_t & out, const double * a, int argc, double x, double y);
+		bool renderPrim5(obj_list_t & out, const double * a, int argc, double x, double y);
+		bool renderPrim6(obj_list_t & out, const double * a, int argc, double x, double y);
+		bool renderPrim7(obj_list_t & out, const double * a, int argc, double x, double y);
+		bool renderPrim20(obj_list_t & out, const double * a, int argc, double x, double y);
+		bool renderPrim21(obj_list_t & out, const double * a, int argc, double x, double y);
+		bool renderPrim22(obj_list_t & out, const double * a, int argc, double x, double y);
+		void applyExposure(obj_list_t & out, obj_list_t::size_type first, obj_list_t::size_type prim, int exposure);
+		
+		Point place(double px, double py, double rot, double x, double y);
+		GerbObj * createCircle(double xc, double yc, double diam, double rot, double x, double y);
+		GerbObj_Poly * createRect(double xc, double yc, double w, double h, double angle, double rot, double x, double y);
+		void addArc(GerbObj_Poly * p, double xc, double yc, double r, double a0, double a1, double rot, double x, double y);
+		double convert_unit(double v);
 		typedef std::vector<Macro_OP> code_type_t;
 		typedef code_type_t::iterator i_code_type_t;
 		
 		code_type_t code;
-		std::stack<float> mem_stack;
+		
+		// Sized once by verify(), so execute never reallocates or bounds checks
+		std::vector<double> mem_stack;
+		std::vector<double> vars;
+		int m_max_depth;
+		int m_num_vars;
 
 	enum unit_mode m_um;
 };
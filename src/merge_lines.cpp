@@ -0,0 +1,247 @@
+/*
+ *  Portions Copyright 2006,2009 David Carne and 2007,2008 Spark Fun Electronics
+ *
+ *
+ *  This file is part of gerberDRC.
+ *
+ *  gerberDRC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gerberDRC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <math.h>
+#include <list>
+#include <vector>
+#include <utility>
+#include <tr1/unordered_map>
+#include <boost/functional/hash.hpp>
+
+#include "merge_lines.h"
+#include "gerbobj_line.h"
+#include "main.h"
+
+/*
+ * Collinear line merging
+ *
+ * Coordinates are on the integer grid, so lines that share an endpoint
+ * share it exactly and endpoints can be hashed. Within each dark run the
+ * line ends are put in an endpoint -> ends map. A chain is grown from a
+ * line through every endpoint where exactly two candidate ends meet [a
+ * junction of three or more traces is left alone] and the next line
+ * keeps the direction of the chain.
+ */
+
+typedef std::pair<coord_t, coord_t> endpoint_t;
+
+struct merge_seg {
+	std::list<sp_GerbObj>::iterator pos;
+	GerbObj_Line * l;
+	bool used;
+};
+
+// One end of a segment: index into the run, and whether it is the start
+struct seg_end {
+	unsigned int seg;
+	bool start;
+};
+
+typedef std::tr1::unordered_map<endpoint_t, std::vector<seg_end>, boost::hash<endpoint_t> > end_map_t;
+
+static bool can_merge(const GerbObj_Line * l)
+{
+	return !l->clear && l->lt == LT_STRAIGHT && l->lc == GerbObj_Line::LC_ROUND &&
+		(l->sx != l->ex || l->sy != l->ey);
+}
+
+static endpoint_t seg_point(const merge_seg & s, bool start)
+{
+	if (start)
+		return endpoint_t(s.l->sx, s.l->sy);
+	return endpoint_t(s.l->ex, s.l->ey);
+}
+
+// Twice the signed area of a, b, p. Exact on the grid, as long as the
+// points are less than about 3e9 steps apart
+static inline coord_t side(const endpoint_t & a, const endpoint_t & b, const endpoint_t & p)
+{
+	return (b.first - a.first) * (p.second - a.second) - (b.second - a.second) * (p.first - a.first);
+}
+
+// p lies within tol of the line through a and b
+static bool near_line(const endpoint_t & a, const endpoint_t & b, const endpoint_t & p, coord_t tol)
+{
+	coord_t cr = side(a, b, p);
+	if (tol <= 0)
+		return cr == 0;
+	
+	double dx = (double)(b.first - a.first), dy = (double)(b.second - a.second);
+	double t = (double)tol;
+	return (double)cr * (double)cr <= t * t * (dx * dx + dy * dy);
+}
+
+// a->b and c->d point the same way [less than 90 degrees apart]
+static bool same_dir(const endpoint_t & a, const endpoint_t & b,
+	const endpoint_t & c, const endpoint_t & d)
+{
+	double ux = (double)(b.first - a.first), uy = (double)(b.second - a.second);
+	double vx = (double)(d.first - c.first), vy = (double)(d.second - c.second);
+	return ux * vx + uy * vy > 0;
+}
+
+/*
+ * The other segment meeting s at p, if it continues the chain a->p.
+ * joints holds the joints the chain already drops. Returns the index of
+ * the segment and sets far to its other end, or -1
+ */
+static int chain_next(std::vector<merge_seg> & segs, end_map_t & ends, unsigned int s,
+	const endpoint_t & a, const endpoint_t & p, const std::vector<endpoint_t> & joints,
+	coord_t tol, endpoint_t & far)
+{
+	end_map_t::iterator i = ends.find(p);
+	if (i == ends.end() || (*i).second.size() != 2)
+		return -1;
+	
+	const seg_end & e = (*i).second[0].seg == s ? (*i).second[1] : (*i).second[0];
+	merge_seg & n = segs[e.seg];
+	if (e.seg == s || n.used || n.l->width != segs[s].l->width)
+		return -1;
+	
+	far = seg_point(n, !e.start);
+	if (!same_dir(a, p, p, far))
+		return -1;
+	
+	// p and every joint dropped so far must stay within tol of the new,
+	// longer line. Checking only the latest joint would let each one
+	// drift a little further
+	if (!near_line(a, far, p, tol))
+		return -1;
+	for (unsigned int j=0; j < joints.size(); j++)
+		if (!near_line(a, far, joints[j], tol))
+			return -1;
+	return e.seg;
+}
+
+// Merge the lines of one dark run. Returns the number of lines removed
+static long merge_run(Vector_Outp * v, std::vector<merge_seg> & segs, coord_t tol)
+{
+	end_map_t ends;
+	for (unsigned int i=0; i < segs.size(); i++)
+	{
+		seg_end e;
+		e.seg = i;
+		e.start = true;
+		ends[seg_point(segs[i], true)].push_back(e);
+		e.start = false;
+		ends[seg_point(segs[i], false)].push_back(e);
+	}
+	
+	long removed = 0;
+	for (unsigned int i=0; i < segs.size(); i++)
+	{
+		if (segs[i].used)
+			continue;
+		segs[i].used = true;
+		
+		endpoint_t a = seg_point(segs[i], true);
+		endpoint_t b = seg_point(segs[i], false);
+		std::vector<unsigned int> chain;
+		std::vector<endpoint_t> joints;
+		
+		// Grow forwards from b, then backwards from a
+		unsigned int last = i;
+		endpoint_t far;
+		int n;
+		while ((n = chain_next(segs, ends, last, a, b, joints, tol, far)) >= 0)
+		{
+			segs[n].used = true;
+			chain.push_back(n);
+			joints.push_back(b);
+			last = n;
+			b = far;
+		}
+		
+		last = i;
+		while ((n = chain_next(segs, ends, last, b, a, joints, tol, far)) >= 0)
+		{
+			segs[n].used = true;
+			chain.push_back(n);
+			joints.push_back(a);
+			last = n;
+			a = far;
+		}
+		
+		if (chain.empty())
+			continue;
+		
+		// The merged line takes the place of the first segment
+		GerbObj_Line * o = segs[i].l;
+		GerbObj_Line * l = new GerbObj_Line();
+		l->sx = a.first;
+		l->sy = a.second;
+		l->ex = b.first;
+		l->ey = b.second;
+		l->cx = o->cx;
+		l->cy = o->cy;
+		l->width = o->width;
+		l->lt = o->lt;
+		l->lc = o->lc;
+		l->flag = o->flag;
+		*segs[i].pos = sp_GerbObj(l);
+		
+		for (unsigned int j=0; j < chain.size(); j++)
+			v->all.erase(segs[chain[j]].pos);
+		removed += chain.size();
+	}
+	return removed;
+}
+
+double merge_collinear_lines(Vector_Outp * v, coord_t tol)
+{
+	long before = v->all.size();
+	long removed = 0;
+	
+	std::vector<merge_seg> run;
+	std::list<sp_GerbObj>::iterator it = v->all.begin();
+	while (it != v->all.end())
+	{
+		GerbObj * o = (*it).get();
+		
+		// A clear object ends the run. Lines on either side of it can't
+		// be joined, the clear object only erases the earlier one
+		if (o->clear)
+		{
+			removed += merge_run(v, run, tol);
+			run.clear();
+			++it;
+			continue;
+		}
+		
+		GerbObj_Line * l = dynamic_cast<GerbObj_Line *>(o);
+		if (l && can_merge(l))
+		{
+			merge_seg s;
+			s.pos = it;
+			s.l = l;
+			s.used = false;
+			run.push_back(s);
+		}
+		++it;
+	}
+	removed += merge_run(v, run, tol);
+	reindex_vector_outp(v);
+	
+	long after = before - removed;
+	DBG_MSG_PF("Line merge: %ld objects -> %ld, %ld lines merged away", before, after, removed);
+	
+	return after > 0 ? (double)before / after : 1.0;
+}
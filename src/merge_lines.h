@@ -0,0 +1,44 @@
+/*
+ *  Portions Copyright 2006,2009 David Carne and 2007,2008 Spark Fun Electronics
+ *
+ *
+ *  This file is part of gerberDRC.
+ *
+ *  gerberDRC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gerberDRC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef _MERGE_LINES_H_
+#define _MERGE_LINES_H_
+
+#include "gcode_interp.h"
+
+// Default distance a dropped joint may lie off the merged line [0: only
+// exactly collinear joints are dropped]
+#define MERGE_TOL 0
+
+/*
+ * Join chains of straight, same width lines that meet end to end and run
+ * in the same direction into single lines. Traces exported as many short
+ * segments become one object each. Lines are only joined with lines drawn
+ * in the same dark run [between clear objects], so polarity is unaffected.
+ *
+ * Every joint the merged line drops lies within tol [coord_t steps] of
+ * it, however long the chain. At tol 0 the test is exact on the integer
+ * grid. Returns objects before / objects after.
+ */
+double merge_collinear_lines(Vector_Outp * v, coord_t tol = MERGE_TOL);
+
+#endif
@@ -0,0 +1,410 @@
+/*
+ *  Portions Copyright 2006,2009 David Carne and 2007,2008 Spark Fun Electronics
+ *
+ *
+ *  This file is part of gerberDRC.
+ *
+ *  gerberDRC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gerberDRC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <math.h>
+#include <float.h>
+#include <map>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include "normalize.h"
+#include "gerbobj_poly.h"
+#include "main.h"
+
+/*
+ * Outline normalization
+ *
+ * Self intersections are found with ring_find_nodes, which only tests
+ * edges whose boxes meet. Every crossing and every vertex
+ * lying on another edge becomes a node in both edges. Between nodes the
+ * outline is in pieces that only meet at their ends, and the winding on
+ * either side of a piece is constant along it, so one probe per piece
+ * says whether it is on the boundary of the fill.
+ */
+
+/*
+ * Remove repeated points and spikes [b where a-b-c doubles back on
+ * itself], until none are left. Returns the number of points removed
+ */
+static long drop_degenerate(ring_t & r)
+{
+	long removed = 0;
+	bool changed = true;
+	while (changed && r.size() >= 3)
+	{
+		changed = false;
+		ring_t out;
+		out.reserve(r.size());
+		for (unsigned int i=0; i < r.size(); i++)
+		{
+			const Point & p = r[i];
+			while (!out.empty())
+			{
+				if (same(out.back(), p))
+				{
+					out.pop_back();
+					removed++;
+					continue;
+				}
+				if (out.size() >= 2)
+				{
+					const Point & a = out[out.size() - 2], & b = out.back();
+					if (side(a, b, p) == 0 &&
+						(b.x - a.x) * (p.x - b.x) + (b.y - a.y) * (p.y - b.y) < 0)
+					{
+						out.pop_back();
+						removed++;
+						continue;
+					}
+				}
+				break;
+			}
+			out.push_back(p);
+		}
+		
+		// Then across the join
+		while (out.size() >= 3)
+		{
+			unsigned int n = out.size();
+			if (same(out[n - 1], out[0]))
+			{
+				out.pop_back();
+				removed++;
+				changed = true;
+				continue;
+			}
+			const Point & a = out[n - 1], & b = out[0], & c = out[1];
+			const Point & z = out[n - 2];
+			if (side(a, b, c) == 0 && (b.x - a.x) * (c.x - b.x) + (b.y - a.y) * (c.y - b.y) < 0)
+			{
+				out.erase(out.begin());
+				removed++;
+				changed = true;
+				continue;
+			}
+			if (side(z, a, b) == 0 && (a.x - z.x) * (b.x - a.x) + (a.y - z.y) * (b.y - a.y) < 0)
+			{
+				out.pop_back();
+				removed++;
+				changed = true;
+				continue;
+			}
+			break;
+		}
+		r.swap(out);
+	}
+	if (r.size() < 3)
+		r.clear();
+	return removed;
+}
+
+// Times r winds round [px, py]
+static int winding(const ring_t & r, double px, double py)
+{
+	int w = 0;
+	for (unsigned int i=0, j=r.size()-1; i < r.size(); j=i++)
+	{
+		const Point & a = r[j], & b = r[i];
+		double s = (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+		if (a.y <= py)
+		{
+			if (b.y > py && s > 0)
+				w++;
+		} else if (b.y <= py && s < 0) {
+			w--;
+		}
+	}
+	return w;
+}
+
+typedef std::pair<coord_t, coord_t> pos_t;
+
+struct bound_edge {
+	Point a, b;
+	unsigned int next;
+};
+
+// Angle clockwise from direction d to direction e, in (0, 2pi]
+static double cw_turn(double d, double e)
+{
+	double t = d - e;
+	while (t <= 0)
+		t += 2 * M_PI;
+	while (t > 2 * M_PI)
+		t -= 2 * M_PI;
+	return t;
+}
+
+/*
+ * Trace the boundary edges into rings. Each edge has the fill on its
+ * left, so at every vertex the next edge is the first one clockwise from
+ * the way back; rings that touch at a vertex come out apart
+ */
+static void trace_rings(std::vector<bound_edge> & e, ring_list_t & rings)
+{
+	std::map<pos_t, std::vector<unsigned int> > from;
+	for (unsigned int i=0; i < e.size(); i++)
+		from[pos_t(e[i].a.x, e[i].a.y)].push_back(i);
+	
+	for (unsigned int i=0; i < e.size(); i++)
+	{
+		const std::vector<unsigned int> & out = from[pos_t(e[i].b.x, e[i].b.y)];
+		double back = atan2((double)(e[i].a.y - e[i].b.y), (double)(e[i].a.x - e[i].b.x));
+		double best = DBL_MAX;
+		e[i].next = e.size();
+		for (unsigned int k=0; k < out.size(); k++)
+		{
+			const bound_edge & o = e[out[k]];
+			double t = cw_turn(back, atan2((double)(o.b.y - o.a.y), (double)(o.b.x - o.a.x)));
+			if (t < best)
+			{
+				best = t;
+				e[i].next = out[k];
+			}
+		}
+	}
+	
+	std::vector<bool> used(e.size(), false);
+	for (unsigned int i=0; i < e.size(); i++)
+	{
+		if (used[i])
+			continue;
+		ring_t ring;
+		unsigned int k = i;
+		for (; k < e.size() && !used[k]; k=e[k].next)
+		{
+			used[k] = true;
+			ring.push_back(e[k].a);
+		}
+		
+		// Only if it closed where it started
+		if (k != i)
+			continue;
+		drop_degenerate(ring);
+		if (ring.size() >= 3)
+			rings.push_back(ring);
+	}
+}
+
+// A point a little left of the middle of a-b
+static void left_of(const Point & a, const Point & b, double & px, double & py)
+{
+	double dx = (double)(b.x - a.x), dy = (double)(b.y - a.y);
+	double off = 0.01 / sqrt(dx * dx + dy * dy);
+	px = (a.x + b.x) / 2.0 - dy * off;
+	py = (a.y + b.y) / 2.0 + dx * off;
+}
+
+bool ring_normalize(const ring_t & in, ring_list_t & out, struct normalize_stats & st)
+{
+	out.clear();
+	ring_t r = in;
+	st.degenerate += drop_degenerate(r);
+	if (r.size() < 3)
+		return false;
+	
+	std::vector<std::vector<edge_node> > nodes;
+	long crossings = ring_convex(r) ? 0 : ring_find_nodes(r, nodes);
+	if (!crossings)
+	{
+		if (ring_area(r) < 0)
+		{
+			std::reverse(r.begin(), r.end());
+			st.reversed++;
+		}
+		if (ring_area(r) == 0)
+			return false;
+		out.push_back(r);
+		return true;
+	}
+	st.crossings += crossings;
+	
+	// The outline with its nodes in place
+	ring_t walk;
+	for (unsigned int i=0; i < r.size(); i++)
+	{
+		walk.push_back(r[i]);
+		std::sort(nodes[i].begin(), nodes[i].end());
+		for (unsigned int k=0; k < nodes[i].size(); k++)
+			if (!same(nodes[i][k].p, walk.back()))
+				walk.push_back(nodes[i][k].p);
+	}
+	
+	/*
+	 * Count how many times the outline runs along each piece between
+	 * nodes, then keep the pieces with fill [nonzero winding] on one side
+	 * only
+	 */
+	typedef std::map<std::pair<pos_t, pos_t>, int> piece_map_t;
+	piece_map_t pieces;
+	for (unsigned int i=0; i < walk.size(); i++)
+	{
+		const Point & p = walk[i], & q = walk[(i+1) % walk.size()];
+		if (same(p, q))
+			continue;
+		pos_t pp(p.x, p.y), qp(q.x, q.y);
+		if (pp < qp)
+			pieces[std::make_pair(pp, qp)]++;
+		else
+			pieces[std::make_pair(qp, pp)]--;
+	}
+	
+	std::vector<bound_edge> edges;
+	for (piece_map_t::iterator it = pieces.begin(); it != pieces.end(); it++)
+	{
+		if (it->second == 0)
+			continue;
+		bound_edge e;
+		e.a = Point(it->first.first.first, it->first.first.second);
+		e.b = Point(it->first.second.first, it->first.second.second);
+		double px, py;
+		left_of(e.a, e.b, px, py);
+		int wl = winding(walk, px, py);
+		int wr = wl - it->second;
+		if ((wl != 0) == (wr != 0))
+			continue;
+		if (wl == 0)
+			std::swap(e.a, e.b);
+		edges.push_back(e);
+	}
+	
+	ring_list_t rings;
+	trace_rings(edges, rings);
+	
+	std::vector<unsigned int> holes;
+	std::vector<double> area;
+	for (unsigned int i=0; i < rings.size(); i++)
+	{
+		area.push_back(ring_area(rings[i]));
+		if (area[i] > 0)
+			out.push_back(rings[i]);
+		else if (area[i] < 0)
+			holes.push_back(i);
+	}
+	
+	/*
+	 * Each hole goes in the smallest outline around it. Holes further
+	 * right go first, so a bridge always ends on an outline already
+	 * joined up
+	 */
+	std::vector<std::pair<coord_t, unsigned int> > order;
+	std::vector<int> into(rings.size(), -1);
+	for (unsigned int k=0; k < holes.size(); k++)
+	{
+		unsigned int i = holes[k];
+		double px, py;
+		left_of(rings[i][0], rings[i][1], px, py);
+		double best = DBL_MAX;
+		for (unsigned int j=0; j < out.size(); j++)
+		{
+			double a = ring_area(out[j]);
+			if (a < best && winding(out[j], px, py) != 0)
+			{
+				best = a;
+				into[i] = j;
+			}
+		}
+		if (into[i] < 0)
+			continue;
+		
+		coord_t right = rings[i][0].x;
+		for (unsigned int m=1; m < rings[i].size(); m++)
+			right = std::max(right, rings[i][m].x);
+		order.push_back(std::make_pair(-right, i));
+	}
+	std::sort(order.begin(), order.end());
+	for (unsigned int k=0; k < order.size(); k++)
+	{
+		unsigned int i = order[k].second;
+		if (ring_keyhole(out[into[i]], rings[i]))
+			st.holes++;
+	}
+	
+	if (out.size() > 1)
+		st.split += out.size() - 1;
+	return !out.empty();
+}
+
+static bool same_ring(const ring_t & a, const ring_t & b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (unsigned int i=0; i < a.size(); i++)
+		if (!same(a[i], b[i]))
+			return false;
+	return true;
+}
+
+struct normalize_stats normalize_vector_outp(Vector_Outp * v)
+{
+	struct normalize_stats st;
+	st.polys = st.reversed = st.degenerate = st.crossings = st.split = st.holes = 0;
+	
+	ring_t r;
+	ring_list_t out;
+	std::list<sp_GerbObj>::iterator it = v->all.begin();
+	while (it != v->all.end())
+	{
+		GerbObj_Poly * p = dynamic_cast<GerbObj_Poly *>((*it).get());
+		if (!p)
+		{
+			++it;
+			continue;
+		}
+		st.polys++;
+		
+		r.assign(p->pointBegin(), p->pointEnd());
+		if (!ring_normalize(r, out, st))
+		{
+			it = v->all.erase(it);
+			continue;
+		}
+		if (out.size() == 1 && same_ring(out[0], r))
+		{
+			++it;
+			continue;
+		}
+		
+		bool packed = p->isPacked();
+		p->unpack();
+		p->points.assign(out[0].begin(), out[0].end());
+		p->pointsChanged();
+		if (packed)
+			p->pack();
+		++it;
+		
+		for (unsigned int i=1; i < out.size(); i++)
+		{
+			GerbObj_Poly * np = new GerbObj_Poly();
+			np->clear = p->clear;
+			np->points.assign(out[i].begin(), out[i].end());
+			if (packed)
+				np->pack();
+			v->all.insert(it, sp_GerbObj(np));
+		}
+	}
+	reindex_vector_outp(v);
+	
+	DBG_MSG_PF("Normalize: %ld polygons, %ld reversed, %ld points dropped, %ld crossings, %ld split off, %ld holes",
+		st.polys, st.reversed, st.degenerate, st.crossings, st.split, st.holes);
+	return st;
+}
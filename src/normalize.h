@@ -0,0 +1,54 @@
+/*
+ *  Portions Copyright 2006,2009 David Carne and 2007,2008 Spark Fun Electronics
+ *
+ *
+ *  This file is part of gerberDRC.
+ *
+ *  gerberDRC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gerberDRC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef _NORMALIZE_H_
+#define _NORMALIZE_H_
+
+#include "gcode_interp.h"
+#include "ring.h"
+
+struct normalize_stats {
+	long polys;		// polygons looked at
+	long reversed;		// wound clockwise
+	long degenerate;	// repeated points and spikes removed
+	long crossings;		// self intersections and touches split at
+	long split;		// extra polygons made by splitting
+	long holes;		// holes keyholed into the outline around them
+};
+
+/*
+ * Bring an outline to a standard form: counterclockwise, no repeated
+ * points, no zero width spikes, and no edge crossing or touching another
+ * [other than the bridges of keyholes].
+ *
+ * An outline that crosses itself is cut at every crossing, and only the
+ * pieces with fill on one side [nonzero winding, as regions are filled
+ * when drawn] are kept. They are traced into outlines and holes; each
+ * hole is keyholed into the smallest outline around it [ring_keyhole].
+ * Returns false, leaving out empty, if nothing with area is left.
+ */
+bool ring_normalize(const ring_t & in, ring_list_t & out, struct normalize_stats & st);
+
+// ring_normalize every polygon in the layer. Split polygons keep their place
+struct normalize_stats normalize_vector_outp(Vector_Outp * v);
+
+#endif
@@ -0,0 +1,104 @@
+/*
+ *  Portions Copyright 2006,2009 David Carne and 2007,2008 Spark Fun Electronics
+ *
+ *
+ *  This file is part of gerberDRC.
+ *
+ *  gerberDRC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gerberDRC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "packed_points.h"
+#include "gcode_interp.h"
+#include "gerbobj_poly.h"
+#include "main.h"
+
+static void put_varint(std::vector<unsigned char> & d, unsigned long long v)
+{
+	while (v >= 0x80)
+	{
+		d.push_back((unsigned char)(v | 0x80));
+		v >>= 7;
+	}
+	d.push_back((unsigned char)v);
+}
+
+static inline unsigned long long zigzag(coord_t v)
+{
+	return ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63);
+}
+
+void PackedPoints::pack(const Point * p, unsigned int n)
+{
+	std::vector<unsigned char> d;
+	if (n)
+	{
+		// Worst case is 10 bytes a number; most steps need 2 or 3
+		d.reserve(8 + 6 * n);
+		put_varint(d, n);
+		put_varint(d, zigzag(p[0].x));
+		put_varint(d, zigzag(p[0].y));
+		for (unsigned int i=1; i < n; i++)
+		{
+			put_varint(d, zigzag(p[i].x - p[i-1].x));
+			put_varint(d, zigzag(p[i].y - p[i-1].y));
+		}
+	}
+	
+	// Copy to drop the slack
+	std::vector<unsigned char>(d.begin(), d.end()).swap(m_data);
+}
+
+unsigned int PackedPoints::size() const
+{
+	if (m_data.empty())
+		return 0;
+	const unsigned char * p = &m_data[0];
+	return get_varint(p);
+}
+
+PackedPoints::const_iterator PackedPoints::begin() const
+{
+	const_iterator i;
+	if (m_data.empty())
+		return i;
+	
+	i.m_p = &m_data[0];
+	i.m_left = get_varint(i.m_p);
+	i.m_cur.x = unzigzag(get_varint(i.m_p));
+	i.m_cur.y = unzigzag(get_varint(i.m_p));
+	return i;
+}
+
+long pack_vector_outp(Vector_Outp * v, bool pack)
+{
+	long n = 0, bytes = 0;
+	std::list<sp_GerbObj>::iterator it = v->all.begin();
+	for (; it != v->all.end(); it++)
+	{
+		GerbObj_Poly * p = dynamic_cast<GerbObj_Poly *>((*it).get());
+		if (!p)
+			continue;
+		
+		if (pack)
+			p->pack();
+		else
+			p->unpack();
+		bytes += p->pointBytes();
+		n++;
+	}
+	
+	DBG_MSG_PF("%s %ld polygons, %ld bytes of points", pack ? "Packed" : "Unpacked", n, bytes);
+	return bytes;
+}
@@ -0,0 +1,111 @@
+/*
+ *  Portions Copyright 2006,2009 David Carne and 2007,2008 Spark Fun Electronics
+ *
+ *
+ *  This file is part of gerberDRC.
+ *
+ *  gerberDRC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gerberDRC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef _PACKED_POINTS_H_
+#define _PACKED_POINTS_H_
+
+#include <vector>
+#include <iterator>
+#include <stddef.h>
+
+#include "util_type.h"
+
+/*
+ * A compact, read only outline: the point count, the first point, then
+ * the step from each point to the next. Every number is zigzag coded
+ * [small negatives stay small] and written 7 bits a byte, so the short
+ * edges of pours and tessellated arcs take 2-3 bytes an axis instead of
+ * the 8 of a coord_t.
+ *
+ * Points are decoded as they are iterated; there is no random access.
+ */
+class PackedPoints {
+public:
+	class const_iterator {
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef Point value_type;
+		typedef ptrdiff_t difference_type;
+		typedef const Point * pointer;
+		typedef const Point & reference;
+		
+		const_iterator() : m_p(NULL), m_left(0) {};
+		
+		const Point & operator*() const {return m_cur;};
+		const Point * operator->() const {return &m_cur;};
+		
+		const_iterator & operator++()
+		{
+			if (--m_left)
+			{
+				m_cur.x += unzigzag(get_varint(m_p));
+				m_cur.y += unzigzag(get_varint(m_p));
+			}
+			return *this;
+		}
+		const_iterator operator++(int) {const_iterator t = *this; ++*this; return t;};
+		
+		// Only meaningful between iterators of the same PackedPoints
+		bool operator==(const const_iterator & o) const {return m_left == o.m_left;};
+		bool operator!=(const const_iterator & o) const {return m_left != o.m_left;};
+		
+	private:
+		friend class PackedPoints;
+		
+		const unsigned char * m_p;
+		unsigned int m_left;
+		Point m_cur;
+	};
+	
+	void pack(const Point * p, unsigned int n);
+	void clear() {std::vector<unsigned char>().swap(m_data);};
+	
+	bool empty() const {return m_data.empty();};
+	unsigned int size() const;
+	long bytes() const {return m_data.capacity();};
+	
+	const_iterator begin() const;
+	const_iterator end() const {return const_iterator();};
+	
+	static inline unsigned long long get_varint(const unsigned char * & p)
+	{
+		unsigned long long v = 0;
+		int s = 0;
+		while (*p & 0x80)
+		{
+			v |= (unsigned long long)(*p++ & 0x7f) << s;
+			s += 7;
+		}
+		v |= (unsigned long long)*p++ << s;
+		return v;
+	}
+	
+	static inline coord_t unzigzag(unsigned long long v)
+	{
+		return (coord_t)(v >> 1) ^ -(coord_t)(v & 1);
+	}
+	
+private:
+	std::vector<unsigned char> m_data;
+};
+
+#endif
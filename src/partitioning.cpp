@@ -40,7 +40,7 @@ void makeEndPartitions(Vector_Outp * outp)
 		GerbObj * e = *i;
 	
 		
-		outp->lines.insertbounded(e->getBounds(),e);
+		outp->lines.insertbounded(e->getBounds(),e->id);
 	}
 }
 
@@ -22,109 +22,384 @@
 #ifndef _PARTITIONING_H
 #define _PARTITIONING_H
 
-#include <map>
-#include <set>
+#include <math.h>
+#include <tr1/unordered_map>
+#include <vector>
+#include <algorithm>
+#include <iterator>
 #include "util_type.h"
 
-struct ltint
-{
-  bool operator()(const int s1, const int s2) const
-  {
-    return s1<s2;
-  }
-};
-#define scalefactor 10
+// Default cell size [1mm, in coord_t steps]
+#define PART2D_CELL (1000.0 * COORD_PER_UM)
+
+// Default cells per coord_t step
+#define scalefactor (1.0 / PART2D_CELL)
 
+/*
+ * Cells hold their values as sorted vectors without repeats, and
+ * retrieve returns the same. Use small dense values [object ids, array
+ * indices] rather than pointers, so the order of the results doesn't
+ * depend on where things were allocated.
+ *
+ * visit and the output iterator retrieve hand over each value once
+ * without building a result: a value seen in an earlier cell of the same
+ * query is skipped by comparing its stamp with the query's epoch. The
+ * stamps make queries on one Part2D unsafe to run concurrently.
+ */
 template <class T> class Part2D {
 
 	public:
-	typedef std::map<int, std::set<T>, ltint> spatialmap;
+	typedef std::vector<T> cell_t;
+	typedef std::tr1::unordered_map<unsigned long long, cell_t> spatialmap;
+	
+	// cells is the number of cells per coord_t step [default scalefactor,
+	// 1mm cells]
+	Part2D(double cells = scalefactor) : m_scale(cells), m_epoch(0) {};
 	
 	void insertbounded(const Rect & r, T v)
 	{
 		insertbounded(r.getStartPoint().x,r.getStartPoint().y,r.getEndPoint().x,r.getEndPoint().y,v);
 	}
-	void insertbounded(float x1, float y1, float x2, float y2, T v)
+	void insertbounded(coord_t x1, coord_t y1, coord_t x2, coord_t y2, T v)
 	{
-		int ix1 = (int)(scalefactor * x1);
-		int ix2 = (int)(scalefactor * x2)+1;
+		long long ix1 = cell(x1);
+		long long ix2 = cell(x2)+1;
 		
-		int iy1 = (int)(scalefactor * y1);
-		int iy2 = (int)(scalefactor * y2)+1;
+		long long iy1 = cell(y1);
+		long long iy2 = cell(y2)+1;
 		
-		for (int x=ix1; x<ix2; x++)
-			for (int y=iy1; y<iy2; y++)
-				data[xytoq(x,y)].insert(v);
+		for (long long x=ix1; x<ix2; x++)
+			for (long long y=iy1; y<iy2; y++)
+				cell_insert(data[xytoq(x,y)], v);
+		stamp_room(v);
+	}
+	
+	void removebounded(const Rect & r, T v)
+	{
+		long long ix1 = cell(r.getStartPoint().x);
+		long long ix2 = cell(r.getEndPoint().x)+1;
+		
+		long long iy1 = cell(r.getStartPoint().y);
+		long long iy2 = cell(r.getEndPoint().y)+1;
 		
+		for (long long x=ix1; x<ix2; x++)
+			for (long long y=iy1; y<iy2; y++)
+			{
+				typename spatialmap::iterator i = data.find(xytoq(x,y));
+				if (i != data.end())
+					cell_erase((*i).second, v);
+			}
 	}
 	
-	void insert(float x, float y, T v)
+	void insert(coord_t x, coord_t y, T v)
 	{
-		std::set<T> * p = &data[xytoq((int)(scalefactor * x), (int)(scalefactor * y))];
-		p->insert(v);
+		cell_insert(data[xytoq(cell(x), cell(y))], v);
+		stamp_room(v);
 	}
 	
 	
-	std::set<T> * retrieveFast(float x, float y)
+	cell_t * retrieveFast(coord_t x, coord_t y)
 	{
-		int ix = (int)(scalefactor * x);
-		int iy = (int)(scalefactor * y);
+		long long ix = cell(x);
+		long long iy = cell(y);
 		return &data[xytoq(ix,iy)];
 	}
 	
-	std::set<T> retrieve(float x, float y, float d)
+	cell_t retrieve(coord_t x, coord_t y, coord_t d)
 	{
 		return retrieve(x, y, d, d);
 	}
 	
-	std::set<T> retrieve(Rect  r)
+	cell_t retrieve(Rect  r)
+	{
+		long long sx = cell(r.getStartPoint().x);
+		long long sy = cell(r.getStartPoint().y);
+		
+		long long ex = cell(r.getEndPoint().x) + 1;
+		long long ey = cell(r.getEndPoint().y) + 1;
+		
+		return gather(sx, sy, ex, ey);
+	}
+	
+	// Call f(v) once for every value in the cells r covers, in no
+	// particular order. f must not insert or remove
+	template <class F> void visit(const Rect & r, F & f)
 	{
-		int sx = (int)(scalefactor * (r.getStartPoint().x));
-		int sy = (int)(scalefactor * (r.getStartPoint().y));
+		long long sx = cell(r.getStartPoint().x);
+		long long sy = cell(r.getStartPoint().y);
+		
+		long long ex = cell(r.getEndPoint().x) + 1;
+		long long ey = cell(r.getEndPoint().y) + 1;
+		
+		visit_cells(sx, sy, ex, ey, f);
+	}
+	
+	// Write the values retrieve(r) would return to out, unsorted
+	template <class OutIt> OutIt retrieve(const Rect & r, OutIt out)
+	{
+		out_visitor<OutIt> o(out);
+		visit(r, o);
+		return o.out;
+	}
+	// retrieves everything in a box thats +-d in both directions, may retrieve more
+	cell_t retrieve(coord_t x, coord_t y, coord_t dx, coord_t dy)
+	{
+		long long sx = cell(x - dx);
+		long long sy = cell(y - dy);
+		long long ex = cell(x + dx) + 1;
+		long long ey = cell(y + dy) + 1;
+		
+		return gather(sx, sy, ex, ey);
+	}
+	
+		
+	private:
+		// Cell index of a coordinate, rounded down. Worked out in 64 bits:
+		// at a fine scale the index passes the range of an int well inside
+		// a board
+		long long cell(coord_t x) const
+		{
+			return (long long)floor(m_scale * (double)x);
+		}
+		
+		// Both cell indices side by side. Indices that differ by a
+		// multiple of 2^32 share a key, which only adds candidates
+		static unsigned long long xytoq(long long x, long long y)
+		{
+			return ((unsigned long long)(unsigned int)x << 32) | (unsigned int)y;
+		}
+		
+		static void cell_insert(cell_t & c, T v)
+		{
+			typename cell_t::iterator i = std::lower_bound(c.begin(), c.end(), v);
+			if (i == c.end() || *i != v)
+				c.insert(i, v);
+		}
+		
+		static void cell_erase(cell_t & c, T v)
+		{
+			typename cell_t::iterator i = std::lower_bound(c.begin(), c.end(), v);
+			if (i != c.end() && *i == v)
+				c.erase(i);
+		}
 		
-		int ex = (int)(scalefactor * (r.getEndPoint().x)) + 1;
-		int ey = (int)(scalefactor * (r.getEndPoint().y)) + 1;
+		template <class OutIt> struct out_visitor {
+			out_visitor(OutIt o) : out(o) {};
+			void operator()(T v) {*out++ = v;};
+			OutIt out;
+		};
 		
-		std::set<T> o;
-		for (int i=sx; i<ex; i++)
-			for (int j=sy; j<ey; j++)
+		// Union of the cells in [sx, ex) x [sy, ey)
+		cell_t gather(long long sx, long long sy, long long ex, long long ey)
+		{
+			cell_t o;
+			out_visitor<std::back_insert_iterator<cell_t> > f(std::back_inserter(o));
+			visit_cells(sx, sy, ex, ey, f);
+			std::sort(o.begin(), o.end());
+			return o;
+		}
+		
+		template <class F> void visit_cells(long long sx, long long sy, long long ex, long long ey, F & f)
+		{
+			unsigned int e = next_epoch();
+			for (long long i=sx; i<ex; i++)
+				for (long long j=sy; j<ey; j++)
+				{
+					typename spatialmap::const_iterator d = data.find(xytoq(i,j));
+					if (d == data.end())
+						continue;
+					
+					const cell_t & c = (*d).second;
+					for (typename cell_t::const_iterator k = c.begin(); k != c.end(); k++)
+					{
+						if (m_stamp[*k] == e)
+							continue;
+						m_stamp[*k] = e;
+						f(*k);
+					}
+				}
+		}
+		
+		// Stamps are grown as values are inserted, never while querying
+		void stamp_room(T v)
+		{
+			if ((size_t)v >= m_stamp.size())
+				m_stamp.resize((size_t)v + 1, 0);
+		}
+		
+		// When the epoch wraps the old stamps could match again, so they
+		// are wiped
+		unsigned int next_epoch()
+		{
+			if (++m_epoch == 0)
 			{
-				std::set<T> d = data[xytoq(i,j)];
-				o.insert(d.begin(), d.end());
+				std::fill(m_stamp.begin(), m_stamp.end(), 0);
+				m_epoch = 1;
 			}
-			
-		return o;
+			return m_epoch;
+		}
+		
+		spatialmap data;
+		double m_scale;
+		
+		std::vector<unsigned int> m_stamp;
+		unsigned int m_epoch;
+};
+
+
+
+/*
+ * Grid with a level per object size: level L has cells of cell << L, and
+ * an object goes into the first level whose cells are no smaller than its
+ * box. It is stored once, in the cell holding its lower left corner, so it
+ * reaches at most one cell further right and up. A 100mm pour costs the
+ * same to insert as a pad, where Part2D would copy it into every cell.
+ *
+ * Queries look at every level in use, one cell further left and down than
+ * the query reaches, and test the stored boxes, so they return exactly the
+ * values whose box touches the query. Same interface as Part2D otherwise.
+ */
+template <class T> class HierGrid {
+	
+	public:
+	typedef std::vector<T> cell_t;
+	
+	HierGrid(coord_t cell) : m_cell(cell > 0 ? cell : 1), m_count(0) {};
 	
+	void insertbounded(const Rect & r, T v)
+	{
+		insertbounded(r.getStartPoint().x,r.getStartPoint().y,r.getEndPoint().x,r.getEndPoint().y,v);
 	}
-	// retrieves everything in a box thats +-d in both directions, may retrieve more
-	std::set<T> retrieve(float x, float y, float dx, float dy)
+	void insertbounded(coord_t x1, coord_t y1, coord_t x2, coord_t y2, T v)
 	{
-		int sx = (int)(scalefactor * (x - dx));
-		int sy = (int)(scalefactor * (y - dy));
-		int ex = (int)(scalefactor * (x + dx)) + 1;
-		int ey = (int)(scalefactor * (y + dy)) + 1;
+		unsigned int l = level_of(x2 - x1, y2 - y1);
+		if (l >= levels.size())
+			levels.resize(l + 1);
 		
-		std::set<T> o;
-		for (int i=sx; i<ex; i++)
-			for (int j=sy; j<ey; j++)
+		struct entry e = {v, x1, y1, x2, y2};
+		coord_t c = m_cell << l;
+		levels[l].cells[xytoq(cell_of(x1, c), cell_of(y1, c))].push_back(e);
+		levels[l].count++;
+		m_count++;
+	}
+	
+	void removebounded(const Rect & r, T v)
+	{
+		coord_t x1 = r.getStartPoint().x, y1 = r.getStartPoint().y;
+		unsigned int l = level_of(r.getEndPoint().x - x1, r.getEndPoint().y - y1);
+		if (l >= levels.size())
+			return;
+		
+		coord_t c = m_cell << l;
+		typename cellmap::iterator i = levels[l].cells.find(xytoq(cell_of(x1, c), cell_of(y1, c)));
+		if (i == levels[l].cells.end())
+			return;
+		
+		std::vector<struct entry> & es = (*i).second;
+		for (unsigned int k=0; k < es.size(); k++)
+			if (es[k].v == v)
 			{
-				std::set<T> d = data[xytoq(i,j)];
-				o.insert(d.begin(), d.end());
+				es[k] = es.back();
+				es.pop_back();
+				levels[l].count--;
+				m_count--;
+				break;
 			}
-			
+	}
+	
+	// Values whose box touches r [closed], sorted
+	cell_t retrieve(Rect r)
+	{
+		cell_t o;
+		retrieve(r, std::back_inserter(o));
+		std::sort(o.begin(), o.end());
 		return o;
 	}
 	
+	// Call f(v) once for every value whose box touches r, in no
+	// particular order. f must not insert or remove
+	template <class F> void visit(const Rect & r, F & f) const
+	{
+		coord_t qx0 = r.getStartPoint().x, qy0 = r.getStartPoint().y;
+		coord_t qx1 = r.getEndPoint().x, qy1 = r.getEndPoint().y;
 		
+		for (unsigned int l=0; l < levels.size(); l++)
+		{
+			if (!levels[l].count)
+				continue;
+			
+			coord_t c = m_cell << l;
+			long sx = cell_of(qx0, c) - 1, ex = cell_of(qx1, c);
+			long sy = cell_of(qy0, c) - 1, ey = cell_of(qy1, c);
+			const cellmap & cells = levels[l].cells;
+			for (long x=sx; x <= ex; x++)
+				for (long y=sy; y <= ey; y++)
+				{
+					typename cellmap::const_iterator i = cells.find(xytoq(x, y));
+					if (i == cells.end())
+						continue;
+					
+					const std::vector<struct entry> & es = (*i).second;
+					for (unsigned int k=0; k < es.size(); k++)
+						if (es[k].x1 <= qx1 && es[k].x2 >= qx0 && es[k].y1 <= qy1 && es[k].y2 >= qy0)
+							f(es[k].v);
+				}
+		}
+	}
+	
+	// Write the values retrieve(r) would return to out, unsorted
+	template <class OutIt> OutIt retrieve(const Rect & r, OutIt out) const
+	{
+		out_visitor<OutIt> o(out);
+		visit(r, o);
+		return o.out;
+	}
+	
+	long size() const {return m_count;};
+	int levelCount() const {return levels.size();};
+	
 	private:
-		int xytoq(int x, int y)
+		struct entry {
+			T v;
+			coord_t x1, y1, x2, y2;
+		};
+		typedef std::tr1::unordered_map<unsigned long long, std::vector<struct entry> > cellmap;
+		
+		struct level {
+			level() : count(0) {};
+			cellmap cells;
+			long count;
+		};
+		
+		template <class OutIt> struct out_visitor {
+			out_visitor(OutIt o) : out(o) {};
+			void operator()(T v) {*out++ = v;};
+			OutIt out;
+		};
+		
+		unsigned int level_of(coord_t w, coord_t h) const
 		{
-			return 2*x+3*y;
+			coord_t s = std::max(w, h);
+			unsigned int l = 0;
+			while ((m_cell << l) < s && l < 40)
+				l++;
+			return l;
 		}
-		spatialmap data;
+		
+		// Rounds down for negative coordinates too
+		static long cell_of(coord_t x, coord_t c)
+		{
+			return x >= 0 ? x / c : -((-x + c - 1) / c);
+		}
+		
+		static unsigned long long xytoq(long x, long y)
+		{
+			return ((unsigned long long)(unsigned int)x << 32) | (unsigned int)y;
+		}
+		
+		std::vector<struct level> levels;
+		coord_t m_cell;
+		long m_count;
 };
 
-
-
 #endif
-
@@ -0,0 +1,373 @@
+/*
+ *  Portions Copyright 2006,2009 David Carne and 2007,2008 Spark Fun Electronics
+ *
+ *
+ *  This file is part of gerberDRC.
+ *
+ *  gerberDRC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gerberDRC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <math.h>
+#include <float.h>
+#include <string.h>
+#include <time.h>
+#include <list>
+#include <map>
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+
+#include "polarity.h"
+#include "ring.h"
+#include "polygonize.h"
+#include "capsule.h"
+#include "simplify.h"
+#include "partitioning.h"
+#include "gerbobj_line.h"
+#include "gerbobj_poly.h"
+#include "main.h"
+
+/*
+ * Clear polarity composition
+ *
+ * Dark objects are added to a spatial index as they are drawn. A clear
+ * object looks up the dark objects it may overlap, and each one that it
+ * actually touches is replaced by what ring_subtract leaves of it [see
+ * ring.h for how the cut is made].
+ *
+ * Pieces keep the place of the object they came from in the output.
+ * Between clear objects each piece keeps its outline, so only the pieces
+ * a clear object touches are recomputed. Pieces that collect too many
+ * vertices [many holes in a plane] are split in half, down to the tile
+ * size, so later cuts stay local.
+ *
+ * The cost goes with the number of cuts, not the size of the layer:
+ * objects after the last clear object are never indexed. Each cut is a
+ * boolean on outlines of up to a few hundred points, tens of times the
+ * cost of drawing the object, so a plane layer that is mostly
+ * clearances takes about ten times as long as the same layer drawn dark.
+ */
+
+// Pieces with more vertices than this get split
+#define SPLIT_VERTS 256
+
+// Split rings with many vertices in half until they are tile sized
+static void ring_split(const ring_t & r, double tile, ring_list_t & out)
+{
+	Rect b = ring_bounds(r);
+	double w = b.getWidth();
+	double h = b.getHeight();
+	
+	if (r.size() <= SPLIT_VERTS || fmax(w, h) < 2 * tile)
+	{
+		out.push_back(r);
+		return;
+	}
+	
+	Point a, e;
+	if (w > h)
+	{
+		double m = b.getStartPoint().x + w / 2;
+		a = Point(m, 0);
+		e = Point(m, 1);
+	} else {
+		double m = b.getStartPoint().y + h / 2;
+		a = Point(0, m);
+		e = Point(1, m);
+	}
+	
+	ring_t half;
+	clip_halfplane(r, a, e, false, half);
+	if (fabs(ring_area(half)) > RING_MIN_AREA)
+		ring_split(half, tile, out);
+	clip_halfplane(r, a, e, true, half);
+	if (fabs(ring_area(half)) > RING_MIN_AREA)
+		ring_split(half, tile, out);
+}
+
+// Outline of an object. Empty for objects without area
+static void obj_ring(GerbObj * o, ring_t & r)
+{
+	r.clear();
+	
+	GerbObj_Poly * p = dynamic_cast<GerbObj_Poly *>(o);
+	if (p)
+	{
+		r.assign(p->pointBegin(), p->pointEnd());
+		return;
+	}
+	
+	GerbObj_Line * l = dynamic_cast<GerbObj_Line *>(o);
+	if (l)
+	{
+		p = createPolyForLine(l);
+		if (p)
+		{
+			r.assign(p->points.begin(), p->points.end());
+			delete p;
+		}
+	}
+}
+
+static double now_sec()
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// Simplify a ring on its way into a boolean, counting what it saved
+static void ring_simplify(ring_t & r, coord_t tol, struct polarity_stats & st)
+{
+	st.verts_in += r.size();
+	simplify_ring(r, tol);
+	st.verts_out += r.size();
+}
+
+// Outline of a clear object, ready to cut with. Returns its point count
+// before simplifying
+static unsigned int clear_outline(GerbObj * o, coord_t tol, struct polarity_stats & st, struct ring_cutter & c)
+{
+	obj_ring(o, c.ring);
+	ring_clean(c.ring);
+	unsigned int verts = c.ring.size();
+	ring_simplify(c.ring, tol, st);
+	if (c.ring.size() >= 3)
+		ring_cutter_prepare(c);
+	return verts;
+}
+
+static void ring_move(ring_t & r, coord_t dx, coord_t dy)
+{
+	for (unsigned int i=0; i < r.size(); i++)
+	{
+		r[i].x += dx;
+		r[i].y += dy;
+	}
+}
+
+/*
+ * Clearances are mostly round flashes of a few sizes. Each size is
+ * outlined once, centred on the origin, and the outline moved into
+ * place for every flash after that
+ */
+struct flash_outline {
+	struct ring_cutter c;
+	unsigned int verts;	// before simplifying
+};
+
+typedef std::map<coord_t, struct flash_outline> flash_cache_t;
+
+static void clear_flash_outline(GerbObj_Line * l, coord_t tol, struct polarity_stats & st,
+	flash_cache_t & cache, struct ring_cutter & c)
+{
+	flash_cache_t::iterator ci = cache.find(l->width);
+	if (ci == cache.end())
+	{
+		GerbObj_Line at0;
+		at0.sx = at0.sy = at0.ex = at0.ey = 0;
+		at0.width = l->width;
+		at0.lt = LT_STRAIGHT;
+		at0.lc = GerbObj_Line::LC_ROUND;
+		ci = cache.insert(std::make_pair(l->width, flash_outline())).first;
+		ci->second.verts = clear_outline(&at0, tol, st, ci->second.c);
+	} else {
+		st.verts_in += ci->second.verts;
+		st.verts_out += ci->second.c.ring.size();
+	}
+	
+	c = ci->second.c;
+	if (c.ring.size() < 3)
+		return;
+	ring_move(c.ring, l->sx, l->sy);
+	for (unsigned int i=0; i < c.parts.size(); i++)
+		ring_move(c.parts[i], l->sx, l->sy);
+	c.bounds = ring_bounds(c.ring);
+}
+
+/*
+ * Dark object in the index. Once cut, the outline is kept in ring and
+ * only written to the output polygon when composition is finished
+ */
+struct dark_frag {
+	std::list<sp_GerbObj>::iterator pos;
+	Rect bounds;
+	ring_t ring;
+	bool have_ring;
+	bool alive;
+};
+
+struct polarity_stats compose_polarity(Vector_Outp * v, double tile, coord_t tol)
+{
+	// Fragments are indexed by their position in frags, so candidates
+	// come back in the order they were made. A deque keeps references to
+	// them valid as pieces are added. Pours and pads go in at their own
+	// level
+	HierGrid<unsigned int> index((coord_t)tile);
+	std::deque<dark_frag> frags;
+	
+	// Reused by every clear object. The index changes while candidates
+	// are cut, so they are gathered first
+	std::vector<unsigned int> cands;
+	
+	polarity_stats st;
+	memset(&st, 0, sizeof(st));
+	
+	flash_cache_t flash_cache;
+	
+	// Nothing drawn after the last clear object can be cut, so it isn't
+	// indexed either
+	long left = 0;
+	std::list<sp_GerbObj>::iterator it = v->all.begin();
+	for (; it != v->all.end(); it++)
+		if ((*it)->clear)
+			left++;
+	
+	it = v->all.begin();
+	while (left && it != v->all.end())
+	{
+		GerbObj * o = (*it).get();
+		if (!o->clear)
+		{
+			dark_frag f;
+			f.pos = it;
+			f.bounds = o->getBounds();
+			f.have_ring = false;
+			f.alive = true;
+			frags.push_back(f);
+			index.insertbounded(f.bounds, frags.size() - 1);
+			++it;
+			continue;
+		}
+		
+		st.clear++;
+		left--;
+		
+		struct ring_cutter c;
+		GerbObj_Line * fl = dynamic_cast<GerbObj_Line *>(o);
+		if (fl && fl->sx == fl->ex && fl->sy == fl->ey && fl->lc == GerbObj_Line::LC_ROUND)
+			clear_flash_outline(fl, tol, st, flash_cache, c);
+		else
+			clear_outline(o, tol, st, c);
+		
+		// Clear objects leave nothing behind in the output
+		it = v->all.erase(it);
+		if (c.ring.size() < 3)
+			continue;
+		
+		cands.clear();
+		index.retrieve(c.bounds, std::back_inserter(cands));
+		std::sort(cands.begin(), cands.end());
+		for (unsigned int k=0; k < cands.size(); k++)
+		{
+			dark_frag * f = &frags[cands[k]];
+			if (!f->alive || !f->bounds.intersectsWith(c.bounds))
+				continue;
+			
+			if (!f->have_ring)
+			{
+				// An uncut line only needs an outline if its capsule
+				// reaches the clear object
+				GerbObj_Line * l = dynamic_cast<GerbObj_Line *>((*f->pos).get());
+				struct capsule cap;
+				if (l && line_capsule(l, cap) && !capsule_meets_ring(cap, &c.ring[0], c.ring.size()))
+				{
+					st.missed++;
+					continue;
+				}
+				
+				obj_ring((*f->pos).get(), f->ring);
+				ring_simplify(f->ring, tol, st);
+				f->have_ring = true;
+			}
+			if (f->ring.size() < 3)
+				continue;
+			
+			ring_list_t res;
+			double t0 = now_sec();
+			enum ring_cut_type cut = ring_subtract(f->ring, c, res);
+			st.bool_time += now_sec() - t0;
+			switch (cut)
+			{
+				case RING_CUT_NONE:
+					continue;
+				case RING_CUT_HOLE:
+					st.holes++;
+					break;
+				case RING_CUT_WALK:
+					st.walks++;
+					break;
+				case RING_CUT_HALFPLANE:
+					st.halfplane++;
+					break;
+				default:
+					break;
+			}
+			
+			st.cuts++;
+			
+			// Replace the fragment with what is left of it
+			ring_list_t pieces;
+			for (unsigned int i=0; i < res.size(); i++)
+				ring_split(res[i], tile, pieces);
+			
+			for (unsigned int i=0; i < pieces.size(); i++)
+			{
+				// Pushed empty, so the outline is swapped in rather than copied
+				frags.push_back(dark_frag());
+				dark_frag & nf = frags.back();
+				nf.pos = v->all.insert(f->pos, sp_GerbObj(new GerbObj_Poly()));
+				nf.ring.swap(pieces[i]);
+				nf.bounds = ring_bounds(nf.ring);
+				nf.have_ring = true;
+				nf.alive = true;
+				index.insertbounded(nf.bounds, frags.size() - 1);
+				st.pieces++;
+			}
+			
+			index.removebounded(f->bounds, cands[k]);
+			v->all.erase(f->pos);
+			f->alive = false;
+			f->ring.clear();
+		}
+	}
+	
+	// Write out the outlines of the cut fragments
+	std::deque<dark_frag>::iterator fi = frags.begin();
+	for (; fi != frags.end(); fi++)
+	{
+		if (!(*fi).alive || !(*fi).have_ring)
+			continue;
+		
+		GerbObj_Poly * p = dynamic_cast<GerbObj_Poly *>((*(*fi).pos).get());
+		if (!p || p->pointCount())
+		{
+			// Cut object that was already a polygon - outline unchanged
+			continue;
+		}
+		p->points.assign((*fi).ring.begin(), (*fi).ring.end());
+		p->pointsChanged();
+	}
+	
+	v->has_clear = false;
+	reindex_vector_outp(v);
+	
+	DBG_MSG_PF("Polarity: %ld clear objects, %ld cuts [%ld holes, %ld outline walks, %ld half-plane], %ld pieces, %ld lines missed",
+		st.clear, st.cuts, st.holes, st.walks, st.halfplane, st.pieces, st.missed);
+	DBG_MSG_PF("Polarity: simplified %ld -> %ld vertices, %.3fs in booleans", st.verts_in, st.verts_out, st.bool_time);
+	return st;
+}
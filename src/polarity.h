@@ -0,0 +1,56 @@
+/*
+ *  Portions Copyright 2006,2009 David Carne and 2007,2008 Spark Fun Electronics
+ *
+ *
+ *  This file is part of gerberDRC.
+ *
+ *  gerberDRC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gerberDRC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef _POLARITY_H_
+#define _POLARITY_H_
+
+#include "gcode_interp.h"
+#include "simplify.h"
+
+// Default tile size [2.54mm, in coord_t steps]. Large dark polygons are split into pieces no
+// smaller than this as clear objects are cut into them
+#define POLARITY_TILE (2540.0 * COORD_PER_UM)
+
+struct polarity_stats {
+	long clear;
+	long cuts;
+	long holes;
+	long walks;
+	long halfplane;
+	long pieces;
+	long missed;	// lines ruled out as capsules, never polygonized
+	long verts_in;	// outline vertices going into booleans, before
+	long verts_out;	// and after simplify_ring
+	double bool_time;	// seconds in ring_subtract
+};
+
+/*
+ * Resolve clear polarity objects [%LPC*%]. Each clear object is subtracted
+ * from the dark objects drawn before it whose bounds it overlaps, and is
+ * then removed from the layer. Dark objects that are cut become polygons.
+ *
+ * Outlines are simplified to within tol before they are cut [see
+ * simplify_ring], so the pieces are stored simplified too.
+ */
+struct polarity_stats compose_polarity(Vector_Outp * v, double tile = POLARITY_TILE, coord_t tol = SIMPLIFY_TOL);
+
+#endif
@@ -19,9 +19,16 @@
  *
  */
 
+#include <math.h>
+
 #include "polygonize.h"
+#include "capsule.h"
+#include "gerbobj_line.h"
+#include "gerbobj_poly.h"
+#include "main.h"
+
 #define maxsteps 64
-GerbObj_Poly * createPolyForLine(GerbObj_Line * l)
+GerbObj_Poly * createPolyForLine(GerbObj_Line * l, coord_t tol)
 {
 	double dx = l->sx - l->ex;
 	double dy = l->sy - l->ey;
@@ -36,17 +43,14 @@ GerbObj_Poly * createPolyForLine(GerbObj_Line * l)
 		
 	//RenderPoly * obj = new RenderPoly();
 
-	int nsteps = l->width * 1000;
-	if (nsteps > maxsteps)
-		nsteps = maxsteps;
-	if (nsteps < 2)
-		nsteps = 2;
+	int nsteps = arc_steps_for_tol(l->width / 2, tol, maxsteps);
 
 	// No polygon data for something with 0 width
 	if (l->width == 0)
 		return NULL;
 
 	GerbObj_Poly * p = new GerbObj_Poly();
+	p->points.reserve(2 * (nsteps + 1));
 
 	float theta = -M_PI/2;
 	float thetastep = M_PI / nsteps;
@@ -72,29 +76,30 @@ GerbObj_Poly * createPolyForLine(GerbObj_Line * l)
 
 	return p;
 }
-void polygonize_vector_outp(Vector_Outp * v)
+void polygonize_vector_outp(Vector_Outp * v, coord_t tol)
 {
-	std::set <GerbObj*>::iterator i = v->all.begin();
+	std::list<sp_GerbObj>::iterator i = v->all.begin();
 	int c = 0;
-	for (;i!=v->all.end();)
+	while (i!=v->all.end())
 	{
-		GerbObj_Line * line = dynamic_cast<GerbObj_Line*>(*i);
-		if (line)
-		{	
-			
-			// First, remove the line from the map
-			v->all.erase(i++);
-
-			// Create a polygon for the line [no end caps for now]
-			GerbObj_Poly * p = createPolyForLine(line);
-			if (p)
-				v->all.insert(p);
-			delete line;
-
-			c++;
-		} else {
+		GerbObj_Line * line = dynamic_cast<GerbObj_Line*>((*i).get());
+		if (!line)
+		{
 			++i;
+			continue;
+		}
+		
+		// Create a polygon for the line, and swap it in place of the line
+		GerbObj_Poly * p = createPolyForLine(line, tol);
+		if (p)
+		{
+			p->clear = line->clear;
+			*(i++) = sp_GerbObj(p);
+		} else {
+			i = v->all.erase(i);
 		}
+		c++;
 	}
-	printf("Removed %d lines from map\n", c);
+	reindex_vector_outp(v);
+	DBG_MSG_PF("Removed %d lines from map", c);
 }
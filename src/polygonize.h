@@ -26,6 +26,23 @@
 #include "util_type.h"
 
 
-void polygonize_vector_outp(Vector_Outp * v);
+class GerbObj_Poly;
+class GerbObj_Line;
+
+// Largest gap between a line's end arcs and the chords that replace them
+// [0.25um, in coord_t steps]
+#define POLY_TOL (COORD_PER_UM / 4)
+
+/*
+ * Polygon outline of a round capped line, with as few points on each end
+ * arc as keep the chords within tol of it. NULL for zero width lines.
+ *
+ * Lines are kept as lines otherwise [see capsule.h]; this is for the
+ * booleans that need an outline.
+ */
+GerbObj_Poly * createPolyForLine(GerbObj_Line * l, coord_t tol = POLY_TOL);
+
+// Replace every line in the layer with its outline
+void polygonize_vector_outp(Vector_Outp * v, coord_t tol = POLY_TOL);
 
 #endif
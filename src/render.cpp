@@ -0,0 +1,209 @@
+/*
+ *  Portions Copyright 2006,2009 David Carne and 2007,2008 Spark Fun Electronics
+ *
+ *
+ *  This file is part of gerberDRC.
+ *
+ *  gerberDRC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gerberDRC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "gcode_interp.h"
+#include "gerbobj.h"
+#include "render.h"
+#include "main.h"
+
+// Objects that only know how to make a RenderPoly [python subclasses]
+void GerbObj::appendRenderData(RenderLayer & l)
+{
+	RenderPoly * rp = createPolyData();
+	if (!rp)
+		return;
+	
+	struct render_span sp;
+	sp.first = l.segs.size();
+	sp.count = rp->segs.size();
+	sp.flag = rp->flag;
+	sp.fillptx = rp->fillptx;
+	sp.fillpty = rp->fillpty;
+	l.segs.insert(l.segs.end(), rp->segs.begin(), rp->segs.end());
+	l.polys.push_back(sp);
+	delete rp;
+}
+
+void render_vector_outp(Vector_Outp * v)
+{
+	RenderLayer & l = v->render;
+	l.clear();
+	
+	// Lines take 4 segments, polygons usually a few more
+	l.polys.reserve(v->all.size());
+	l.segs.reserve(v->all.size() * 6);
+	
+	std::list<sp_GerbObj>::iterator it = v->all.begin();
+	for (; it != v->all.end(); it++)
+		(*it)->appendRenderData(l);
+	
+	DBG_MSG_PF("Render data: %ld objects, %ld segments", (long)l.polys.size(), (long)l.segs.size());
+}
+
+
+RenderCache::RenderCache(long budget) :
+	m_budget(budget), m_bytes(0), m_hits(0), m_misses(0), m_evictions(0)
+{
+	pthread_mutex_init(&m_lock, NULL);
+}
+
+// Cached data belongs to the objects of one layer, so a copy starts empty
+RenderCache::RenderCache(const RenderCache & c) :
+	m_budget(c.m_budget), m_bytes(0), m_hits(0), m_misses(0), m_evictions(0)
+{
+	pthread_mutex_init(&m_lock, NULL);
+}
+
+RenderCache & RenderCache::operator=(const RenderCache & c)
+{
+	if (this == &c)
+		return *this;
+	
+	pthread_mutex_lock(&m_lock);
+	m_lru.clear();
+	m_index.clear();
+	m_budget = c.m_budget;
+	m_bytes = 0;
+	m_hits = m_misses = m_evictions = 0;
+	pthread_mutex_unlock(&m_lock);
+	return *this;
+}
+
+RenderCache::~RenderCache()
+{
+	pthread_mutex_destroy(&m_lock);
+}
+
+static long render_poly_bytes(const RenderPoly * rp)
+{
+	return sizeof(RenderPoly) + rp->segs.capacity() * sizeof(point_line);
+}
+
+sp_RenderPoly RenderCache::get(GerbObj * o)
+{
+	unsigned long serial = o->getSerial();
+	
+	pthread_mutex_lock(&m_lock);
+	index_t::iterator it = m_index.find(serial);
+	if (it != m_index.end())
+	{
+		m_lru.splice(m_lru.begin(), m_lru, it->second);
+		sp_RenderPoly rp = it->second->rp;
+		m_hits++;
+		pthread_mutex_unlock(&m_lock);
+		return rp;
+	}
+	m_misses++;
+	pthread_mutex_unlock(&m_lock);
+	
+	// Built unlocked, python objects can take a while
+	sp_RenderPoly rp = o->buildPolyData();
+	if (!rp)
+		return rp;
+	
+	struct entry e;
+	e.serial = serial;
+	e.rp = rp;
+	e.bytes = render_poly_bytes(rp.get());
+	
+	pthread_mutex_lock(&m_lock);
+	
+	// Another reader may have built it meanwhile, keep theirs
+	it = m_index.find(serial);
+	if (it != m_index.end())
+	{
+		m_lru.splice(m_lru.begin(), m_lru, it->second);
+		rp = it->second->rp;
+	} else {
+		m_lru.push_front(e);
+		m_index[serial] = m_lru.begin();
+		m_bytes += e.bytes;
+		evict();
+	}
+	pthread_mutex_unlock(&m_lock);
+	return rp;
+}
+
+// Call with m_lock held. The newest entry stays even if it alone is over
+// budget, so get() never has to build the same object twice in a row
+void RenderCache::evict()
+{
+	while (m_bytes > m_budget && m_lru.size() > 1)
+	{
+		struct entry & e = m_lru.back();
+		m_bytes -= e.bytes;
+		m_index.erase(e.serial);
+		m_lru.pop_back();
+		m_evictions++;
+	}
+}
+
+void RenderCache::setBudget(long budget)
+{
+	pthread_mutex_lock(&m_lock);
+	m_budget = budget;
+	evict();
+	pthread_mutex_unlock(&m_lock);
+}
+
+void RenderCache::clear()
+{
+	pthread_mutex_lock(&m_lock);
+	m_lru.clear();
+	m_index.clear();
+	m_bytes = 0;
+	pthread_mutex_unlock(&m_lock);
+}
+
+long RenderCache::getEntries() const
+{
+	pthread_mutex_lock(&m_lock);
+	long n = m_index.size();
+	pthread_mutex_unlock(&m_lock);
+	return n;
+}
+
+long RenderCache::locked(const long & v) const
+{
+	pthread_mutex_lock(&m_lock);
+	long n = v;
+	pthread_mutex_unlock(&m_lock);
+	return n;
+}
+
+void RenderCache::forget(GerbObj * o)
+{
+	pthread_mutex_lock(&m_lock);
+	index_t::iterator it = m_index.find(o->getSerial());
+	if (it != m_index.end())
+	{
+		m_bytes -= it->second->bytes;
+		m_lru.erase(it->second);
+		m_index.erase(it);
+	}
+	pthread_mutex_unlock(&m_lock);
+}
+
+RenderCache & object_render_cache()
+{
+	static RenderCache c;
+	return c;
+}
@@ -23,6 +23,13 @@
 #define _RENDER_H_
 
 #include <vector>
+#include <list>
+#include <utility>
+#include <tr1/unordered_map>
+#include <pthread.h>
+#include <boost/shared_ptr.hpp>
+
+class GerbObj;
 
 
 enum flagerr_t
@@ -33,6 +40,10 @@ enum flagerr_t
 	FLG_NO_OWNER=3,
 };
 
+/*
+ * Render output is what the python side draws, so unlike the layer
+ * objects it is in microns [see coord_to_um]
+ */
 struct point_line {
 	// Start coordinate, [optional center point for arc]
 	double x,y,cx,cy;
@@ -47,10 +58,14 @@ struct point_line {
 	enum line_render_type_t lt;
 };
 
+typedef std::vector<struct point_line> render_segs_t;
+
+// Outline of one object. The segments are held by value, in one buffer
 class RenderPoly {
 public:
+	RenderPoly() : r(0), g(0), b(0), flag(FLG_NONE), fillptx(0), fillpty(0), oid(-1) {};
 	
-	std::vector<struct point_line*> segs;
+	render_segs_t segs;
 	float r,g,b;
 	enum flagerr_t flag;
 	float fillptx, fillpty;
@@ -58,5 +73,101 @@ public:
 	
 };
 
+typedef boost::shared_ptr<RenderPoly> sp_RenderPoly;
+
+// Default RenderCache budget [bytes]
+#define RENDER_CACHE_BUDGET (64L << 20)
+
+/*
+ * Render data for a layer's objects, built on demand and kept within a
+ * byte budget. The least recently used entries go first. get() can be
+ * called from several threads; an evicted RenderPoly stays valid for
+ * whoever still holds it.
+ *
+ * Entries are keyed by GerbObj::getSerial, so an object freed by a later
+ * pass can't be confused with a new one at the same address. Its entry
+ * is just never hit again and ages out. An object changed in place takes
+ * a new serial [GerbObj::geometryChanged], and its old entry goes the
+ * same way.
+ */
+class RenderCache {
+public:
+	RenderCache(long budget = RENDER_CACHE_BUDGET);
+	RenderCache(const RenderCache & c);
+	RenderCache & operator=(const RenderCache & c);
+	~RenderCache();
+	
+	sp_RenderPoly get(GerbObj * o);
+	
+	// Evicts down to the new budget straight away
+	void setBudget(long budget);
+	void clear();
+	
+	// Drop o's entry, for an object that was changed in place
+	void forget(GerbObj * o);
+	
+	// Counters are read under the lock, get() may be running
+	long getBudget() const {return locked(m_budget);};
+	long getHits() const {return locked(m_hits);};
+	long getMisses() const {return locked(m_misses);};
+	long getEvictions() const {return locked(m_evictions);};
+	long getBytes() const {return locked(m_bytes);};
+	long getEntries() const;
+	
+private:
+	struct entry {
+		unsigned long serial;
+		sp_RenderPoly rp;
+		long bytes;
+	};
+	
+	// Most recently used at the front
+	typedef std::list<entry> lru_t;
+	typedef std::tr1::unordered_map<unsigned long, lru_t::iterator> index_t;
+	
+	void evict();
+	long locked(const long & v) const;
+	
+	mutable pthread_mutex_t m_lock;
+	lru_t m_lru;
+	index_t m_index;
+	
+	long m_budget;
+	long m_bytes;
+	long m_hits;
+	long m_misses;
+	long m_evictions;
+};
+
+/*
+ * Cache for GerbObj::getPolyData, for objects asked on their own rather
+ * than through their layer
+ */
+RenderCache & object_render_cache();
+
+// One object's outline in a RenderLayer: segs[first, first+count)
+struct render_span {
+	unsigned int first;
+	unsigned int count;
+	enum flagerr_t flag;
+	float fillptx, fillpty;
+};
+
+/*
+ * Render data for a whole layer, built in one pass. All of the outlines
+ * share a single segment buffer, in the order of the layer's objects
+ */
+class RenderLayer {
+public:
+	render_segs_t segs;
+	std::vector<struct render_span> polys;
+	
+	void clear()
+	{
+		render_segs_t().swap(segs);
+		std::vector<struct render_span>().swap(polys);
+	}
+};
+
 #endif
 
@@ -0,0 +1,768 @@
+/*
+ *  Portions Copyright 2006,2009 David Carne and 2007,2008 Spark Fun Electronics
+ *
+ *
+ *  This file is part of gerberDRC.
+ *
+ *  gerberDRC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gerberDRC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <math.h>
+#include <float.h>
+#include <vector>
+#include <algorithm>
+
+#include "ring.h"
+#include "bounds.h"
+#include "main.h"
+
+// Outlines with fewer edges than this test every pair for crossings,
+// it's cheaper than the sweep
+#define RING_SWEEP_MIN 32
+
+double pt_seg_dist(const Point & p, const Point & a, const Point & b)
+{
+	double dx = b.x - a.x, dy = b.y - a.y;
+	double l = dx * dx + dy * dy;
+	double t = l > 0 ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / l : 0;
+	t = fmax(0, fmin(1, t));
+	double ex = a.x + t * dx - p.x, ey = a.y + t * dy - p.y;
+	return sqrt(ex * ex + ey * ey);
+}
+
+static inline int sgn(coord_t v)
+{
+	return v > 0 ? 1 : v < 0 ? -1 : 0;
+}
+
+// p, known to be on the line through a and b, is between them
+static bool on_seg(const Point & p, const Point & a, const Point & b)
+{
+	return p.x >= (a.x < b.x ? a.x : b.x) && p.x <= (a.x > b.x ? a.x : b.x) &&
+		p.y >= (a.y < b.y ? a.y : b.y) && p.y <= (a.y > b.y ? a.y : b.y);
+}
+
+bool segs_cross(const Point & a, const Point & b, const Point & c, const Point & d)
+{
+	int d1 = sgn(side(c, d, a)), d2 = sgn(side(c, d, b));
+	int d3 = sgn(side(a, b, c)), d4 = sgn(side(a, b, d));
+	
+	if (d1 * d2 < 0 && d3 * d4 < 0)
+		return true;
+	
+	return (d1 == 0 && on_seg(a, c, d)) || (d2 == 0 && on_seg(b, c, d)) ||
+		(d3 == 0 && on_seg(c, a, b)) || (d4 == 0 && on_seg(d, a, b));
+}
+
+// Signed area, positive for counterclockwise
+double ring_area(const ring_t & r)
+{
+	double a = 0;
+	for (unsigned int i=0, j=r.size()-1; i < r.size(); j=i++)
+		a += (double)r[j].x * r[i].y - (double)r[i].x * r[j].y;
+	return a / 2;
+}
+
+Rect ring_bounds(const ring_t & r)
+{
+	Rect b;
+	for (unsigned int i=0; i < r.size(); i++)
+		b.mergePoint(r[i]);
+	return b;
+}
+
+void ring_clean(ring_t & r)
+{
+	ring_t out;
+	for (unsigned int i=0; i < r.size(); i++)
+	{
+		if (!out.empty() && fabs(r[i].x - out.back().x) < RING_MIN_EDGE && fabs(r[i].y - out.back().y) < RING_MIN_EDGE)
+			continue;
+		out.push_back(r[i]);
+	}
+	while (out.size() > 1 && fabs(out[0].x - out.back().x) < RING_MIN_EDGE && fabs(out[0].y - out.back().y) < RING_MIN_EDGE)
+		out.pop_back();
+	r.swap(out);
+}
+
+bool ring_convex(const ring_t & r)
+{
+	unsigned int n = r.size();
+	if (n < 3)
+		return false;
+	int turn = 0, xflips = 0, yflips = 0;
+	coord_t lastdx = 0, lastdy = 0;
+	for (unsigned int i=0; i <= n; i++)
+	{
+		const Point & a = r[i % n], & b = r[(i+1) % n], & c = r[(i+2) % n];
+		coord_t s = side(a, b, c);
+		if (s)
+		{
+			int t = s > 0 ? 1 : -1;
+			if (turn && t != turn)
+				return false;
+			turn = t;
+		}
+		
+		coord_t dx = b.x - a.x, dy = b.y - a.y;
+		if (dx)
+		{
+			if (lastdx && (dx > 0) != (lastdx > 0))
+				xflips++;
+			lastdx = dx;
+		}
+		if (dy)
+		{
+			if (lastdy && (dy > 0) != (lastdy > 0))
+				yflips++;
+			lastdy = dy;
+		}
+	}
+	return turn != 0 && xflips <= 2 && yflips <= 2;
+}
+
+// p strictly inside the segment a-b, off its ends
+static bool inside_seg(const Point & p, const Point & a, const Point & b)
+{
+	return side(a, b, p) == 0 && !same(p, a) && !same(p, b) && on_seg(p, a, b);
+}
+
+static double along(const Point & a, const Point & b, const Point & p)
+{
+	double dx = (double)(b.x - a.x), dy = (double)(b.y - a.y);
+	return ((double)(p.x - a.x) * dx + (double)(p.y - a.y) * dy) / (dx * dx + dy * dy);
+}
+
+long ring_find_nodes(const ring_t & r, std::vector<std::vector<edge_node> > & nodes)
+{
+	unsigned int n = r.size();
+	nodes.assign(n, std::vector<edge_node>());
+	
+	std::vector<bounds_pair_t> pairs;
+	if (n < RING_SWEEP_MIN)
+	{
+		for (unsigned int i=0; i < n; i++)
+			for (unsigned int j=i + 1; j < n; j++)
+				pairs.push_back(bounds_pair_t(i, j));
+	} else {
+		BoundsTable bt;
+		for (unsigned int i=0; i < n; i++)
+			bt.append(NULL, Rect(r[i].x, r[i].y, r[(i+1) % n].x, r[(i+1) % n].y));
+		bt.overlapping_pairs(0, pairs);
+	}
+	
+	long found = 0;
+	for (unsigned int k=0; k < pairs.size(); k++)
+	{
+		unsigned int i = pairs[k].first, j = pairs[k].second;
+		const Point & a = r[i], & b = r[(i+1) % n];
+		const Point & c = r[j], & d = r[(j+1) % n];
+		
+		coord_t d1 = side(c, d, a), d2 = side(c, d, b);
+		coord_t d3 = side(a, b, c), d4 = side(a, b, d);
+		if (sgn(d1) * sgn(d2) < 0 && sgn(d3) * sgn(d4) < 0)
+		{
+			// Proper crossing, the same rounded point goes in both
+			double t = (double)d1 / (double)(d1 - d2);
+			edge_node e;
+			e.p = Point(a.x + t * (b.x - a.x), a.y + t * (b.y - a.y));
+			e.t = t;
+			nodes[i].push_back(e);
+			e.t = along(c, d, e.p);
+			nodes[j].push_back(e);
+			found++;
+			continue;
+		}
+		
+		// Ends lying on the other edge [touches, overlaps]
+		const Point * ends[4] = {&c, &d, &a, &b};
+		for (int m=0; m < 4; m++)
+		{
+			unsigned int into = m < 2 ? i : j;
+			const Point & s = m < 2 ? a : c, & e2 = m < 2 ? b : d;
+			if (inside_seg(*ends[m], s, e2))
+			{
+				edge_node e;
+				e.p = *ends[m];
+				e.t = along(s, e2, e.p);
+				nodes[into].push_back(e);
+				found++;
+			}
+		}
+		
+		// Shared vertices of edges that aren't neighbours
+		if (j != (i + 1) % n && i != (j + 1) % n &&
+			(same(a, c) || same(a, d) || same(b, c) || same(b, d)))
+			found++;
+	}
+	return found;
+}
+
+long ring_crossings(const ring_t & r)
+{
+	if (r.size() < 4 || ring_convex(r))
+		return 0;
+	std::vector<std::vector<edge_node> > nodes;
+	return ring_find_nodes(r, nodes);
+}
+
+// Ring must be counterclockwise. Polygonized arcs wobble a little, so
+// slightly concave corners are allowed
+static bool ring_is_convex(const ring_t & r)
+{
+	Rect b = ring_bounds(r);
+	double tol = -1e-9 * ((double)b.getWidth() * b.getWidth() + (double)b.getHeight() * b.getHeight());
+	
+	unsigned int n = r.size();
+	for (unsigned int i=0; i < n; i++)
+		if (side(r[i], r[(i+1)%n], r[(i+2)%n]) < tol)
+			return false;
+	return true;
+}
+
+// Even-odd rule
+bool point_in_ring(const ring_t & r, const Point & p)
+{
+	bool in = false;
+	for (unsigned int i=0, j=r.size()-1; i < r.size(); j=i++)
+	{
+		const Point & a = r[j];
+		const Point & b = r[i];
+		if ((a.y > p.y) != (b.y > p.y) &&
+			p.x < a.x + (double)(p.y - a.y) * (b.x - a.x) / (b.y - a.y))
+			in = !in;
+	}
+	return in;
+}
+
+// Any proper crossing between the edges of d and c
+static bool rings_cross(const ring_t & d, const ring_t & c, const Rect & cb)
+{
+	for (unsigned int i=0, j=d.size()-1; i < d.size(); j=i++)
+	{
+		const Point & a = d[j];
+		const Point & b = d[i];
+		
+		// Only edges near c can cross it
+		if (fmax(a.x, b.x) < cb.getStartPoint().x || fmin(a.x, b.x) > cb.getEndPoint().x ||
+			fmax(a.y, b.y) < cb.getStartPoint().y || fmin(a.y, b.y) > cb.getEndPoint().y)
+			continue;
+		
+		for (unsigned int k=0, l=c.size()-1; k < c.size(); l=k++)
+		{
+			double s1 = side(a, b, c[l]);
+			double s2 = side(a, b, c[k]);
+			if (!(s1 < 0 && s2 > 0) && !(s1 > 0 && s2 < 0))
+				continue;
+			
+			double s3 = side(c[l], c[k], a);
+			double s4 = side(c[l], c[k], b);
+			if ((s3 < 0 && s4 > 0) || (s3 > 0 && s4 < 0))
+				return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * A vertex of one outline on [or very near] the other. Outlines can
+ * touch or share edges without crossing, and then one point of each
+ * doesn't say how they overlap
+ */
+static bool rings_touch(const ring_t & d, const ring_t & c, const Rect & cb)
+{
+	Rect near = cb;
+	near.feather(RING_MIN_EDGE);
+	for (unsigned int i=0, j=d.size()-1; i < d.size(); j=i++)
+	{
+		const Point & a = d[j];
+		const Point & b = d[i];
+		if (fmax(a.x, b.x) < near.getStartPoint().x || fmin(a.x, b.x) > near.getEndPoint().x ||
+			fmax(a.y, b.y) < near.getStartPoint().y || fmin(a.y, b.y) > near.getEndPoint().y)
+			continue;
+		
+		for (unsigned int k=0, l=c.size()-1; k < c.size(); l=k++)
+			if (pt_seg_dist(c[k], a, b) < RING_MIN_EDGE || pt_seg_dist(b, c[l], c[k]) < RING_MIN_EDGE)
+				return true;
+	}
+	return false;
+}
+
+void clip_halfplane(const ring_t & in, const Point & a, const Point & b, bool outside, ring_t & out)
+{
+	out.clear();
+	if (in.empty())
+		return;
+	
+	const Point * prev = &in[in.size()-1];
+	double sp = side(a, b, *prev);
+	if (outside)
+		sp = -sp;
+	
+	for (unsigned int i=0; i < in.size(); i++)
+	{
+		const Point & cur = in[i];
+		double sc = side(a, b, cur);
+		if (outside)
+			sc = -sc;
+		
+		if ((sp < 0 && sc > 0) || (sp > 0 && sc < 0))
+		{
+			double t = sp / (sp - sc);
+			out.push_back(Point(prev->x + t * (cur.x - prev->x), prev->y + t * (cur.y - prev->y)));
+		}
+		
+		if (sc >= 0)
+			out.push_back(cur);
+		
+		prev = &cur;
+		sp = sc;
+	}
+	
+	if (out.size() < 3)
+		out.clear();
+}
+
+bool ring_keyhole(ring_t & d, const ring_t & c)
+{
+	unsigned int n = c.size();
+	unsigned int pi = 0;
+	for (unsigned int i=1; i < n; i++)
+		if (c[i].x > c[pi].x)
+			pi = i;
+	const Point & p = c[pi];
+	
+	int best = -1;
+	double bx = DBL_MAX;
+	for (unsigned int i=0; i < d.size(); i++)
+	{
+		const Point & a = d[i];
+		const Point & b = d[(i+1) % d.size()];
+		if ((a.y > p.y) != (b.y > p.y))
+		{
+			double x = a.x + (double)(p.y - a.y) * (b.x - a.x) / (b.y - a.y);
+			if (x >= p.x && x < bx)
+			{
+				bx = x;
+				best = i;
+			}
+		}
+	}
+	
+	if (best < 0)
+		return false;
+	
+	Point q(bx, p.y);
+	
+	// The hole has to wind the other way round
+	bool reverse = (ring_area(c) > 0) == (ring_area(d) > 0);
+	
+	ring_t out;
+	out.reserve(d.size() + n + 3);
+	out.insert(out.end(), d.begin(), d.begin() + best + 1);
+	out.push_back(q);
+	for (unsigned int j=0; j < n; j++)
+		out.push_back(c[reverse ? (pi + n - j) % n : (pi + j) % n]);
+	out.push_back(p);
+	out.push_back(q);
+	out.insert(out.end(), d.begin() + best + 1, d.end());
+	
+	d.swap(out);
+	return true;
+}
+
+// d minus the convex, counterclockwise c. The part of d inside c is
+// left in inside, if given
+static void ring_subtract_convex(const ring_t & d, const ring_t & c, ring_list_t & out, ring_t * inside = NULL)
+{
+	ring_t rest = d;
+	ring_t piece, next;
+	
+	for (unsigned int i=0; i < c.size(); i++)
+	{
+		const Point & a = c[i];
+		const Point & b = c[(i+1) % c.size()];
+		if (fabs(a.x - b.x) < RING_MIN_EDGE && fabs(a.y - b.y) < RING_MIN_EDGE)
+			continue;
+		
+		clip_halfplane(rest, a, b, true, piece);
+		if (fabs(ring_area(piece)) > RING_MIN_AREA)
+			out.push_back(piece);
+		
+		clip_halfplane(rest, a, b, false, next);
+		rest.swap(next);
+		if (fabs(ring_area(rest)) <= RING_MIN_AREA)
+		{
+			rest.clear();
+			break;
+		}
+	}
+	
+	if (inside)
+		inside->swap(rest);
+}
+
+// Ear clipping. c must be counterclockwise
+static void ring_triangulate(const ring_t & c, ring_list_t & out)
+{
+	std::vector<unsigned int> idx;
+	for (unsigned int i=0; i < c.size(); i++)
+		idx.push_back(i);
+	
+	unsigned int i = 0, misses = 0;
+	while (idx.size() > 3)
+	{
+		unsigned int m = idx.size();
+		i %= m;
+		const Point & a = c[idx[(i + m - 1) % m]];
+		const Point & b = c[idx[i]];
+		const Point & e = c[idx[(i + 1) % m]];
+		
+		double s = side(a, b, e);
+		bool ear = s >= 0;
+		for (unsigned int j=0; ear && j < m; j++)
+		{
+			const Point & p = c[idx[j]];
+			if ((p.x == a.x && p.y == a.y) || (p.x == b.x && p.y == b.y) || (p.x == e.x && p.y == e.y))
+				continue;
+			if (side(a, b, p) >= 0 && side(b, e, p) >= 0 && side(e, a, p) >= 0)
+				ear = false;
+		}
+		
+		if (!ear)
+		{
+			i++;
+			if (++misses > m)
+			{
+				DBG_WARN_PF("Could not triangulate clear polygon, %d points left", m);
+				return;
+			}
+			continue;
+		}
+		
+		// Collinear points are just dropped
+		if (s > 0)
+		{
+			ring_t t;
+			t.push_back(a);
+			t.push_back(b);
+			t.push_back(e);
+			out.push_back(t);
+		}
+		idx.erase(idx.begin() + i);
+		misses = 0;
+	}
+	
+	ring_t t;
+	for (unsigned int j=0; j < idx.size(); j++)
+		t.push_back(c[idx[j]]);
+	if (ring_area(t) > 0)
+		out.push_back(t);
+}
+
+/*
+ * Crossing between an edge of d and an edge of c. t and u are the
+ * positions along the two edges
+ */
+struct ring_event {
+	unsigned int di;
+	double t;
+	unsigned int ci;
+	double u;
+	Point p;
+	bool leaves;	// c goes from the inside of d to the outside
+	
+	int next_c;		// previous event going backwards round c
+	bool done;
+};
+
+struct event_d_order {
+	const std::vector<ring_event> * ev;
+	bool operator()(int a, int b) const
+	{
+		const ring_event & ea = (*ev)[a], & eb = (*ev)[b];
+		return ea.di < eb.di || (ea.di == eb.di && ea.t < eb.t);
+	}
+};
+
+struct event_c_order {
+	const std::vector<ring_event> * ev;
+	bool operator()(int a, int b) const
+	{
+		const ring_event & ea = (*ev)[a], & eb = (*ev)[b];
+		return ea.ci < eb.ci || (ea.ci == eb.ci && ea.u < eb.u);
+	}
+};
+
+/*
+ * d minus c by walking the two outlines [Weiler-Atherton], for c crossing
+ * the outline of d. Both rings must be counterclockwise. The outside of c
+ * follows d forwards, and where d enters c the outline continues
+ * backwards round c until d comes out again.
+ *
+ * Only handles outlines in general position - returns false if a vertex
+ * of one lies on [or very near] the other, and the caller cuts by
+ * half-planes instead
+ */
+static bool ring_subtract_walk(const ring_t & d, const ring_t & c, const Rect & cb, ring_list_t & out)
+{
+	std::vector<ring_event> ev;
+	unsigned int nd = d.size(), nc = c.size();
+	
+	for (unsigned int i=0; i < nd; i++)
+	{
+		const Point & a = d[i];
+		const Point & b = d[(i+1) % nd];
+		
+		if (fmax(a.x, b.x) < cb.getStartPoint().x || fmin(a.x, b.x) > cb.getEndPoint().x ||
+			fmax(a.y, b.y) < cb.getStartPoint().y || fmin(a.y, b.y) > cb.getEndPoint().y)
+			continue;
+		
+		for (unsigned int j=0; j < nc; j++)
+		{
+			const Point & p = c[j];
+			const Point & q = c[(j+1) % nc];
+			
+			if (pt_seg_dist(a, p, q) < RING_MIN_EDGE || pt_seg_dist(p, a, b) < RING_MIN_EDGE)
+				return false;
+			
+			double s1 = side(a, b, p);
+			double s2 = side(a, b, q);
+			if (!(s1 < 0 && s2 > 0) && !(s1 > 0 && s2 < 0))
+				continue;
+			double s3 = side(p, q, a);
+			double s4 = side(p, q, b);
+			if (!(s3 < 0 && s4 > 0) && !(s3 > 0 && s4 < 0))
+				continue;
+			
+			ring_event e;
+			e.di = i;
+			e.t = s3 / (s3 - s4);
+			e.ci = j;
+			e.u = s1 / (s1 - s2);
+			e.p = Point(a.x + e.t * (b.x - a.x), a.y + e.t * (b.y - a.y));
+			e.leaves = s1 > 0;
+			e.done = false;
+			ev.push_back(e);
+		}
+	}
+	
+	if (ev.size() < 2 || (ev.size() & 1))
+		return false;
+	
+	std::vector<int> dord, cord;
+	for (unsigned int i=0; i < ev.size(); i++)
+	{
+		dord.push_back(i);
+		cord.push_back(i);
+	}
+	event_d_order dcmp;
+	dcmp.ev = &ev;
+	std::sort(dord.begin(), dord.end(), dcmp);
+	event_c_order ccmp;
+	ccmp.ev = &ev;
+	std::sort(cord.begin(), cord.end(), ccmp);
+	
+	// Position of each event along d
+	std::vector<int> dpos(ev.size());
+	for (unsigned int i=0; i < dord.size(); i++)
+		dpos[dord[i]] = i;
+	
+	// Crossings alternate between entering and leaving c along d. Event
+	// k [in d order] is an exit if it has the parity of the first exit
+	int exit_parity = point_in_ring(c, d[0]) ? 0 : 1;
+	
+	// They alternate along c as well. c crossing a keyhole bridge crosses
+	// two coincident edges of d at once. Between them is the zero width
+	// gap outside d, so c first leaves d and then comes back in
+	unsigned int nev = cord.size();
+	for (unsigned int i=0; i < nev; i++)
+	{
+		const ring_event & a = ev[cord[i]];
+		const ring_event & b = ev[cord[(i+1) % nev]];
+		if (fabs(a.p.x - b.p.x) < RING_MIN_EDGE && fabs(a.p.y - b.p.y) < RING_MIN_EDGE &&
+			!a.leaves && b.leaves)
+			std::swap(cord[i], cord[(i+1) % nev]);
+	}
+	for (unsigned int i=0; i < nev; i++)
+		if ((dpos[cord[i]] & 1) == (dpos[cord[(i+1) % nev]] & 1))
+			return false;
+	
+	// The event before each one, going backwards round c
+	for (unsigned int i=0; i < nev; i++)
+		ev[cord[i]].next_c = cord[(i + nev - 1) % nev];
+	
+	for (unsigned int k=0; k < dord.size(); k++)
+	{
+		if ((int)(k & 1) != exit_parity || ev[dord[k]].done)
+			continue;
+		
+		ring_t r;
+		int cur = dord[k];
+		unsigned int guard = 0;
+		while (!ev[cur].done)
+		{
+			if (++guard > ev.size())
+				return false;
+			
+			// cur is an exit - follow d to the next entry
+			ring_event & ex = ev[cur];
+			ex.done = true;
+			r.push_back(ex.p);
+			
+			int en = dord[(dpos[cur] + 1) % dord.size()];
+			ring_event & ent = ev[en];
+			unsigned int i = ex.di;
+			if (ent.di != ex.di || ent.t < ex.t)
+			{
+				do {
+					i = (i + 1) % nd;
+					r.push_back(d[i]);
+				} while (i != ent.di);
+			}
+			ent.done = true;
+			r.push_back(ent.p);
+			
+			// Then backwards round c to the previous crossing, which has
+			// to be an exit
+			int nx = ent.next_c;
+			if ((int)(dpos[nx] & 1) != exit_parity)
+				return false;
+			
+			ring_event & nxe = ev[nx];
+			unsigned int j = ent.ci;
+			if (nxe.ci != ent.ci || nxe.u > ent.u)
+			{
+				r.push_back(c[j]);
+				while (j != (nxe.ci + 1) % nc)
+				{
+					j = (j + nc - 1) % nc;
+					r.push_back(c[j]);
+				}
+			}
+			
+			cur = nx;
+		}
+		
+		if (fabs(ring_area(r)) > RING_MIN_AREA)
+			out.push_back(r);
+	}
+	
+	return true;
+}
+
+void ring_cutter_prepare(struct ring_cutter & c)
+{
+	c.parts.clear();
+	if (ring_area(c.ring) < 0)
+		std::reverse(c.ring.begin(), c.ring.end());
+	c.bounds = ring_bounds(c.ring);
+	c.convex = ring_is_convex(c.ring);
+	if (!c.convex)
+		ring_triangulate(c.ring, c.parts);
+}
+
+enum ring_cut_type ring_subtract(const ring_t & d, const struct ring_cutter & c, ring_list_t & out)
+{
+	// If the outlines don't cross or touch, one point of each tells
+	// whether c is inside d, d inside c, or neither
+	if (!rings_cross(d, c.ring, c.bounds) && !rings_touch(d, c.ring, c.bounds))
+	{
+		if (point_in_ring(d, c.ring[0]))
+		{
+			ring_t r = d;
+			if (ring_keyhole(r, c.ring))
+			{
+				out.push_back(r);
+				return RING_CUT_HOLE;
+			}
+		} else if (point_in_ring(c.ring, d[0])) {
+			return RING_CUT_ALL;
+		} else {
+			return RING_CUT_NONE;
+		}
+	}
+	
+	// Most cuts only clip the outline of d, and the outlines can be walked
+	ring_list_t walked;
+	ring_t rd;
+	if (ring_area(d) > 0)
+		rd = d;
+	else
+		rd.assign(d.rbegin(), d.rend());
+	
+	bool ok = ring_subtract_walk(rd, c.ring, c.bounds, walked);
+	if (!ok)
+	{
+		// A vertex sits on the other outline. Moving c a few hundredths
+		// of a micron is far below the file resolution, and usually
+		// gets it clear
+		walked.clear();
+		ring_t moved = c.ring;
+		for (unsigned int i=0; i < moved.size(); i++)
+		{
+			moved[i].x += 3 * RING_MIN_EDGE;
+			moved[i].y += 2 * RING_MIN_EDGE;
+		}
+		Rect mb = c.bounds;
+		mb.feather(4 * RING_MIN_EDGE);
+		ok = ring_subtract_walk(rd, moved, mb, walked);
+	}
+	if (ok)
+	{
+		out.insert(out.end(), walked.begin(), walked.end());
+		return RING_CUT_WALK;
+	}
+	
+	// Cut d along the bounds of c first. Cutting by the edges of c gives
+	// one piece per edge, and this keeps those pieces inside the bounds
+	Rect b = c.bounds;
+	b.feather(COORD_PER_UM);
+	ring_t box;
+	box.push_back(b.getStartPoint());
+	box.push_back(b.getCWP1());
+	box.push_back(b.getEndPoint());
+	box.push_back(b.getCWP2());
+	
+	ring_t near;
+	ring_subtract_convex(d, box, out, &near);
+	if (near.empty())
+		return RING_CUT_HALFPLANE;
+	
+	if (c.convex)
+	{
+		ring_subtract_convex(near, c.ring, out);
+		return RING_CUT_HALFPLANE;
+	}
+	
+	ring_list_t cur(1, near);
+	for (unsigned int i=0; i < c.parts.size(); i++)
+	{
+		Rect pb = ring_bounds(c.parts[i]);
+		ring_list_t next;
+		for (unsigned int j=0; j < cur.size(); j++)
+		{
+			if (!ring_bounds(cur[j]).intersectsWith(pb))
+				next.push_back(cur[j]);
+			else
+				ring_subtract_convex(cur[j], c.parts[i], next);
+		}
+		cur.swap(next);
+	}
+	out.insert(out.end(), cur.begin(), cur.end());
+	return RING_CUT_HALFPLANE;
+}
+
@@ -0,0 +1,149 @@
+/*
+ *  Portions Copyright 2006,2009 David Carne and 2007,2008 Spark Fun Electronics
+ *
+ *
+ *  This file is part of gerberDRC.
+ *
+ *  gerberDRC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gerberDRC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef _RING_H_
+#define _RING_H_
+
+#include <vector>
+
+#include "util_type.h"
+
+/*
+ * Closed outlines as plain point vectors, for the passes that cut and
+ * rebuild polygons. The last point joins back to the first; it isn't
+ * repeated.
+ */
+typedef std::vector<Point> ring_t;
+typedef std::vector<ring_t> ring_list_t;
+
+// Slivers smaller than this [1e-3 um^2] are dropped by the cuts
+#define RING_MIN_AREA (1e-3 * COORD_PER_UM * COORD_PER_UM)
+
+// Points closer than this [1e-2 um] are merged
+#define RING_MIN_EDGE (COORD_PER_UM / 100)
+
+// Cross product of a->b and a->p, positive when p is left of a->b. Exact
+// on the grid, as long as the points are less than about 3e9 steps apart
+static inline coord_t side(const Point & a, const Point & b, const Point & p)
+{
+	return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+}
+
+static inline bool same(const Point & a, const Point & b)
+{
+	return a.x == b.x && a.y == b.y;
+}
+
+// Distance from p to the segment a-b
+double pt_seg_dist(const Point & p, const Point & a, const Point & b);
+
+// The closed segments a-b and c-d share a point. Exact on the grid
+bool segs_cross(const Point & a, const Point & b, const Point & c, const Point & d);
+
+// Signed area, positive for counterclockwise
+double ring_area(const ring_t & r);
+
+Rect ring_bounds(const ring_t & r);
+
+// Even-odd rule
+bool point_in_ring(const ring_t & r, const Point & p);
+
+/*
+ * True if r turns the same way at every corner and goes round once
+ * [x and y each change direction no more than twice], so it can't cross
+ * itself. Either way round; repeated and collinear points are allowed
+ */
+bool ring_convex(const ring_t & r);
+
+// A place on an edge where another edge crosses or touches it
+struct edge_node {
+	double t;		// along the edge, 0 at its start
+	Point p;
+	bool operator<(const edge_node & o) const {return t < o.t;};
+};
+
+/*
+ * Put a node in each edge of r wherever another edge crosses or touches
+ * it. Edges whose boxes meet are found with a BoundsTable sweep. Returns
+ * the number of places found
+ */
+long ring_find_nodes(const ring_t & r, std::vector<std::vector<edge_node> > & nodes);
+
+// Places where edges of r cross or touch, other than neighbouring edges
+// meeting at their shared point. 0 for a simple outline
+long ring_crossings(const ring_t & r);
+
+/*
+ * Drop points that [nearly] repeat the previous one. A very short edge
+ * can point the wrong way, and cutting along it would throw away the
+ * whole outline
+ */
+void ring_clean(ring_t & r);
+
+/*
+ * Cut c out of d, where c lies inside d. The hole is joined to the
+ * outline by a bridge from the rightmost point of c to the nearest edge
+ * of d to its right, so nothing is crossed
+ */
+bool ring_keyhole(ring_t & d, const ring_t & c);
+
+// Sutherland-Hodgman against the line a->b. Keeps the left side, or the
+// right side if outside is set
+void clip_halfplane(const ring_t & in, const Point & a, const Point & b, bool outside, ring_t & out);
+
+/*
+ * An outline to cut others with. Set ring, then ring_cutter_prepare
+ * turns it counterclockwise and fills in the rest; outlines that aren't
+ * convex are also kept as convex parts for the general cut
+ */
+struct ring_cutter {
+	ring_t ring;
+	Rect bounds;
+	bool convex;
+	ring_list_t parts;
+};
+
+void ring_cutter_prepare(struct ring_cutter & c);
+
+// How ring_subtract went about a cut
+enum ring_cut_type {
+	RING_CUT_NONE,		// c doesn't touch d, out is left alone
+	RING_CUT_ALL,		// d lies inside c, nothing is left
+	RING_CUT_HOLE,		// c lies inside d, keyholed in
+	RING_CUT_WALK,		// outlines cross, walked round
+	RING_CUT_HALFPLANE	// too close to walk, cut by half-planes
+};
+
+/*
+ * d minus c, appended to out:
+ *
+ *  - c inside d: d gets a hole, joined to the outline by a zero width
+ *    bridge [keyhole]
+ *  - outlines cross: the two outlines are walked to find what is left
+ *  - outlines too close to walk [vertex on the other outline]: d is cut
+ *    by each edge of c in turn, keeping the part outside of that edge.
+ *    Non-convex c is cut by its convex parts. Correct, but gives a piece
+ *    per edge.
+ */
+enum ring_cut_type ring_subtract(const ring_t & d, const struct ring_cutter & c, ring_list_t & out);
+
+#endif
@@ -0,0 +1,180 @@
+/*
+ *  Portions Copyright 2006,2009 David Carne and 2007,2008 Spark Fun Electronics
+ *
+ *
+ *  This file is part of gerberDRC.
+ *
+ *  gerberDRC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gerberDRC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <math.h>
+#include <limits.h>
+#include <algorithm>
+
+#include "rtree.h"
+#include "main.h"
+
+// One level's worth of boxes, before they are packed into nodes
+struct str_level {
+	std::vector<coord_t> x0, y0, x1, y1;
+	std::vector<unsigned int> ref;
+	
+	unsigned int size() const {return ref.size();};
+	void push(coord_t ax0, coord_t ay0, coord_t ax1, coord_t ay1, unsigned int r)
+	{
+		x0.push_back(ax0);
+		y0.push_back(ay0);
+		x1.push_back(ax1);
+		y1.push_back(ay1);
+		ref.push_back(r);
+	}
+};
+
+// Orders entries of a level by the centre of their box on one axis. The
+// sums are halved first so they cannot overflow
+struct str_centre_lt {
+	const coord_t * lo;
+	const coord_t * hi;
+	bool operator()(unsigned int a, unsigned int b) const
+	{
+		coord_t ca = lo[a] / 2 + hi[a] / 2, cb = lo[b] / 2 + hi[b] / 2;
+		return ca < cb || (ca == cb && a < b);
+	}
+};
+
+/*
+ * Pack the entries of l into nodes, appending their slots to the tree, and
+ * return the nodes' boxes as the entries of the level above
+ */
+static void str_pack(const str_level & l, PackedRTree & t, str_level & up)
+{
+	unsigned int n = l.size();
+	unsigned int nodes = (n + RTREE_FANOUT - 1) / RTREE_FANOUT;
+	unsigned int slices = (unsigned int)ceil(sqrt((double)nodes));
+	unsigned int per_slice = slices * RTREE_FANOUT;
+	
+	std::vector<unsigned int> order(n);
+	for (unsigned int i=0; i < n; i++)
+		order[i] = i;
+	
+	struct str_centre_lt by_x = {&l.x0[0], &l.x1[0]};
+	struct str_centre_lt by_y = {&l.y0[0], &l.y1[0]};
+	std::sort(order.begin(), order.end(), by_x);
+	for (unsigned int s=0; s < n; s += per_slice)
+		std::sort(order.begin() + s, order.begin() + std::min(n, s + per_slice), by_y);
+	
+	t.first.push_back(t.ref.size());
+	up = str_level();
+	for (unsigned int s=0; s < n; s += per_slice)
+	{
+		unsigned int slice_end = std::min(n, s + per_slice);
+		for (unsigned int g=s; g < slice_end; g += RTREE_FANOUT)
+		{
+			coord_t bx0 = LLONG_MAX, by0 = LLONG_MAX, bx1 = LLONG_MIN, by1 = LLONG_MIN;
+			for (unsigned int k=0; k < RTREE_FANOUT; k++)
+			{
+				if (g + k < slice_end)
+				{
+					unsigned int i = order[g + k];
+					t.minx.push_back(l.x0[i]);
+					t.miny.push_back(l.y0[i]);
+					t.maxx.push_back(l.x1[i]);
+					t.maxy.push_back(l.y1[i]);
+					t.ref.push_back(l.ref[i]);
+					bx0 = std::min(bx0, l.x0[i]);
+					by0 = std::min(by0, l.y0[i]);
+					bx1 = std::max(bx1, l.x1[i]);
+					by1 = std::max(by1, l.y1[i]);
+				}
+				else
+				{
+					t.minx.push_back(LLONG_MAX);
+					t.miny.push_back(LLONG_MAX);
+					t.maxx.push_back(LLONG_MIN);
+					t.maxy.push_back(LLONG_MIN);
+					t.ref.push_back(0);
+				}
+			}
+			up.push(bx0, by0, bx1, by1, up.size());
+		}
+	}
+}
+
+void PackedRTree::build(const BoundsTable & t)
+{
+	clear();
+	m_table = &t;
+	
+	str_level l;
+	for (unsigned int i=0; i < t.size(); i++)
+		if (t.minx[i] <= t.maxx[i] && t.miny[i] <= t.maxy[i])
+			l.push(t.minx[i], t.miny[i], t.maxx[i], t.maxy[i], i);
+	if (l.size() == 0)
+		return;
+	
+	// About n / 15 inner slots on top of the padded leaves
+	long leaves = ((long)l.size() + RTREE_FANOUT - 1) / RTREE_FANOUT * RTREE_FANOUT;
+	long total = leaves + leaves / (RTREE_FANOUT - 1) + 2 * RTREE_FANOUT;
+	minx.reserve(total);
+	miny.reserve(total);
+	maxx.reserve(total);
+	maxy.reserve(total);
+	ref.reserve(total);
+	
+	// Down to a single root node, which is the last level
+	str_level up;
+	do
+	{
+		str_pack(l, *this, up);
+		l.x0.swap(up.x0);
+		l.y0.swap(up.y0);
+		l.x1.swap(up.x1);
+		l.y1.swap(up.y1);
+		l.ref.swap(up.ref);
+	} while (l.size() > 1);
+	
+	DBG_MSG_PF("R-tree: %u objects, %d levels, %ld slots", t.size(), levels(), slots());
+}
+
+void PackedRTree::clear()
+{
+	m_table = NULL;
+	std::vector<coord_t>().swap(minx);
+	std::vector<coord_t>().swap(miny);
+	std::vector<coord_t>().swap(maxx);
+	std::vector<coord_t>().swap(maxy);
+	std::vector<unsigned int>().swap(ref);
+	std::vector<unsigned int>().swap(first);
+}
+
+// Collects what a visit reports
+struct rtree_collect {
+	std::vector<unsigned int> * out;
+	void operator()(unsigned int i) {out->push_back(i);};
+};
+
+void PackedRTree::query(const Rect & r, std::vector<unsigned int> & out) const
+{
+	out.clear();
+	struct rtree_collect c = {&out};
+	visit(r, c);
+	std::sort(out.begin(), out.end());
+}
+
+long PackedRTree::bytes() const
+{
+	return sizeof(*this) + (minx.capacity() + miny.capacity() + maxx.capacity() + maxy.capacity()) * sizeof(coord_t)
+		+ (ref.capacity() + first.capacity()) * sizeof(unsigned int);
+}
@@ -0,0 +1,300 @@
+/*
+ *  Portions Copyright 2006,2009 David Carne and 2007,2008 Spark Fun Electronics
+ *
+ *
+ *  This file is part of gerberDRC.
+ *
+ *  gerberDRC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gerberDRC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef _RTREE_H_
+#define _RTREE_H_
+
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#include "util_type.h"
+#include "bounds.h"
+
+// Children per node. Every node has this many slots, the unused ones
+// holding a box that matches nothing, so a node is tested in one fixed
+// length loop
+#define RTREE_FANOUT 16
+
+// An entry found by distance, and how far it is [coord_t units]
+struct rtree_hit {
+	unsigned int i;
+	double d;
+};
+
+// Gap between two boxes, 0 if they touch. No real distance between things
+// inside them can be less
+static inline double box_gap(coord_t ax0, coord_t ay0, coord_t ax1, coord_t ay1,
+	coord_t bx0, coord_t by0, coord_t bx1, coord_t by1)
+{
+	double dx = std::max(0.0, std::max((double)bx0 - ax1, (double)ax0 - bx1));
+	double dy = std::max(0.0, std::max((double)by0 - ay1, (double)ay0 - by1));
+	return sqrt(dx * dx + dy * dy);
+}
+
+/*
+ * Distance kernel that goes by the boxes alone. A kernel is called as
+ * k(i, stop) for table entry i and returns its distance to the query
+ * shape, which may not be less than the gap between their boxes. Once it
+ * knows the distance is no more than stop it may return any value no
+ * more than stop, and stop early
+ */
+struct rtree_box_kernel {
+	const BoundsTable * t;
+	Rect q;
+	double operator()(unsigned int i, double stop) const
+	{
+		return box_gap(q.getStartPoint().x, q.getStartPoint().y, q.getEndPoint().x, q.getEndPoint().y,
+			t->minx[i], t->miny[i], t->maxx[i], t->maxy[i]);
+	};
+};
+
+/*
+ * Static R-tree over the boxes of a BoundsTable, packed bottom up with
+ * Sort-Tile-Recursive: each level is cut into vertical slices by x, each
+ * slice into runs of RTREE_FANOUT by y, and each run becomes a node of the
+ * level above.
+ *
+ * All levels live in the same flat arrays, leaves first. Slot s holds one
+ * box in minx[s], miny[s], maxx[s], maxy[s], and ref[s] is the table entry
+ * for a leaf slot, or the node of the level below for an inner one. Node g
+ * of a level is the slots [first[level] + g * RTREE_FANOUT, ...+RTREE_FANOUT).
+ *
+ * Unlike a grid, every object is stored once whatever its size. As with
+ * UniformGrid the tree refers to the table, and a copy starts out empty.
+ */
+class PackedRTree {
+public:
+	PackedRTree() : m_table(NULL) {};
+	PackedRTree(const PackedRTree &) : m_table(NULL) {};
+	PackedRTree & operator=(const PackedRTree &) {clear(); return *this;};
+	
+	void build(const BoundsTable & t);
+	void clear();
+	bool built() const {return m_table != NULL;};
+	
+	// Entries whose box touches r [closed], in table order
+	void query(const Rect & r, std::vector<unsigned int> & out) const;
+	
+	// Call f(i) once for each entry query would return, in no particular
+	// order and without allocating
+	template <class F> void visit(const Rect & r, F & f) const;
+	
+	/*
+	 * The k entries nearest to a shape with bounds q, nearest first, by
+	 * kernel distance [see rtree_box_kernel]. Entries further than maxd
+	 * are left out, as are those the kernel puts at INFINITY
+	 */
+	template <class K> void nearest(const Rect & q, unsigned int k, K & kernel,
+		std::vector<struct rtree_hit> & out, double maxd = INFINITY) const;
+	
+	// Call f(i) for every entry the kernel puts no more than d from a
+	// shape with bounds q, in no particular order
+	template <class K, class F> void within(const Rect & q, double d, K & kernel, F & f) const;
+	
+	int levels() const {return first.size();};
+	long slots() const {return ref.size();};
+	long bytes() const;
+	
+	std::vector<coord_t> minx, miny, maxx, maxy;
+	std::vector<unsigned int> ref;
+	std::vector<unsigned int> first;
+	
+private:
+	const BoundsTable * m_table;
+};
+
+/*
+ * Depth first, with a fixed stack: a level adds at most RTREE_FANOUT nodes
+ * to it. A node's slots are tested without branches, as in BoundsTable
+ */
+template <class F> void PackedRTree::visit(const Rect & r, F & f) const
+{
+	if (!m_table || !r.isSet() || first.empty())
+		return;
+	
+	coord_t qx0 = r.getStartPoint().x, qy0 = r.getStartPoint().y;
+	coord_t qx1 = r.getEndPoint().x, qy1 = r.getEndPoint().y;
+	
+	// Node and level, packed as node * 32 + level
+	unsigned long stack[32 * RTREE_FANOUT];
+	int sp = 0;
+	stack[sp++] = first.size() - 1;
+	
+	unsigned char hit[RTREE_FANOUT];
+	while (sp > 0)
+	{
+		unsigned long top = stack[--sp];
+		int level = top % 32;
+		unsigned long s = first[level] + (top / 32) * RTREE_FANOUT;
+		
+		const coord_t * x0 = &minx[s];
+		const coord_t * y0 = &miny[s];
+		const coord_t * x1 = &maxx[s];
+		const coord_t * y1 = &maxy[s];
+		for (int k=0; k < RTREE_FANOUT; k++)
+			hit[k] = (x0[k] <= qx1) & (x1[k] >= qx0) & (y0[k] <= qy1) & (y1[k] >= qy0);
+		
+		for (int k=0; k < RTREE_FANOUT; k++)
+		{
+			if (!hit[k])
+				continue;
+			if (level == 0)
+				f(ref[s + k]);
+			else
+				stack[sp++] = (unsigned long)ref[s + k] * 32 + level - 1;
+		}
+	}
+}
+
+/*
+ * Nodes whose box is too far away are skipped, and only the entries left
+ * go to the kernel, with d to stop at
+ */
+template <class K, class F> void PackedRTree::within(const Rect & q, double d, K & kernel, F & f) const
+{
+	if (!m_table || !q.isSet() || first.empty())
+		return;
+	
+	coord_t qx0 = q.getStartPoint().x, qy0 = q.getStartPoint().y;
+	coord_t qx1 = q.getEndPoint().x, qy1 = q.getEndPoint().y;
+	
+	unsigned long stack[32 * RTREE_FANOUT];
+	int sp = 0;
+	stack[sp++] = first.size() - 1;
+	
+	while (sp > 0)
+	{
+		unsigned long top = stack[--sp];
+		int level = top % 32;
+		unsigned long s = first[level] + (top / 32) * RTREE_FANOUT;
+		
+		for (int k=0; k < RTREE_FANOUT; k++)
+		{
+			if (minx[s + k] > maxx[s + k] ||
+				box_gap(qx0, qy0, qx1, qy1, minx[s + k], miny[s + k], maxx[s + k], maxy[s + k]) > d)
+				continue;
+			if (level > 0)
+				stack[sp++] = (unsigned long)ref[s + k] * 32 + level - 1;
+			else if (kernel(ref[s + k], d) <= d)
+				f(ref[s + k]);
+		}
+	}
+}
+
+// Something waiting in nearest's queue: a node, an entry with only its
+// box gap known, or an entry with its kernel distance
+struct rtree_wait {
+	double d;
+	int kind;
+	unsigned long at;
+	
+	// Reversed for a min heap. At the same distance measured entries go
+	// first, then lower numbers, so ties come out in table order
+	bool operator<(const struct rtree_wait & o) const
+	{
+		if (d != o.d)
+			return d > o.d;
+		if (kind != o.kind)
+			return kind < o.kind;
+		return at > o.at;
+	};
+};
+
+#define RTREE_WAIT_NODE 0
+#define RTREE_WAIT_BOX 1
+#define RTREE_WAIT_EXACT 2
+
+/*
+ * Best first: everything waits in one queue by the least distance it can
+ * have, so once k measured entries have come off the front nothing left
+ * can be nearer. Kernels are only run on entries that reach the front
+ */
+template <class K> void PackedRTree::nearest(const Rect & q, unsigned int k, K & kernel,
+	std::vector<struct rtree_hit> & out, double maxd) const
+{
+	out.clear();
+	if (!m_table || !q.isSet() || first.empty() || k == 0)
+		return;
+	
+	coord_t qx0 = q.getStartPoint().x, qy0 = q.getStartPoint().y;
+	coord_t qx1 = q.getEndPoint().x, qy1 = q.getEndPoint().y;
+	
+	std::vector<struct rtree_wait> heap;
+	struct rtree_wait w = {0, RTREE_WAIT_NODE, (first.size() - 1)};
+	heap.push_back(w);
+	
+	while (!heap.empty())
+	{
+		w = heap.front();
+		std::pop_heap(heap.begin(), heap.end());
+		heap.pop_back();
+		if (w.d > maxd)
+			break;
+		
+		if (w.kind == RTREE_WAIT_EXACT)
+		{
+			struct rtree_hit h = {(unsigned int)w.at, w.d};
+			out.push_back(h);
+			if (out.size() >= k)
+				break;
+			continue;
+		}
+		
+		if (w.kind == RTREE_WAIT_BOX)
+		{
+			w.d = kernel(ref[w.at], -1);
+			w.kind = RTREE_WAIT_EXACT;
+			w.at = ref[w.at];
+			if (w.d <= maxd)
+			{
+				heap.push_back(w);
+				std::push_heap(heap.begin(), heap.end());
+			}
+			continue;
+		}
+		
+		int level = w.at % 32;
+		unsigned long s = first[level] + (w.at / 32) * RTREE_FANOUT;
+		for (int j=0; j < RTREE_FANOUT; j++)
+		{
+			if (minx[s + j] > maxx[s + j])
+				continue;
+			struct rtree_wait c;
+			c.d = box_gap(qx0, qy0, qx1, qy1, minx[s + j], miny[s + j], maxx[s + j], maxy[s + j]);
+			if (c.d > maxd)
+				continue;
+			if (level > 0)
+			{
+				c.kind = RTREE_WAIT_NODE;
+				c.at = (unsigned long)ref[s + j] * 32 + level - 1;
+			} else {
+				c.kind = RTREE_WAIT_BOX;
+				c.at = s + j;
+			}
+			heap.push_back(c);
+			std::push_heap(heap.begin(), heap.end());
+		}
+	}
+}
+
+#endif
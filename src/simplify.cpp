@@ -0,0 +1,211 @@
+/*
+ *  Portions Copyright 2006,2009 David Carne and 2007,2008 Spark Fun Electronics
+ *
+ *
+ *  This file is part of gerberDRC.
+ *
+ *  gerberDRC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gerberDRC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <math.h>
+#include <utility>
+
+#include "simplify.h"
+#include "ring.h"
+#include "gerbobj_poly.h"
+#include "main.h"
+
+static void drop_repeats(ring_t & r, coord_t tol)
+{
+	ring_t out;
+	out.reserve(r.size());
+	for (unsigned int i=0; i < r.size(); i++)
+	{
+		if (!out.empty() && llabs(r[i].x - out.back().x) <= tol && llabs(r[i].y - out.back().y) <= tol)
+			continue;
+		out.push_back(r[i]);
+	}
+	while (out.size() > 1 && llabs(out[0].x - out.back().x) <= tol && llabs(out[0].y - out.back().y) <= tol)
+		out.pop_back();
+	if (out.size() >= 3)
+		r.swap(out);
+}
+
+// Points on the line between their neighbours, going the same way
+static void drop_collinear(ring_t & r)
+{
+	unsigned int n = r.size();
+	if (n < 4)
+		return;
+	
+	ring_t out;
+	out.reserve(n);
+	for (unsigned int i=0; i < n; i++)
+	{
+		const Point & a = out.empty() ? r[n - 1] : out.back();
+		const Point & b = r[i];
+		const Point & c = r[(i + 1) % n];
+		if (side(a, b, c) == 0 &&
+			(b.x - a.x) * (c.x - b.x) + (b.y - a.y) * (c.y - b.y) >= 0)
+			continue;
+		out.push_back(b);
+	}
+	if (out.size() >= 3)
+		r.swap(out);
+}
+
+/*
+ * Douglas-Peucker over the ring, split at two points that are surely
+ * kept: the lowest-leftmost point and the point farthest from it
+ */
+static void ring_dp(ring_t & r, coord_t tol)
+{
+	unsigned int n = r.size();
+	if (n < 4)
+		return;
+	
+	unsigned int a = 0;
+	for (unsigned int i=1; i < n; i++)
+		if (r[i].y < r[a].y || (r[i].y == r[a].y && r[i].x < r[a].x))
+			a = i;
+	unsigned int b = a;
+	double far = -1;
+	for (unsigned int i=0; i < n; i++)
+	{
+		double dx = (double)(r[i].x - r[a].x), dy = (double)(r[i].y - r[a].y);
+		if (dx * dx + dy * dy > far)
+		{
+			far = dx * dx + dy * dy;
+			b = i;
+		}
+	}
+	if (a == b)
+		return;
+	
+	std::vector<char> keep(n, 0);
+	keep[a] = keep[b] = 1;
+	
+	// Spans are [i, j] going forward round the ring, j may pass n
+	std::vector<std::pair<unsigned int, unsigned int> > stack;
+	stack.push_back(std::make_pair(a, b < a ? b + n : b));
+	stack.push_back(std::make_pair(b, a < b ? a + n : a));
+	while (!stack.empty())
+	{
+		unsigned int i = stack.back().first, j = stack.back().second;
+		stack.pop_back();
+		if (j - i < 2)
+			continue;
+		
+		unsigned int worst = 0;
+		double wd = -1;
+		for (unsigned int k=i + 1; k < j; k++)
+		{
+			double d = pt_seg_dist(r[k % n], r[i % n], r[j % n]);
+			if (d > wd)
+			{
+				wd = d;
+				worst = k;
+			}
+		}
+		if (wd <= tol)
+			continue;
+		
+		keep[worst % n] = 1;
+		stack.push_back(std::make_pair(i, worst));
+		stack.push_back(std::make_pair(worst, j));
+	}
+	
+	ring_t out;
+	for (unsigned int i=0; i < n; i++)
+		if (keep[i])
+			out.push_back(r[i]);
+	if (out.size() >= 3)
+		r.swap(out);
+}
+
+static void thin(ring_t & r, coord_t tol)
+{
+	drop_repeats(r, tol);
+	drop_collinear(r);
+	if (tol > 0)
+		ring_dp(r, tol);
+}
+
+void simplify_ring(ring_t & r, coord_t tol)
+{
+	if (r.size() < 4)
+		return;
+	
+	// Points moved by up to tol can take an edge across another one [a
+	// narrow neck, a notch with a spike in it]. Then the tolerance is
+	// halved until nothing new crosses; at 0 only exact repeats and
+	// collinear points go, which leaves the shape as it was
+	long before = -1;
+	ring_t t;
+	for (; tol > 0; tol /= 2)
+	{
+		t = r;
+		thin(t, tol);
+		if (t.size() == r.size())
+			return;
+		if (before < 0)
+			before = ring_crossings(r);
+		if (ring_crossings(t) <= before)
+		{
+			r.swap(t);
+			return;
+		}
+	}
+	thin(r, 0);
+}
+
+unsigned int simplify_poly(GerbObj_Poly * p, coord_t tol)
+{
+	unsigned int n = p->pointCount();
+	ring_t r(p->pointBegin(), p->pointEnd());
+	simplify_ring(r, tol);
+	if (r.size() == n)
+		return n;
+	
+	bool packed = p->isPacked();
+	p->unpack();
+	p->points.assign(r.begin(), r.end());
+	p->pointsChanged();
+	if (packed)
+		p->pack();
+	return r.size();
+}
+
+struct simplify_stats simplify_vector_outp(Vector_Outp * v, coord_t tol)
+{
+	struct simplify_stats st;
+	st.polys = st.verts_in = st.verts_out = 0;
+	
+	std::list<sp_GerbObj>::iterator it = v->all.begin();
+	for (; it != v->all.end(); it++)
+	{
+		GerbObj_Poly * p = dynamic_cast<GerbObj_Poly *>((*it).get());
+		if (!p)
+			continue;
+		
+		st.polys++;
+		st.verts_in += p->pointCount();
+		st.verts_out += simplify_poly(p, tol);
+	}
+	reindex_vector_outp(v);
+	
+	DBG_MSG_PF("Simplify: %ld polygons, %ld -> %ld vertices", st.polys, st.verts_in, st.verts_out);
+	return st;
+}
@@ -0,0 +1,61 @@
+/*
+ *  Portions Copyright 2006,2009 David Carne and 2007,2008 Spark Fun Electronics
+ *
+ *
+ *  This file is part of gerberDRC.
+ *
+ *  gerberDRC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gerberDRC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef _SIMPLIFY_H_
+#define _SIMPLIFY_H_
+
+#include <vector>
+
+#include "gcode_interp.h"
+
+// Default simplification tolerance [0.1um, in coord_t steps]
+#define SIMPLIFY_TOL (COORD_PER_UM / 10)
+
+struct simplify_stats {
+	long polys;		// polygons looked at
+	long verts_in;
+	long verts_out;
+};
+
+/*
+ * Thin out a closed outline without moving it more than tol anywhere:
+ * points within tol of the one before are dropped, then points on a
+ * straight line, then Douglas-Peucker takes out whatever else lies
+ * within tol of the chord that replaces it [the extra points of
+ * tessellated arcs and round caps].
+ *
+ * No step takes an outline below 3 points. If the thinned outline
+ * crosses or touches itself in more places than r did, it is thinned
+ * again at half the tolerance, down to dropping only exact repeats and
+ * collinear points.
+ */
+void simplify_ring(std::vector<Point> & r, coord_t tol);
+
+class GerbObj_Poly;
+
+// simplify_ring on one polygon, packed or not. Returns its point count after
+unsigned int simplify_poly(GerbObj_Poly * p, coord_t tol);
+
+// simplify_ring on every polygon in the layer
+struct simplify_stats simplify_vector_outp(Vector_Outp * v, coord_t tol = SIMPLIFY_TOL);
+
+#endif
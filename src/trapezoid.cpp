@@ -0,0 +1,247 @@
+/*
+ *  Portions Copyright 2006,2009 David Carne and 2007,2008 Spark Fun Electronics
+ *
+ *
+ *  This file is part of gerberDRC.
+ *
+ *  gerberDRC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gerberDRC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+#include <algorithm>
+
+#include "trapezoid.h"
+#include "normalize.h"
+
+static bool traps_enabled = true;
+static long traps_bytes = 0;
+static long traps_count = 0;
+
+void set_poly_traps_enabled(bool on)
+{
+	traps_enabled = on;
+}
+
+bool poly_traps_enabled()
+{
+	return traps_enabled;
+}
+
+long poly_traps_bytes()
+{
+	return traps_bytes;
+}
+
+long poly_traps_count()
+{
+	return traps_count;
+}
+
+// An edge from its lower end a to its upper end b
+struct trap_edge {
+	Point a, b;
+	int dir;		// +1 if the outline runs upwards along it
+	double xm;		// x at the middle of the current slab
+};
+
+static inline double x_at(const Point & a, const Point & b, double y)
+{
+	return a.x + (double)(b.x - a.x) * (y - a.y) / (double)(b.y - a.y);
+}
+
+static bool lower_first(const trap_edge & l, const trap_edge & r)
+{
+	return l.a.y < r.a.y;
+}
+
+struct by_xm {
+	const std::vector<trap_edge> & e;
+	by_xm(const std::vector<trap_edge> & edges) : e(edges) {};
+	bool operator()(unsigned int l, unsigned int r) const {return e[l].xm < e[r].xm;};
+};
+
+static void add_edges(const ring_t & r, std::vector<coord_t> & ys, std::vector<trap_edge> & edges)
+{
+	unsigned int n = r.size();
+	for (unsigned int i=0; i < n; i++)
+	{
+		const Point & p = r[i], & q = r[(i+1) % n];
+		ys.push_back(p.y);
+		if (p.y == q.y)
+			continue;
+		trap_edge e;
+		e.dir = q.y > p.y ? 1 : -1;
+		e.a = e.dir > 0 ? p : q;
+		e.b = e.dir > 0 ? q : p;
+		edges.push_back(e);
+	}
+}
+
+/*
+ * Sweep up through the vertices, keeping the edges that span the current
+ * slab. Within a slab no edges cross, as long as the outline doesn't
+ * cross itself, so their order at the middle is their order throughout.
+ * An outline that does cross [a bowtie] is normalized first: the pieces
+ * only meet at their ends, and cover what the nonzero rule fills
+ */
+PolyTraps::PolyTraps(const ring_t & r) : m_area(0), m_bytes(0)
+{
+	std::vector<trap_edge> edges;
+	edges.reserve(r.size());
+	if (ring_crossings(r) == 0)
+	{
+		add_edges(r, ys, edges);
+	} else {
+		struct normalize_stats st;
+		memset(&st, 0, sizeof(st));
+		ring_list_t pieces;
+		ring_normalize(r, pieces, st);
+		for (unsigned int i=0; i < pieces.size(); i++)
+			add_edges(pieces[i], ys, edges);
+	}
+	std::sort(ys.begin(), ys.end());
+	ys.erase(std::unique(ys.begin(), ys.end()), ys.end());
+	std::sort(edges.begin(), edges.end(), lower_first);
+	
+	std::vector<unsigned int> active;
+	unsigned int next = 0;
+	for (unsigned int s=0; s + 1 < ys.size(); s++)
+	{
+		coord_t y0 = ys[s], y1 = ys[s+1];
+		double ym = (y0 + y1) / 2.0;
+		
+		unsigned int k = 0;
+		for (unsigned int i=0; i < active.size(); i++)
+			if (edges[active[i]].b.y > y0)
+				active[k++] = active[i];
+		active.resize(k);
+		for (; next < edges.size() && edges[next].a.y <= y0; next++)
+			active.push_back(next);
+		
+		for (unsigned int i=0; i < active.size(); i++)
+			edges[active[i]].xm = x_at(edges[active[i]].a, edges[active[i]].b, ym);
+		std::sort(active.begin(), active.end(), by_xm(edges));
+		
+		first.push_back(traps.size());
+		int w = 0;
+		unsigned int start = 0;
+		for (unsigned int i=0; i < active.size(); i++)
+		{
+			const trap_edge & e = edges[active[i]];
+			int was = w;
+			w -= e.dir;
+			if (was == 0 && w != 0)
+				start = i;
+			if (was == 0 || w != 0)
+				continue;
+			
+			const trap_edge & l = edges[active[start]];
+			struct trapezoid t;
+			t.xl0 = x_at(l.a, l.b, y0);
+			t.xl1 = x_at(l.a, l.b, y1);
+			t.xr0 = x_at(e.a, e.b, y0);
+			t.xr1 = x_at(e.a, e.b, y1);
+			
+			// Keyhole bridges leave two trapezoids meeting along an edge
+			if (traps.size() > first.back() &&
+				traps.back().xr0 == t.xl0 && traps.back().xr1 == t.xl1)
+			{
+				traps.back().xr0 = t.xr0;
+				traps.back().xr1 = t.xr1;
+			} else {
+				traps.push_back(t);
+			}
+		}
+	}
+	if (!ys.empty())
+		first.push_back(traps.size());
+	
+	for (unsigned int s=0; s < slabCount(); s++)
+		for (unsigned int i=first[s]; i < first[s+1]; i++)
+		{
+			const struct trapezoid & t = traps[i];
+			m_area += (double)(ys[s+1] - ys[s]) * ((t.xr0 - t.xl0) + (t.xr1 - t.xl1)) / 2;
+		}
+	
+	std::vector<struct trapezoid>(traps).swap(traps);
+	m_bytes = sizeof(*this) + ys.capacity() * sizeof(coord_t) +
+		first.capacity() * sizeof(unsigned int) + traps.capacity() * sizeof(struct trapezoid);
+	__sync_add_and_fetch(&traps_bytes, m_bytes);
+	__sync_add_and_fetch(&traps_count, 1);
+}
+
+PolyTraps::~PolyTraps()
+{
+	__sync_sub_and_fetch(&traps_bytes, m_bytes);
+	__sync_sub_and_fetch(&traps_count, 1);
+}
+
+// Slab holding y, which has to be within ys. The top line is in the last
+unsigned int PolyTraps::slab_of(coord_t y) const
+{
+	unsigned int s = std::upper_bound(ys.begin(), ys.end(), y) - ys.begin();
+	return std::min(s, slabCount()) - 1;
+}
+
+bool PolyTraps::in_slab(unsigned int s, const Point & p) const
+{
+	double f = (double)(p.y - ys[s]) / (double)(ys[s+1] - ys[s]);
+	
+	// First trapezoid whose right side isn't left of p
+	unsigned int lo = first[s], hi = first[s+1];
+	while (lo < hi)
+	{
+		unsigned int mid = (lo + hi) / 2;
+		const struct trapezoid & t = traps[mid];
+		if (t.xr0 + (t.xr1 - t.xr0) * f < p.x)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == first[s+1])
+		return false;
+	const struct trapezoid & t = traps[lo];
+	return t.xl0 + (t.xl1 - t.xl0) * f <= p.x;
+}
+
+bool PolyTraps::contains(const Point & p) const
+{
+	if (ys.size() < 2 || p.y < ys.front() || p.y > ys.back())
+		return false;
+	
+	// On a cut, the outline may be the top of the slab below
+	unsigned int s = slab_of(p.y);
+	return in_slab(s, p) || (p.y == ys[s] && s > 0 && in_slab(s - 1, p));
+}
+
+void PolyTraps::spans(coord_t y, std::vector<std::pair<double, double> > & out) const
+{
+	out.clear();
+	if (ys.size() < 2 || y < ys.front() || y > ys.back())
+		return;
+	
+	unsigned int s = slab_of(y);
+	double f = (double)(y - ys[s]) / (double)(ys[s+1] - ys[s]);
+	for (unsigned int i=first[s]; i < first[s+1]; i++)
+	{
+		const struct trapezoid & t = traps[i];
+		double l = t.xl0 + (t.xl1 - t.xl0) * f;
+		double r = t.xr0 + (t.xr1 - t.xr0) * f;
+		if (!out.empty() && out.back().second >= l)
+			out.back().second = std::max(out.back().second, r);
+		else
+			out.push_back(std::make_pair(l, r));
+	}
+}
@@ -0,0 +1,97 @@
+/*
+ *  Portions Copyright 2006,2009 David Carne and 2007,2008 Spark Fun Electronics
+ *
+ *
+ *  This file is part of gerberDRC.
+ *
+ *  gerberDRC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  gerberDRC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef _TRAPEZOID_H_
+#define _TRAPEZOID_H_
+
+#include <vector>
+#include <utility>
+#include <boost/shared_ptr.hpp>
+
+#include "ring.h"
+
+// Sides run from [xl0, xr0] at the bottom of the slab to [xl1, xr1] at its top
+struct trapezoid {
+	double xl0, xr0, xl1, xr1;
+};
+
+/*
+ * A polygon cut into trapezoids by a horizontal line through every
+ * vertex. The cuts make slabs, and within a slab the trapezoids are in
+ * order of x, so locating a point takes two binary searches. Filled by
+ * the nonzero rule, as regions are.
+ *
+ * The slabs only work for edges that don't cross. An outline that
+ * crosses itself is put through ring_normalize first, which rounds the
+ * crossings to the grid.
+ *
+ * Built once and then only read.
+ */
+class PolyTraps {
+public:
+	PolyTraps(const ring_t & r);
+	~PolyTraps();
+	
+	// Closed: points on the outline are inside
+	bool contains(const Point & p) const;
+	
+	// x ranges filled along the line at y, left to right
+	void spans(coord_t y, std::vector<std::pair<double, double> > & out) const;
+	
+	// Filled area, in square grid steps
+	double area() const {return m_area;};
+	
+	unsigned int size() const {return traps.size();};
+	unsigned int slabCount() const {return ys.empty() ? 0 : ys.size() - 1;};
+	long bytes() const {return m_bytes;};
+	
+	// Slab i is ys[i] to ys[i+1], and holds traps[first[i], first[i+1])
+	std::vector<coord_t> ys;
+	std::vector<unsigned int> first;
+	std::vector<struct trapezoid> traps;
+	
+private:
+	PolyTraps(const PolyTraps &);
+	PolyTraps & operator=(const PolyTraps &);
+	
+	unsigned int slab_of(coord_t y) const;
+	bool in_slab(unsigned int s, const Point & p) const;
+	
+	double m_area;
+	long m_bytes;
+};
+
+typedef boost::shared_ptr<const PolyTraps> sp_PolyTraps;
+
+/*
+ * Polygons keep their PolyTraps once built [GerbObj_Poly::getTraps].
+ * Turning this off drops them as they are next asked for, and outline
+ * scans are used instead
+ */
+void set_poly_traps_enabled(bool on);
+bool poly_traps_enabled();
+
+// Every PolyTraps alive, cached or not
+long poly_traps_bytes();
+long poly_traps_count();
+
+#endif
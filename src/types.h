@@ -23,12 +23,47 @@
 #ifndef _TYPES_H_
 #define _TYPES_H_
 
+#include <math.h>
 
 enum unit_mode {
 	UNITMODE_IN,
 	UNITMODE_MM
 };
 
+/*
+ * Layer coordinates are fixed point integers. COORD_PER_UM sets the grid;
+ * the default is one nanometre, which holds a 3.6 mm Gerber coordinate
+ * exactly and a 2.6 inch one to within half a step, and leaves room for
+ * boards a few metres across before products of two coordinates overflow.
+ *
+ * Doubles are only used for trig [arcs, rotated apertures] and at the
+ * python API, which still speaks microns.
+ */
+typedef long long coord_t;
+
+// An object's place in its layer, see GerbObj::id
+typedef unsigned int obj_id_t;
+#define OBJ_ID_NONE 0xffffffffU
+
+#ifndef COORD_PER_UM
+#define COORD_PER_UM 1000
+#endif
+
+static inline coord_t coord_round(double v)
+{
+	return (coord_t)floor(v + 0.5);
+}
+
+static inline coord_t um_to_coord(double um)
+{
+	return coord_round(um * COORD_PER_UM);
+}
+
+static inline double coord_to_um(coord_t c)
+{
+	return (double)c / COORD_PER_UM;
+}
+
 
 #endif
 
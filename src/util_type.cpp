@@ -21,6 +21,16 @@
 
 #include "util_type.h"
 
+static inline coord_t cmin(coord_t a, coord_t b)
+{
+	return a < b ? a : b;
+}
+
+static inline coord_t cmax(coord_t a, coord_t b)
+{
+	return a > b ? a : b;
+}
+
 
 Vector2D::Vector2D(double x, double y)
 {
@@ -56,10 +66,32 @@ double cross(Vector2D & a, Vector2D & b)
 	return a.getDeltaX()*b.getDeltaY() - a.getDeltaY() * b.getDeltaX();
 }
 
+/*
+ * Grid steps per file unit and the file's decimal places are both powers
+ * of ten [bar the 254 of an inch], so they cancel and this is usually a
+ * plain multiply
+ */
+coord_t file_to_coord(long long value, int frac, enum unit_mode um)
+{
+	long long per = (um == UNITMODE_IN) ? 25400LL * COORD_PER_UM : 1000LL * COORD_PER_UM;
+	long long den = 1;
+	for (int i=0; i < frac; i++)
+	{
+		if (per % 10 == 0)
+			per /= 10;
+		else
+			den *= 10;
+	}
+	
+	if (den == 1)
+		return value * per;
+	return coord_round((double)value * per / den);
+}
+
 Point::Point (double x, double y)
 {
-    this->x = x;
-    this->y = y;
+    this->x = coord_round(x);
+    this->y = coord_round(y);
 };
 
 Point::Point ()
@@ -74,12 +106,12 @@ Rect::Rect ()
 }
 
 
-Rect::Rect (double x1, double y1, double x2, double y2)
+Rect::Rect (coord_t x1, coord_t y1, coord_t x2, coord_t y2)
 {
-    a.x = fmin (x1, x2);
-    b.x = fmax (x1, x2);
-    a.y = fmin (y1, y2);
-    b.y = fmax (y1, y2);
+    a.x = cmin (x1, x2);
+    b.x = cmax (x1, x2);
+    a.y = cmin (y1, y2);
+    b.y = cmax (y1, y2);
     set = true;
 }
 
@@ -104,24 +136,25 @@ Point Rect::getCWP2 () const
     return Point (a.x, b.y);
 };
 
-double Rect::getWidth () const
+coord_t Rect::getWidth () const
 {
     return b.x - a.x;
 };
 
-double Rect::getHeight () const
+coord_t Rect::getHeight () const
 {
     return b.y - a.y;
 };
 
 void Rect::printRect () const
 {
-    printf ("Rect: [%f,%f] -> [%f,%f], w: %f, h: %f\n", a.x, a.y, b.x, b.y,
-        getWidth (), getHeight ());
+    printf ("Rect: [%f,%f] -> [%f,%f], w: %f, h: %f\n", coord_to_um (a.x),
+        coord_to_um (a.y), coord_to_um (b.x), coord_to_um (b.y),
+        coord_to_um (getWidth ()), coord_to_um (getHeight ()));
 }
 
 
-bool Rect::pointInRectOpen (double x, double y) const
+bool Rect::pointInRectOpen (coord_t x, coord_t y) const
 {
     return x > a.x && x < b.x && y > a.y && y < b.y;
 }
@@ -133,7 +166,7 @@ bool Rect::pointInRectClosed (Point a) const
 }
 
 
-bool Rect::pointInRectClosed (double x, double y) const
+bool Rect::pointInRectClosed (coord_t x, coord_t y) const
 {
     return x >= a.x && x <= b.x && y >= a.y && y <= b.y;
 }
@@ -143,10 +176,10 @@ void Rect::mergeBounds (const Rect & r)
 {
     if (set)
     {
-        a.x = fmin (a.x, r.a.x);
-        b.x = fmax (b.x, r.b.x);
-        a.y = fmin (a.y, r.a.y);
-        b.y = fmax (b.y, r.b.y);
+        a.x = cmin (a.x, r.a.x);
+        b.x = cmax (b.x, r.b.x);
+        a.y = cmin (a.y, r.a.y);
+        b.y = cmax (b.y, r.b.y);
     }
     else
     {
@@ -157,14 +190,14 @@ void Rect::mergeBounds (const Rect & r)
 }
 
 
-void Rect::mergePoint (const Point & r, double radius)
+void Rect::mergePoint (const Point & r, coord_t radius)
 {
     if (set)
     {
-        a.x = fmin (a.x, r.x - radius);
-        b.x = fmax (b.x, r.x + radius);
-        a.y = fmin (a.y, r.y - radius);
-        b.y = fmax (b.y, r.y + radius);
+        a.x = cmin (a.x, r.x - radius);
+        b.x = cmax (b.x, r.x + radius);
+        a.y = cmin (a.y, r.y - radius);
+        b.y = cmax (b.y, r.y + radius);
     }
     else
     {
@@ -177,13 +210,13 @@ void Rect::mergePoint (const Point & r, double radius)
 }
 
 
-void Rect::feather (double s)
+void Rect::feather (coord_t s)
 {
     feather (s, s);
 }
 
 
-void Rect::feather (double x, double y)
+void Rect::feather (coord_t x, coord_t y)
 {
     a.x -= x;
     a.y -= y;
@@ -192,8 +225,14 @@ void Rect::feather (double x, double y)
 }
 
 
+bool Rect::isSet () const
+{
+    return set;
+}
+
+
 bool Rect::intersectsWith (const Rect & r)
 {
 	return !(a.x > r.b.x || b.x < r.a.x ||
-		a.y > r.b.y || b.y < r.b.y);
+		a.y > r.b.y || b.y < r.a.y);
 }
@@ -23,13 +23,16 @@
 #ifndef _UTIL_TYPE_H_
 #define _UTIL_TYPE_H_
 #include <stdio.h>
+#include "types.h"
 
 
+// A point on the coordinate grid. Built from doubles [the result of
+// trig, mostly], which are rounded to the nearest grid point
 class Point {
 	public:
 		Point(double x, double y);
 		Point();
-		double x, y;
+		coord_t x, y;
 		
 };
 
@@ -50,33 +53,39 @@ class Vector2D {
 
 double cross(Vector2D & a, Vector2D & b);
 
+// value * 10^-frac in file units [inches or mm], on the coord_t grid
+coord_t file_to_coord(long long value, int frac, enum unit_mode um);
+
 class Rect {
 
 	public:
 		Rect();
-		Rect(double x1, double y1, double x2, double y2);
+		Rect(coord_t x1, coord_t y1, coord_t x2, coord_t y2);
 		
 		Point getStartPoint() const;
 		Point getCWP1() const;
 		Point getEndPoint() const;
 		Point getCWP2() const;
 		
-		double getWidth() const;
+		coord_t getWidth() const;
 		
-		double getHeight() const;
+		coord_t getHeight() const;
 		void printRect()  const;
-		bool pointInRectOpen(double x, double y) const;
+		bool pointInRectOpen(coord_t x, coord_t y) const;
 		bool pointInRectClosed(Point a) const;
 		
-		bool pointInRectClosed(double x, double y) const;
+		bool pointInRectClosed(coord_t x, coord_t y) const;
 		
 		void mergeBounds(const Rect &r);
 		
-		void mergePoint(const Point &r, double radius = 0);
+		void mergePoint(const Point &r, coord_t radius = 0);
 		
-		void feather(double s);
-		void feather(double x, double y);
+		void feather(coord_t s);
+		void feather(coord_t x, coord_t y);
 		bool intersectsWith(const Rect & r);
+		
+		// False until a point or bounds are merged in
+		bool isSet() const;
 	private:
 		Point a,b;
 		bool set;
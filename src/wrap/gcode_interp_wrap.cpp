@@ -26,6 +26,12 @@
 #include "gerbobj_poly.h"
 #include "gerbobj_line.h"
 #include "render.h"
+#include "polarity.h"
+#include "merge_lines.h"
+#include "dedup.h"
+#include "polygonize.h"
+#include "simplify.h"
+#include "normalize.h"
 
 
 #include "boost/python.hpp"
@@ -36,6 +42,16 @@
 
 namespace bp = boost::python;
 
+// vector_indexing_suite wants these for __contains__
+static bool operator==(const point_line & a, const point_line & b)
+{
+	return a.lt == b.lt && a.x == b.x && a.y == b.y && a.cx == b.cx && a.cy == b.cy;
+}
+static bool operator==(const render_span & a, const render_span & b)
+{
+	return a.first == b.first && a.count == b.count;
+}
+
 struct GerbObj_wrapper : GerbObj, bp::wrapper< GerbObj > {
 	
     GerbObj_wrapper( )
@@ -45,9 +61,11 @@ struct GerbObj_wrapper : GerbObj, bp::wrapper< GerbObj > {
 		
     }
 	
+    // The RenderPoly belongs to python, the caller owns and frees a copy
     virtual ::RenderPoly * createPolyData(  ){
         bp::override func_createPolyData = this->get_override( "createPolyData" );
-        return func_createPolyData(  );
+        ::RenderPoly * rp = func_createPolyData(  );
+        return rp ? new ::RenderPoly(*rp) : NULL;
     }
 	
     virtual ::Rect getBounds(  ){
@@ -66,7 +84,249 @@ typedef gerbobjlist_t::const_reverse_iterator (gerbobjlist_t::*rrci)(void) const
 namespace bp = boost::python;
 
 
-BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(mergePointOverloads, mergePoint, 1, 2)
+/*
+ * Geometry is held on the integer coord_t grid, but python still sees
+ * microns. These convert at the edge
+ */
+static Point * point_new(double x, double y)
+{
+	return new Point(x * COORD_PER_UM, y * COORD_PER_UM);
+}
+static double point_get_x(const Point & p) { return coord_to_um(p.x); }
+static double point_get_y(const Point & p) { return coord_to_um(p.y); }
+static void point_set_x(Point & p, double v) { p.x = um_to_coord(v); }
+static void point_set_y(Point & p, double v) { p.y = um_to_coord(v); }
+
+template <coord_t GerbObj_Line::*m> static double line_get(const GerbObj_Line & l)
+{
+	return coord_to_um(l.*m);
+}
+template <coord_t GerbObj_Line::*m> static void line_set(GerbObj_Line & l, double v)
+{
+	object_render_cache().forget(&l);
+	l.*m = um_to_coord(v);
+	l.geometryChanged();
+}
+
+static bool poly_contains(GerbObj_Poly & p, double x, double y)
+{
+	return p.containsPoint(Point(um_to_coord(x), um_to_coord(y)));
+}
+
+static double poly_area(GerbObj_Poly & p)
+{
+	return p.area() / ((double)COORD_PER_UM * COORD_PER_UM);
+}
+
+// None while turned off
+static boost::shared_ptr<PolyTraps> poly_traps(GerbObj_Poly & p)
+{
+	return boost::const_pointer_cast<PolyTraps>(p.getTraps());
+}
+
+static bool traps_contains(const PolyTraps & t, double x, double y)
+{
+	return t.contains(Point(um_to_coord(x), um_to_coord(y)));
+}
+
+static double traps_area(const PolyTraps & t)
+{
+	return t.area() / ((double)COORD_PER_UM * COORD_PER_UM);
+}
+
+// Filled x ranges along y, as (x1, x2) tuples
+static bp::list traps_spans(const PolyTraps & t, double y)
+{
+	std::vector<std::pair<double, double> > sp;
+	t.spans(um_to_coord(y), sp);
+	bp::list l;
+	for (unsigned int i=0; i < sp.size(); i++)
+		l.append(bp::make_tuple(sp[i].first / COORD_PER_UM, sp[i].second / COORD_PER_UM));
+	return l;
+}
+
+// Each convex piece as a list of (x, y)
+static bp::list poly_parts(GerbObj_Poly & p)
+{
+	sp_ConvexParts c = p.getParts();
+	bp::list l;
+	for (unsigned int i=0; i < c->pieces.size(); i++)
+	{
+		bp::list pl;
+		const struct convex_piece & pc = c->pieces[i];
+		for (unsigned int k=pc.first; k < pc.first + pc.count; k++)
+			pl.append(bp::make_tuple(c->pts[k].x / COORD_PER_UM, c->pts[k].y / COORD_PER_UM));
+		l.append(pl);
+	}
+	return l;
+}
+
+static double gap_um(GerbObj * a, GerbObj * b)
+{
+	return obj_gap(a, b, 0) / COORD_PER_UM;
+}
+
+static bool objs_overlap(GerbObj * a, GerbObj * b)
+{
+	return obj_gap(a, b, 0) <= 0;
+}
+
+// Polygon outline in microns, packed or not
+static bp::list poly_points(const GerbObj_Poly & p)
+{
+	bp::list l;
+	for (GerbObj_Poly::point_iter i = p.pointBegin(); i != p.pointEnd(); ++i)
+		l.append(bp::make_tuple(coord_to_um(i->x), coord_to_um(i->y)));
+	return l;
+}
+
+// Render data for one of the layer's objects, through the layer's cache
+static sp_RenderPoly layer_poly_data(Vector_Outp & v, GerbObj * o)
+{
+	return v.cache.get(o);
+}
+
+// Broad phase searches on the layer's BoundsTable. The objects belong to
+// the layer, as with iterating all
+static bp::list layer_query_bounds(Vector_Outp & v, const Rect & r)
+{
+	std::vector<unsigned int> hits;
+	v.bounds.query(r, hits);
+	
+	bp::list l;
+	for (unsigned int i=0; i < hits.size(); i++)
+		l.append(bp::ptr(v.bounds.objs[hits[i]]));
+	return l;
+}
+
+// Pairs of objects whose outlines are within d microns
+static bp::list layer_close_pairs(Vector_Outp & v, double d)
+{
+	std::vector<bounds_pair_t> pairs;
+	close_pairs_vector_outp(&v, um_to_coord(d), pairs);
+	
+	bp::list l;
+	for (unsigned int i=0; i < pairs.size(); i++)
+		l.append(bp::make_tuple(bp::ptr(v.bounds.objs[pairs[i].first]), bp::ptr(v.bounds.objs[pairs[i].second])));
+	return l;
+}
+
+// Same as queryBounds, through the layer's grid [built if it isn't]
+static bp::list layer_query_grid(Vector_Outp & v, const Rect & r)
+{
+	if (!v.grid.built())
+		grid_vector_outp(&v);
+	std::vector<unsigned int> hits;
+	v.grid.query(r, hits);
+	
+	bp::list l;
+	for (unsigned int i=0; i < hits.size(); i++)
+		l.append(bp::ptr(v.bounds.objs[hits[i]]));
+	return l;
+}
+
+// Same again, through whichever index buildIndex picked
+static bp::list layer_query_index(Vector_Outp & v, const Rect & r)
+{
+	std::vector<unsigned int> hits;
+	query_vector_outp(&v, r, hits);
+	
+	bp::list l;
+	for (unsigned int i=0; i < hits.size(); i++)
+		l.append(bp::ptr(v.bounds.objs[hits[i]]));
+	return l;
+}
+
+static void layer_build_grid(Vector_Outp & v, double cell)
+{
+	grid_vector_outp(&v, cell > 0 ? um_to_coord(cell) : 0);
+}
+
+static double grid_cell_size(const UniformGrid & g)
+{
+	return coord_to_um(g.cellSize());
+}
+
+// (object, distance in microns) for each hit
+static bp::list layer_hits(Vector_Outp & v, const std::vector<struct rtree_hit> & hits)
+{
+	bp::list l;
+	for (unsigned int i=0; i < hits.size(); i++)
+		l.append(bp::make_tuple(bp::ptr(v.bounds.objs[hits[i].i]), hits[i].d / COORD_PER_UM));
+	return l;
+}
+
+static bp::list layer_nearest(Vector_Outp & v, GerbObj * o, unsigned int k, double maxd)
+{
+	std::vector<struct rtree_hit> hits;
+	nearest_vector_outp(&v, o, k, hits, maxd < 0 ? INFINITY : um_to_coord(maxd));
+	return layer_hits(v, hits);
+}
+
+static bp::list layer_nearest_point(Vector_Outp & v, double x, double y, unsigned int k, double maxd)
+{
+	std::vector<struct rtree_hit> hits;
+	nearest_vector_outp(&v, um_to_coord(x), um_to_coord(y), k, hits, maxd < 0 ? INFINITY : um_to_coord(maxd));
+	return layer_hits(v, hits);
+}
+
+static bp::list layer_within(Vector_Outp & v, GerbObj * o, double d)
+{
+	std::vector<unsigned int> hits;
+	within_vector_outp(&v, o, um_to_coord(d), hits);
+	
+	bp::list l;
+	for (unsigned int i=0; i < hits.size(); i++)
+		l.append(bp::ptr(v.bounds.objs[hits[i]]));
+	return l;
+}
+
+static bp::list layer_overlapping_pairs(Vector_Outp & v, double d)
+{
+	std::vector<bounds_pair_t> pairs;
+	v.bounds.overlapping_pairs(um_to_coord(d), pairs);
+	
+	bp::list l;
+	for (unsigned int i=0; i < pairs.size(); i++)
+		l.append(bp::make_tuple(bp::ptr(v.bounds.objs[pairs[i].first]), bp::ptr(v.bounds.objs[pairs[i].second])));
+	return l;
+}
+
+// Outline every line, tol in microns
+static void polygonize_layer(Vector_Outp * v, double tol)
+{
+	polygonize_vector_outp(v, um_to_coord(tol));
+}
+
+static Rect * rect_new(double x1, double y1, double x2, double y2)
+{
+	return new Rect(um_to_coord(x1), um_to_coord(y1), um_to_coord(x2), um_to_coord(y2));
+}
+static double rect_width(const Rect & r) { return coord_to_um(r.getWidth()); }
+static double rect_height(const Rect & r) { return coord_to_um(r.getHeight()); }
+static void rect_feather(Rect & r, double s) { r.feather(um_to_coord(s)); }
+static void rect_feather_xy(Rect & r, double x, double y) { r.feather(um_to_coord(x), um_to_coord(y)); }
+static void rect_merge_point(Rect & r, const Point & p) { r.mergePoint(p); }
+static void rect_merge_point_radius(Rect & r, const Point & p, double radius) { r.mergePoint(p, um_to_coord(radius)); }
+static bool rect_in_closed(const Rect & r, double x, double y) { return r.pointInRectClosed(um_to_coord(x), um_to_coord(y)); }
+static bool rect_in_open(const Rect & r, double x, double y) { return r.pointInRectOpen(um_to_coord(x), um_to_coord(y)); }
+
+// tol in microns
+static double merge_lines_layer(Vector_Outp * v, double tol)
+{
+	return merge_collinear_lines(v, um_to_coord(tol));
+}
+
+// tile and tol in microns
+static struct polarity_stats polarity_layer(Vector_Outp * v, double tile, double tol)
+{
+	return compose_polarity(v, um_to_coord(tile), um_to_coord(tol));
+}
+
+static struct simplify_stats simplify_layer(Vector_Outp * v, double tol)
+{
+	return simplify_vector_outp(v, um_to_coord(tol));
+}
 
 
 void gcodeInterpWrap(void)
@@ -74,28 +334,89 @@ void gcodeInterpWrap(void)
 	using namespace boost::python;
 	
 	def("runRS274XProgram", gcode_run);
+	def("runRS274XProgramParallel", gcode_run_parallel);
+	def("composePolarity", polarity_layer, (arg("layer"), arg("tile") = coord_to_um(POLARITY_TILE), arg("tol") = coord_to_um(SIMPLIFY_TOL)));
+	def("simplifyLayer", simplify_layer, (arg("layer"), arg("tol") = coord_to_um(SIMPLIFY_TOL)));
+	def("normalizeLayer", normalize_vector_outp);
+	def("mergeCollinearLines", merge_lines_layer, (arg("layer"), arg("tol") = coord_to_um(MERGE_TOL)));
+	def("buildRenderData", render_vector_outp);
+	def("dedupLayer", dedup_vector_outp);
+	def("objGap", gap_um);
+	def("objOverlap", objs_overlap);
+	def("packLayer", pack_vector_outp, (arg("layer"), arg("pack") = true));
+	def("polygonizeLayer", polygonize_layer, (arg("layer"), arg("tol") = coord_to_um(POLY_TOL)));
+	
+	class_<dedup_stats>("DedupStats", no_init)
+	.def_readonly("duplicates", &dedup_stats::duplicates)
+	.def_readonly("covered", &dedup_stats::covered);
+	
+	class_<polarity_stats>("PolarityStats", no_init)
+	.def_readonly("clear", &polarity_stats::clear)
+	.def_readonly("cuts", &polarity_stats::cuts)
+	.def_readonly("pieces", &polarity_stats::pieces)
+	.def_readonly("missed", &polarity_stats::missed)
+	.def_readonly("verts_in", &polarity_stats::verts_in)
+	.def_readonly("verts_out", &polarity_stats::verts_out)
+	.def_readonly("bool_time", &polarity_stats::bool_time);
+	
+	class_<simplify_stats>("SimplifyStats", no_init)
+	.def_readonly("polys", &simplify_stats::polys)
+	.def_readonly("verts_in", &simplify_stats::verts_in)
+	.def_readonly("verts_out", &simplify_stats::verts_out);
+	
+	class_<normalize_stats>("NormalizeStats", no_init)
+	.def_readonly("polys", &normalize_stats::polys)
+	.def_readonly("reversed", &normalize_stats::reversed)
+	.def_readonly("degenerate", &normalize_stats::degenerate)
+	.def_readonly("crossings", &normalize_stats::crossings)
+	.def_readonly("split", &normalize_stats::split)
+	.def_readonly("holes", &normalize_stats::holes);
 	
 	
     bp::class_< GerbObj_wrapper, boost::noncopyable >( "GerbObj", bp::no_init ).def( bp::init< >() )
 	.def( 
 		 "getPolyData"
-		 , (::RenderPoly * ( ::GerbObj::* )(  ) )( &::GerbObj::getPolyData ), return_value_policy<reference_existing_object>())
-	.def("getBounds",&GerbObj::getBounds);
+		 , &::GerbObj::getPolyData)
+	.def("getBounds",&GerbObj::getBounds)
+	.def_readonly("clear",&GerbObj::clear)
+	.def_readonly("id",&GerbObj::id);
     
 	
-    bp::class_< GerbObj_Poly, bp::bases< GerbObj > >( "GerbObj_Poly", bp::init< >() );
+    bp::class_< GerbObj_Poly, bp::bases< GerbObj > >( "GerbObj_Poly", bp::init< >() )
+	.def("getPoints", &poly_points)
+	.def("pack", &GerbObj_Poly::pack)
+	.def("unpack", &GerbObj_Poly::unpack)
+	.add_property("packed", &GerbObj_Poly::isPacked)
+	.add_property("pointBytes", &GerbObj_Poly::pointBytes)
+	.def("getTraps", &poly_traps)
+	.def("getConvexParts", &poly_parts)
+	.def("contains", &poly_contains)
+	.add_property("area", &poly_area);
+	
+	bp::class_< PolyTraps, boost::shared_ptr< PolyTraps >, boost::noncopyable >( "PolyTraps", bp::no_init )
+	.def("contains", &traps_contains)
+	.def("spans", &traps_spans)
+	.add_property("area", &traps_area)
+	.add_property("size", &PolyTraps::size)
+	.add_property("slabs", &PolyTraps::slabCount)
+	.add_property("bytes", &PolyTraps::bytes);
+	bp::def("setPolyTraps", set_poly_traps_enabled);
+	bp::def("polyTrapsEnabled", poly_traps_enabled);
+	bp::def("polyTrapsBytes", poly_traps_bytes);
+	bp::def("polyTrapsCount", poly_traps_count);
 	
 	bp::class_< GerbObj_Line, bp::bases< GerbObj > >( "GerbObj_Line", bp::init< >() )
-	.def_readwrite("sx",&GerbObj_Line::sx)
-	.def_readwrite("sy",&GerbObj_Line::sy)
-	.def_readwrite("ex",&GerbObj_Line::ex)
-	.def_readwrite("ey",&GerbObj_Line::ey)
-	.def_readwrite("width",&GerbObj_Line::width)
-	.def_readwrite("cx",&GerbObj_Line::cx)
-	.def_readwrite("cy",&GerbObj_Line::cy);
+	.add_property("sx",&line_get<&GerbObj_Line::sx>,&line_set<&GerbObj_Line::sx>)
+	.add_property("sy",&line_get<&GerbObj_Line::sy>,&line_set<&GerbObj_Line::sy>)
+	.add_property("ex",&line_get<&GerbObj_Line::ex>,&line_set<&GerbObj_Line::ex>)
+	.add_property("ey",&line_get<&GerbObj_Line::ey>,&line_set<&GerbObj_Line::ey>)
+	.add_property("width",&line_get<&GerbObj_Line::width>,&line_set<&GerbObj_Line::width>)
+	.add_property("cx",&line_get<&GerbObj_Line::cx>,&line_set<&GerbObj_Line::cx>)
+	.add_property("cy",&line_get<&GerbObj_Line::cy>,&line_set<&GerbObj_Line::cy>);
 
 	
 	bp::register_ptr_to_python< boost::shared_ptr< GerbObj > >();
+	bp::register_ptr_to_python< sp_RenderPoly >();
 
 	
 	class_<gerbobjlist_t>("gerbObjList", init<>())
@@ -108,6 +429,78 @@ void gcodeInterpWrap(void)
 	
 	class_<Vector_Outp, boost::shared_ptr<Vector_Outp> >("PolygonLayer", init<>())
 	.def_readonly("all",&Vector_Outp::all)
+	.def_readonly("render",&Vector_Outp::render)
+	.def("getPolyData", &layer_poly_data)
+	.def("queryBounds", &layer_query_bounds)
+	.def("overlappingPairs", &layer_overlapping_pairs)
+	.def("closePairs", &layer_close_pairs)
+	.def("buildGrid", &layer_build_grid, (bp::arg("cell")=0.0))
+	.def("queryGrid", &layer_query_grid)
+	.def("buildIndex", &index_vector_outp)
+	.def("nearest", &layer_nearest, (bp::arg("obj"), bp::arg("k")=1, bp::arg("maxd")=-1.0))
+	.def("nearestPoint", &layer_nearest_point, (bp::arg("x"), bp::arg("y"), bp::arg("k")=1, bp::arg("maxd")=-1.0))
+	.def("within", &layer_within)
+	.def("queryIndex", &layer_query_index)
+	.def_readonly("index", &Vector_Outp::index)
+	.def("reindex", &reindex_vector_outp)
+	// Name from before object ids, kept for scripts that use it
+	.def("rebuildBounds", &reindex_vector_outp)
+	.add_property("cache", make_getter(&Vector_Outp::cache, return_internal_reference<>()))
+	.add_property("grid", make_getter(&Vector_Outp::grid, return_internal_reference<>()))
+	.add_property("rtree", make_getter(&Vector_Outp::rtree, return_internal_reference<>()))
+	;
+	
+	enum_<layer_index_t>("layer_index_t")
+	.value("INDEX_SCAN", INDEX_SCAN)
+	.value("INDEX_GRID", INDEX_GRID)
+	.value("INDEX_RTREE", INDEX_RTREE)
+	;
+	
+	class_<UniformGrid, boost::noncopyable>("UniformGrid", no_init)
+	.add_property("built", &UniformGrid::built)
+	.add_property("cellSize", &grid_cell_size)
+	.add_property("cells", &UniformGrid::cells)
+	.add_property("entries", &UniformGrid::entries)
+	.add_property("big", &UniformGrid::bigCount)
+	.add_property("bytes", &UniformGrid::bytes);
+	
+	class_<PackedRTree, boost::noncopyable>("PackedRTree", no_init)
+	.add_property("built", &PackedRTree::built)
+	.add_property("levels", &PackedRTree::levels)
+	.add_property("slots", &PackedRTree::slots)
+	.add_property("bytes", &PackedRTree::bytes);
+	
+	class_<RenderCache, boost::noncopyable>("RenderCache", no_init)
+	.add_property("budget", &RenderCache::getBudget, &RenderCache::setBudget)
+	.add_property("hits", &RenderCache::getHits)
+	.add_property("misses", &RenderCache::getMisses)
+	.add_property("evictions", &RenderCache::getEvictions)
+	.add_property("bytes", &RenderCache::getBytes)
+	.add_property("entries", &RenderCache::getEntries)
+	.def("clear", &RenderCache::clear);
+	def("objectRenderCache", object_render_cache, return_value_policy<reference_existing_object>());
+	
+	class_<render_span>("render_span", no_init)
+	.def_readonly("first", &render_span::first)
+	.def_readonly("count", &render_span::count)
+	.def_readonly("flag", &render_span::flag)
+	.def_readonly("fillptx", &render_span::fillptx)
+	.def_readonly("fillpty", &render_span::fillpty);
+	
+	class_< std::vector<render_span> >("vector_less__render_span__greater_")
+	.def(vector_indexing_suite< std::vector<render_span> >());
+	
+	class_<RenderLayer, boost::noncopyable>("RenderLayer", no_init)
+	.def_readonly("segs", &RenderLayer::segs)
+	.def_readonly("polys", &RenderLayer::polys);
+	
+	class_<GCODE_Interp, boost::noncopyable>("GCodeInterpreter", init<sp_RS274X_Program>())
+	.def("runBlocks", &GCODE_Interp::runBlocks)
+	.def("runUntilObjects", &GCODE_Interp::runUntilObjects)
+	.def("run", &GCODE_Interp::run)
+	.def("isDone", &GCODE_Interp::isDone)
+	.def("hasFailed", &GCODE_Interp::hasFailed)
+	.def("getOutput", &GCODE_Interp::getOutput)
 	;
 	
 	bp::class_< RenderPoly >( "RenderPoly" )    
@@ -120,11 +513,11 @@ void gcodeInterpWrap(void)
 	.def_readwrite( "r", &RenderPoly::r )    
 	.def_readwrite( "segs", &RenderPoly::segs );
 	
-	{ //::std::vector< point_line* >
-        typedef bp::class_< std::vector< point_line* > > vector_less__point_line_ptr___greater__exposer_t;
-        vector_less__point_line_ptr___greater__exposer_t vector_less__point_line_ptr___greater__exposer = vector_less__point_line_ptr___greater__exposer_t( "vector_less__point_line_ptr___greater_" );
-        bp::scope vector_less__point_line_ptr___greater__scope( vector_less__point_line_ptr___greater__exposer );
-        vector_less__point_line_ptr___greater__exposer.def( bp::vector_indexing_suite< ::std::vector< point_line* > >() );
+	{ //::std::vector< point_line >
+        typedef bp::class_< std::vector< point_line > > vector_less__point_line__greater__exposer_t;
+        vector_less__point_line__greater__exposer_t vector_less__point_line__greater__exposer = vector_less__point_line__greater__exposer_t( "vector_less__point_line__greater_" );
+        bp::scope vector_less__point_line__greater__scope( vector_less__point_line__greater__exposer );
+        vector_less__point_line__greater__exposer.def( bp::vector_indexing_suite< ::std::vector< point_line > >() );
     }
 	
     { //::point_line
@@ -145,21 +538,21 @@ void gcodeInterpWrap(void)
 	
 	bp::register_ptr_to_python< point_line * >();
 
-	bp::class_< Point >( "Point", bp::init< double, double >(( bp::arg("x"), bp::arg("y") )) )    
-	.def( bp::init< >() )    
-	.def_readwrite( "x", &Point::x )    
-	.def_readwrite( "y", &Point::y );
+	bp::class_< Point >( "Point", bp::init< >() )    
+	.def( "__init__", bp::make_constructor(&point_new, bp::default_call_policies(), ( bp::arg("x"), bp::arg("y") )) )    
+	.add_property( "x", &point_get_x, &point_set_x )    
+	.add_property( "y", &point_get_y, &point_set_y );
 	
 	// Auto-generated
     bp::class_< Rect >( "Rect", bp::init< >() )    
-	.def( bp::init< double, double, double, double >(( bp::arg("x1"), bp::arg("y1"), bp::arg("x2"), bp::arg("y2") )) )    
+	.def( "__init__", bp::make_constructor(&rect_new, bp::default_call_policies(), ( bp::arg("x1"), bp::arg("y1"), bp::arg("x2"), bp::arg("y2") )) )    
 	.def( 
 		 "feather"
-		 , (void ( ::Rect::* )( double ) )( &::Rect::feather )
+		 , &rect_feather
 		 , ( bp::arg("s") ) )    
 	.def( 
 		 "feather"
-		 , (void ( ::Rect::* )( double,double ) )( &::Rect::feather )
+		 , &rect_feather_xy
 		 , ( bp::arg("x"), bp::arg("y") ) )    
 	.def( 
 		 "getCWP1"
@@ -172,35 +565,41 @@ void gcodeInterpWrap(void)
 		 , (::Point ( ::Rect::* )(  ) const)( &::Rect::getEndPoint ) )    
 	.def( 
 		 "getHeight"
-		 , (double ( ::Rect::* )(  ) const)( &::Rect::getHeight ) )    
+		 , &rect_height )    
 	.def( 
 		 "getStartPoint"
 		 , (::Point ( ::Rect::* )(  ) const)( &::Rect::getStartPoint ) )    
 	.def( 
 		 "getWidth"
-		 , (double ( ::Rect::* )(  ) const)( &::Rect::getWidth ) )    
+		 , &rect_width )    
 	.def( 
 		 "intersectsWith"
 		 , (bool ( ::Rect::* )( ::Rect const & ) )( &::Rect::intersectsWith )
 		 , ( bp::arg("r") ) )    
+	.def( 
+		 "isSet"
+		 , (bool ( ::Rect::* )(  ) const)( &::Rect::isSet ) )    
 	.def( 
 		 "mergeBounds"
 		 , (void ( ::Rect::* )( ::Rect const & ) )( &::Rect::mergeBounds )
 		 , ( bp::arg("r") ) )    
 	.def( 
 		 "mergePoint"
-		 , &::Rect::mergePoint, mergePointOverloads())    
+		 , &rect_merge_point )    
+	.def( 
+		 "mergePoint"
+		 , &rect_merge_point_radius )    
 	.def( 
 		 "pointInRectClosed"
 		 , (bool ( ::Rect::* )( ::Point ) const)( &::Rect::pointInRectClosed )
 		 , ( bp::arg("a") ) )    
 	.def( 
 		 "pointInRectClosed"
-		 , (bool ( ::Rect::* )( double,double ) const)( &::Rect::pointInRectClosed )
+		 , &rect_in_closed
 		 , ( bp::arg("x"), bp::arg("y") ) )    
 	.def( 
 		 "pointInRectOpen"
-		 , (bool ( ::Rect::* )( double,double ) const)( &::Rect::pointInRectOpen )
+		 , &rect_in_open
 		 , ( bp::arg("x"), bp::arg("y") ) )    
 	.def( 
 		 "printRect"
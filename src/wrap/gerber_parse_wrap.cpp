@@ -41,7 +41,7 @@ static boost::python::object gcodeBlockValueHelper(RS274X_Program::gcode_block b
 		case RS274X_Program::GCO_Y:
 		case RS274X_Program::GCO_I:
 		case RS274X_Program::GCO_J:
-			return object(blk.dbl_data);
+			return object(blk.coord_data.value / pow(10.0, blk.coord_data.frac));
 		
 		case RS274X_Program::GCO_DIR:
 		case RS274X_Program::GCO_END:
@@ -131,9 +131,12 @@ void gerberParserWrap()
 	.def("__len__", &r274opl_t::size);
 	
 	
-	class_<RS274X_Program, boost::shared_ptr<RS274X_Program> >("RS274X_Program",init<>())
+	class_<RS274X_Program, boost::shared_ptr<RS274X_Program>, boost::noncopyable>("RS274X_Program",init<>())
 		.def_readonly("operations", &RS274X_Program::m_operations)
-		.def_readonly("apertures", &RS274X_Program::m_ap_map);
+		.def_readonly("apertures", &RS274X_Program::m_ap_map)
+		.def_readonly("macro_cache_hits", &RS274X_Program::m_macro_cache_hits)
+		.def_readonly("macro_cache_misses", &RS274X_Program::m_macro_cache_misses)
+		.def("flushMacroCache", &RS274X_Program::flushMacroCache);
 		
 
     def("parseFile", parseRS274X);
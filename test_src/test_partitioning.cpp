@@ -9,10 +9,9 @@ int main()
 	a.insert(0,0,2);
 	a.insert(1,1,4);
 	a.insert(2,2,5);
-	std::set<int> n = a.retrieve(0,0,2);
+	Part2D<int>::cell_t n = a.retrieve(0,0,2);
 	
-	std::set<int>::iterator it = n.begin();
+	Part2D<int>::cell_t::iterator it = n.begin();
 	for (;it!=n.end(); it++)
 		std::cout << *it << std::endl;
 }
-
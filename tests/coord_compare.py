@@ -0,0 +1,234 @@
+#!/usr/bin/python
+#
+# End to end check of the fixed point coordinates: interpret the same
+# generated layers with two builds of the module, and compare what they
+# draw. Every object must be there in both, with the same segment kinds,
+# and no coordinate may move by more than the tolerance.
+#
+# Build the revision before the change in a second checkout, then run
+# from the top of the tree:
+#
+#   python tests/coord_compare.py ../old-checkout .
+#
+# The layers:
+#   t0-t5  lines, arcs, regions, every standard aperture, macros and
+#          clear polarity, in inch and mm formats of 3 to 6 decimals
+#   d      repeated pads, redrawn traces and filled regions
+#   m      chains of collinear traces
+#   p      a large plane of pads and round regions
+#
+import os
+import sys
+import math
+import random
+import shutil
+import tempfile
+import subprocess
+from optparse import OptionParser, SUPPRESS_HELP
+
+def layer_t(fmt, units, seed, n=400):
+	r = random.Random(seed)
+	lead, trail = fmt
+	sc = 10**trail
+	span = 2.0 if units == 'IN' else 50.0
+	def c(v): return str(int(round(v*sc)))
+	L = ["%%FSLAX%d%dY%d%d*%%" % (lead, trail, lead, trail), "%%MO%s*%%" % units]
+	u = 1 if units == 'MM' else 1/25.4
+	L += ["%%AMBOX*21,1,%f,%f,0,0,30*1,1,%f,%f,0*20,1,%f,0,0,%f,%f,15*%%" % (1.2*u, 0.7*u, 0.4*u, 0.3*u, 0.2*u, 0.9*u, 0.5*u),
+		"%%AMTH*7,0,0,%f,%f,%f,45*%%" % (2*u, 1.5*u, 0.2*u),
+		"%%ADD10C,%f*%%" % (0.25*u), "%%ADD11R,%fX%f*%%" % (1.1*u, 0.6*u), "%%ADD12O,%fX%f*%%" % (0.5*u, 1.3*u),
+		"%%ADD13P,%fX6X15*%%" % (1.0*u), "%ADD14BOX*%", "%ADD15TH*%", "%%ADD16C,%f*%%" % (0.77*u), "G75*"]
+	x = y = 0
+	for i in range(n):
+		k = r.random()
+		if k < 0.3:
+			L.append("D10*" if r.random() < .5 else "D16*")
+			L.append("X%sY%sD02*" % (c(x), c(y)))
+			x += r.uniform(-.3, .3)*span/5
+			y += r.uniform(-.3, .3)*span/5
+			L.append("G01X%sY%sD01*" % (c(x), c(y)))
+		elif k < 0.5:
+			L.append("D%d*" % r.choice([10, 11, 12, 13, 14, 15, 16]))
+			L.append("X%sY%sD03*" % (c(r.uniform(0, span)), c(r.uniform(0, span))))
+		elif k < 0.65:
+			L.append("D10*")
+			cx, cy = r.uniform(0, span), r.uniform(0, span)
+			rad = r.uniform(.02, .2)*span/5
+			L.append("X%sY%sD02*" % (c(cx+rad), c(cy)))
+			L.append("G03X%sY%sI%sJ0D01*" % (c(cx), c(cy+rad), c(-rad)))
+			L.append("G01*")
+		elif k < 0.75:
+			cx, cy = r.uniform(0, span), r.uniform(0, span)
+			s = r.uniform(.05, .3)*span/5
+			L.append("G36*")
+			L.append("X%sY%sD02*" % (c(cx), c(cy)))
+			L.append("G01X%sY%sD01*" % (c(cx+s), c(cy)))
+			L.append("X%sY%sD01*" % (c(cx+s*1.3), c(cy+s)))
+			L.append("X%sY%sD01*" % (c(cx), c(cy+s*0.8)))
+			L.append("X%sY%sD01*" % (c(cx), c(cy)))
+			L.append("G37*")
+		elif k < 0.8:
+			L.append("%LPC*%")
+			L.append("D16*")
+			L.append("X%sY%sD03*" % (c(r.uniform(0, span)), c(r.uniform(0, span))))
+			L.append("%LPD*%")
+	return L
+
+def layer_d():
+	r = random.Random(7)
+	L = ["%FSLAX24Y24*%", "%MOIN*%", "%ADD10C,0.010*%", "%ADD11C,0.060*%", "%ADD12R,0.060X0.040*%",
+		"%ADD13C,0.020*%", "%ADD14P,0.08X6*%"]
+	for t in range(300):
+		k = r.random()
+		x, y = r.randint(0, 20000), r.randint(0, 20000)
+		if k < .3:
+			L += ["D%d*" % r.choice([11, 12, 14]), "X%dY%dD03*" % (x, y)]
+			if r.random() < .5:
+				L += ["X%dY%dD03*" % (x, y)]
+			if r.random() < .3:
+				L += ["D13*", "X%dY%dD03*" % (x+r.randint(-80, 80), y+r.randint(-80, 80))]
+		elif k < .6:
+			L += ["D10*", "X%dY%dD02*" % (x, y), "X%dY%dD01*" % (x+500, y+200)]
+			if r.random() < .4:
+				L += ["X%dY%dD02*" % (x+500, y+200), "X%dY%dD01*" % (x, y)]
+		elif k < .8:
+			fill = ["G36*", "X%dY%dD02*" % (x, y), "G01X%dY%dD01*" % (x+800, y), "X%dY%dD01*" % (x+800, y+600),
+				"X%dY%dD01*" % (x, y+600), "X%dY%dD01*" % (x, y), "G37*"]
+			L += fill
+			L += ["D13*", "X%dY%dD02*" % (x+100, y+100), "X%dY%dD01*" % (x+700, y+500)]
+			if r.random() < .5:
+				L += fill
+		else:
+			L += ["%LPC*%", "D11*", "X%dY%dD03*" % (x, y), "%LPD*%", "D11*", "X%dY%dD03*" % (x, y)]
+	return L
+
+def layer_m():
+	r = random.Random(5)
+	L = ["%FSLAX24Y24*%", "%MOIN*%", "%ADD10C,0.010*%", "%ADD11C,0.020*%", "%ADD12C,0.050*%"]
+	for t in range(150):
+		L.append("D%d*" % r.choice([10, 11]))
+		x0, y0 = r.randint(0, 20000), r.randint(0, 20000)
+		dx, dy = r.choice([(1, 0), (0, 1), (1, 1), (2, 1), (-1, 3)])
+		n = r.randint(1, 6)
+		step = r.randint(10, 300)
+		pts = [(x0 + dx*step*i, y0 + dy*step*i) for i in range(n+1)]
+		if r.random() < .3:
+			pts.append((pts[-1][0] + step, pts[-1][1]))
+		L.append("X%dY%dD02*" % pts[0])
+		for p in pts[1:]:
+			L.append("X%dY%dD01*" % p)
+		if r.random() < .1:
+			L += ["%LPC*%", "D12*", "X%dY%dD03*" % pts[len(pts)//2], "%LPD*%"]
+	return L
+
+def layer_p():
+	r = random.Random(3)
+	L = ["%FSLAX24Y24*%", "%MOIN*%", "%ADD11R,0.060X0.040*%", "%ADD12P,0.080X8*%", "%ADD13O,0.02X0.05*%"]
+	for t in range(60000):
+		x, y = r.randint(0, 100000), r.randint(0, 100000)
+		L += ["D%d*" % r.choice([11, 12, 12]), "X%dY%dD03*" % (x, y)]
+	for t in range(3000):
+		x, y = r.randint(0, 100000), r.randint(0, 100000)
+		n = r.randint(8, 60)
+		rad = r.randint(50, 400)
+		pts = [(x+int(rad*math.cos(2*math.pi*i/n)), y+int(rad*math.sin(2*math.pi*i/n))) for i in range(n)]
+		L.append("G36*")
+		L.append("X%dY%dD02*" % pts[0])
+		for p in pts[1:]+pts[:1]:
+			L.append("G01X%dY%dD01*" % p)
+		L.append("G37*")
+	return L
+
+def write_layers(d):
+	layers = {}
+	formats = [((2, 4), 'IN'), ((2, 6), 'IN'), ((2, 5), 'IN'), ((3, 3), 'MM'), ((4, 6), 'MM'), ((3, 4), 'MM')]
+	for i, (f, u) in enumerate(formats):
+		layers["t%d" % i] = layer_t(f, u, i)
+	layers["d"] = layer_d()
+	layers["m"] = layer_m()
+	layers["p"] = layer_p()
+	for name in layers:
+		open(os.path.join(d, name + ".gbr"), "w").write("\n".join(layers[name] + ["M02*"]) + "\n")
+	return sorted(layers)
+
+# Run in a child, so each build's module is imported on its own
+def dump(build, layer):
+	sys.path.insert(0, build)
+	import _gerber_utils as g
+	out = g.runRS274XProgram(g.parseFile(layer))
+	w = sys.stdout.write
+	for o in out.all:
+		b = o.getBounds()
+		s, e = b.getStartPoint(), b.getEndPoint()
+		w("B %.3f %.3f %.3f %.3f\n" % (s.x, s.y, e.x, e.y))
+		p = o.getPolyData()
+		if p is None:
+			continue
+		for seg in p.segs:
+			arc = int(seg.lt)
+			w("P %d %.3f %.3f %.3f %.3f\n" % (arc, seg.x, seg.y, seg.cx if arc else 0, seg.cy if arc else 0))
+
+def run_dump(build, layer):
+	return subprocess.check_output([sys.executable, os.path.abspath(__file__),
+		"--dump", build, layer]).decode().split("\n")
+
+# Largest coordinate difference [um], and the number of lines that don't
+# describe the same thing
+def compare(a, b):
+	worst = 0
+	kinds = abs(len(a) - len(b))
+	for x, y in zip(a, b):
+		xs, ys = x.split(), y.split()
+		if not xs and not ys:
+			continue
+		if not xs or not ys or xs[0] != ys[0] or (xs[0] == 'P' and xs[1] != ys[1]):
+			kinds += 1
+			continue
+		vals = xs[2:] if xs[0] == 'P' else xs[1:]
+		for p, q in zip(vals, ys[len(ys)-len(vals):]):
+			worst = max(worst, abs(float(p) - float(q)))
+	return worst, kinds
+
+def main():
+	usage = "usage: %prog [options] old_build_dir new_build_dir"
+	o = OptionParser(usage=usage)
+	o.add_option("-t", "--tolerance",
+		type="float", dest="tol", default=0.01,
+		help="largest coordinate difference allowed [um]")
+	o.add_option("-k", "--keep",
+		type="str", dest="keep", default=None,
+		help="write the layers to this directory and keep them")
+	o.add_option("--dump", dest="dump", default=False, action="store_true",
+		help=SUPPRESS_HELP)
+	opts, args = o.parse_args()
+
+	if opts.dump:
+		dump(args[0], args[1])
+		return 0
+
+	if len(args) != 2:
+		o.error("need the two build directories")
+
+	d = opts.keep or tempfile.mkdtemp()
+	if not os.path.isdir(d):
+		os.makedirs(d)
+	failed = 0
+	try:
+		for name in write_layers(d):
+			layer = os.path.join(d, name + ".gbr")
+			a = run_dump(os.path.abspath(args[0]), layer)
+			b = run_dump(os.path.abspath(args[1]), layer)
+			worst, kinds = compare(a, b)
+			objs = len([x for x in a if x.startswith("B")])
+			ok = worst <= opts.tol and kinds == 0
+			if not ok:
+				failed += 1
+			print("%-3s %6d objects  max diff %.4f um  %d mismatched  %s" %
+				(name, objs, worst, kinds, "ok" if ok else "FAILED"))
+	finally:
+		if not opts.keep:
+			shutil.rmtree(d)
+	return 1 if failed else 0
+
+if __name__ == "__main__":
+	sys.exit(main())
@@ -1,2 +1,3 @@
-g++ -g -DINT_ASSERT test_main.cpp test_polymath.cpp  ../src/polymath.cpp && ./a.out 
-
+LAYER="../src/util.cpp ../src/fileio.cpp ../src/macro_parser.cpp ../src/macro_vm.cpp ../src/util_type.cpp ../src/gerber_parse.cpp \
+	../src/gerbobj_line.cpp ../src/gerbobj_poly.cpp ../src/gcode_interp.cpp ../src/ring.cpp ../src/polygonize.cpp ../src/polarity.cpp ../src/merge_lines.cpp ../src/dedup.cpp ../src/inpoly.cpp ../src/render.cpp ../src/bounds.cpp ../src/capsule.cpp ../src/packed_points.cpp ../src/simplify.cpp ../src/normalize.cpp ../src/trapezoid.cpp ../src/convex.cpp ../src/grid.cpp ../src/rtree.cpp"
+g++ -g -DINT_ASSERT test_main.cpp test_polymath.cpp test_macro.cpp test_parallel.cpp test_polarity.cpp test_coord.cpp test_merge.cpp test_dedup.cpp test_inpoly.cpp test_render.cpp test_bounds.cpp test_capsule.cpp test_packed_points.cpp test_simplify.cpp test_normalize.cpp test_trapezoid.cpp test_convex.cpp test_grid.cpp test_rtree.cpp test_visit.cpp test_nearest.cpp test_hiergrid.cpp ../src/polymath.cpp $LAYER -lpthread && ./a.out 
@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "test_funcs.h"
+#include "../src/bounds.h"
+#include "../src/gerbobj_poly.h"
+
+static unsigned int bnd_seed;
+
+static coord_t bnd_rnd(coord_t lo, coord_t hi)
+{
+	bnd_seed = bnd_seed * 1103515245 + 12345;
+	return lo + (coord_t)((bnd_seed >> 8) & 0xffff) * (hi - lo) / 65536;
+}
+
+static GerbObj * bnd_rect(coord_t x0, coord_t y0, coord_t x1, coord_t y1)
+{
+	GerbObj_Poly * p = new GerbObj_Poly();
+	p->addPoint(Point(x0, y0));
+	p->addPoint(Point(x1, y0));
+	p->addPoint(Point(x1, y1));
+	p->addPoint(Point(x0, y1));
+	return p;
+}
+
+// Boxes scattered over a 10000 step square, around the origin, plus one
+// empty polygon with no bounds at all
+static void bnd_layer(std::list<sp_GerbObj> & all, int n)
+{
+	bnd_seed = 11;
+	for (int i=0; i < n; i++)
+	{
+		coord_t x = bnd_rnd(-5000, 5000), y = bnd_rnd(-5000, 5000);
+		all.push_back(sp_GerbObj(bnd_rect(x, y, x + bnd_rnd(0, 400), y + bnd_rnd(0, 400))));
+	}
+	all.push_back(sp_GerbObj(new GerbObj_Poly()));
+}
+
+// The two boxes are no more than d apart on both axes
+static bool bnd_near(Rect a, Rect b, coord_t d)
+{
+	if (!a.isSet() || !b.isSet())
+		return false;
+	return a.getStartPoint().x <= b.getEndPoint().x + d && b.getStartPoint().x <= a.getEndPoint().x + d &&
+		a.getStartPoint().y <= b.getEndPoint().y + d && b.getStartPoint().y <= a.getEndPoint().y + d;
+}
+
+void bounds_query_test(void)
+{
+	START_TEST("BoundsTable::query");
+	std::list<sp_GerbObj> all;
+	bnd_layer(all, 600);
+	BoundsTable t;
+	t.rebuild(all);
+	TEST_EQUALS_I(t.size(), all.size());
+	
+	// Against a plain getBounds test. The last query only touches
+	// boxes at their edges
+	Rect qs[] = {Rect(-1000, -1000, 1000, 1000), Rect(2000, -4000, 2100, 5000),
+		Rect(-6000, -6000, 6000, 6000), Rect(0, 0, 0, 0)};
+	int bad = 0;
+	for (int q=0; q < 4; q++)
+	{
+		std::vector<unsigned int> out;
+		t.query(qs[q], out);
+		unsigned int k = 0, i = 0;
+		std::list<sp_GerbObj>::iterator it = all.begin();
+		for (; it != all.end(); it++, i++)
+		{
+			bool want = bnd_near((*it)->getBounds(), qs[q], 0);
+			bool got = k < out.size() && out[k] == i;
+			if (got)
+				k++;
+			if (want != got)
+				bad++;
+		}
+		if (k != out.size())
+			bad++;
+	}
+	TEST_EQUALS_I(bad, 0);
+	
+	// Touching counts, the box is closed
+	std::vector<unsigned int> out;
+	BoundsTable e;
+	e.append(NULL, Rect(0, 0, 10, 10));
+	e.query(Rect(10, 10, 20, 20), out);
+	TEST_EQUALS_I(out.size(), 1);
+	
+	// An unset rect finds nothing, not the boxes over the origin
+	out.clear();
+	e.query(Rect(), out);
+	t.query(Rect(), out);
+	TEST_EQUALS_I(out.size(), 0);
+	END_TEST();
+}
+
+void bounds_pairs_test(void)
+{
+	START_TEST("BoundsTable::overlapping_pairs");
+	std::list<sp_GerbObj> all;
+	bnd_layer(all, 600);
+	BoundsTable t;
+	t.rebuild(all);
+	
+	std::vector<Rect> r;
+	std::list<sp_GerbObj>::iterator it = all.begin();
+	for (; it != all.end(); it++)
+		r.push_back((*it)->getBounds());
+	
+	coord_t ds[] = {0, 1, 150};
+	int bad = 0;
+	for (int k=0; k < 3; k++)
+	{
+		std::vector<bounds_pair_t> want, got;
+		for (unsigned int i=0; i < r.size(); i++)
+			for (unsigned int j=i + 1; j < r.size(); j++)
+				if (bnd_near(r[i], r[j], ds[k]))
+					want.push_back(bounds_pair_t(i, j));
+		t.overlapping_pairs(ds[k], got);
+		if (got != want)
+			bad++;
+		if (k == 2 && want.size() <= 600)
+			bad++;
+	}
+	TEST_EQUALS_I(bad, 0);
+	
+	// A gap of exactly d is a pair, one step more isn't
+	BoundsTable g;
+	g.append(NULL, Rect(0, 0, 10, 10));
+	g.append(NULL, Rect(20, 0, 30, 10));
+	g.append(NULL, Rect());
+	std::vector<bounds_pair_t> out;
+	g.overlapping_pairs(9, out);
+	TEST_EQUALS_I(out.size(), 0);
+	g.overlapping_pairs(10, out);
+	TEST_EQUALS_I(out.size(), 1);
+	TEST_ASSERT(out[0] == bounds_pair_t(0, 1));
+	END_TEST();
+}
+
+void bounds_tests(void)
+{
+	bounds_query_test();
+	bounds_pairs_test();
+}
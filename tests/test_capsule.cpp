@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "test_funcs.h"
+#include "../src/capsule.h"
+#include "../src/ring.h"
+
+// Brute force: walk both spines in small steps, the true gap is at most
+// one step below what this finds
+static double sampled_gap(const struct capsule & x, const struct capsule & y, int steps)
+{
+	double best = INFINITY;
+	for (int i=0; i <= steps; i++)
+	{
+		double px = x.a.x + (double)(x.b.x - x.a.x) * i / steps;
+		double py = x.a.y + (double)(x.b.y - x.a.y) * i / steps;
+		for (int j=0; j <= steps; j++)
+		{
+			double qx = y.a.x + (double)(y.b.x - y.a.x) * j / steps;
+			double qy = y.a.y + (double)(y.b.y - y.a.y) * j / steps;
+			double d = hypot(px - qx, py - qy);
+			if (d < best)
+				best = d;
+		}
+	}
+	return best - x.r - y.r;
+}
+
+static double spine_len(const struct capsule & c)
+{
+	return hypot((double)(c.b.x - c.a.x), (double)(c.b.y - c.a.y));
+}
+
+static struct capsule random_capsule(void)
+{
+	struct capsule c;
+	c.a = Point(rand() % 100000, rand() % 100000);
+	c.b = Point(c.a.x + rand() % 40000 - 20000, c.a.y + rand() % 40000 - 20000);
+	c.r = 100 + rand() % 5000;
+	return c;
+}
+
+void capsule_gap_test(void)
+{
+	START_TEST("capsule_gap (against sampled spines)");
+	srand(1);
+	int bad = 0;
+	for (int i=0; i < 200; i++)
+	{
+		struct capsule x = random_capsule(), y = random_capsule();
+		const int steps = 400;
+		double slack = (spine_len(x) + spine_len(y)) / steps;
+		double g = capsule_gap(x, y), s = sampled_gap(x, y, steps);
+		if (g > s + 1e-6 || g < s - slack - 1e-6 || fabs(g - capsule_gap(y, x)) > 1e-6)
+			bad++;
+	}
+	TEST_EQUALS_I(bad, 0);
+	END_TEST();
+}
+
+void capsule_gap_cross_test(void)
+{
+	START_TEST("capsule_gap (crossing and parallel)");
+	struct capsule x = {Point(0, 0), Point(10000, 10000), 500};
+	struct capsule y = {Point(0, 10000), Point(10000, 0), 250};
+	TEST_EQUALS_F(capsule_gap(x, y), -750);
+	
+	struct capsule p = {Point(0, 0), Point(10000, 0), 500};
+	struct capsule q = {Point(5000, 3000), Point(20000, 3000), 500};
+	TEST_EQUALS_F(capsule_gap(p, q), 2000);
+	
+	TEST_EQUALS_F(capsule_point_dist(p, Point(5000, 0)), -500);
+	TEST_EQUALS_F(capsule_point_dist(p, Point(13000, 4000)), 4500);
+	
+	// Spines that only touch end to end, or overlap along a line
+	TEST_OUTPUT(segs_cross(Point(0, 0), Point(10, 0), Point(10, 0), Point(20, 5)));
+	TEST_OUTPUT(segs_cross(Point(0, 0), Point(10, 0), Point(5, 0), Point(20, 0)));
+	TEST_OUTPUT(!segs_cross(Point(0, 0), Point(10, 0), Point(11, 0), Point(20, 0)));
+	TEST_OUTPUT(!segs_cross(Point(0, 0), Point(10, 0), Point(0, 1), Point(10, 1)));
+	END_TEST();
+}
+
+void capsule_ring_test(void)
+{
+	START_TEST("capsule_meets_ring");
+	Point sq[4] = {Point(0, 0), Point(10000, 0), Point(10000, 10000), Point(0, 10000)};
+	
+	// Beside the right edge, just clear and just touching
+	struct capsule near = {Point(10600, 2000), Point(10600, 8000), 599};
+	TEST_OUTPUT(!capsule_meets_ring(near, sq, 4));
+	near.r = 600;
+	TEST_OUTPUT(capsule_meets_ring(near, sq, 4));
+	
+	// Wholly inside, and swallowing the whole ring
+	struct capsule in = {Point(2000, 2000), Point(3000, 3000), 100};
+	TEST_OUTPUT(capsule_meets_ring(in, sq, 4));
+	struct capsule over = {Point(5000, -50000), Point(5000, 50000), 20000};
+	TEST_OUTPUT(capsule_meets_ring(over, sq, 4));
+	
+	// Crossing clean through without an end inside
+	struct capsule thru = {Point(-5000, 5000), Point(15000, 5000), 10};
+	TEST_OUTPUT(capsule_meets_ring(thru, sq, 4));
+	
+	// Off a corner: the square corner is sqrt(2) * 1000 away
+	struct capsule corner = {Point(11000, 11000), Point(20000, 20000), 1400};
+	TEST_OUTPUT(!capsule_meets_ring(corner, sq, 4));
+	corner.r = 1420;
+	TEST_OUTPUT(capsule_meets_ring(corner, sq, 4));
+	END_TEST();
+}
+
+void arc_steps_test(void)
+{
+	START_TEST("arc_steps_for_tol");
+	coord_t rs[] = {1000, 50000, 127000, 2500000};
+	coord_t tols[] = {1, 10, 100, 1000};
+	int bad = 0;
+	for (int i=0; i < 4; i++)
+		for (int j=0; j < 4; j++)
+		{
+			coord_t r = rs[i], tol = tols[j];
+			int n = arc_steps_for_tol(r, tol, 100000);
+			
+			// Chord over pi / n strays no more than tol, and one step
+			// fewer would stray further
+			if (n < 2 || r * (1 - cos(M_PI / n / 2)) > tol + 1e-9)
+				bad++;
+			if (n > 2 && r * (1 - cos(M_PI / (n - 1) / 2)) <= tol)
+				bad++;
+		}
+	TEST_EQUALS_I(bad, 0);
+	TEST_EQUALS_I(arc_steps_for_tol(1000000, 1, 64), 64);
+	TEST_EQUALS_I(arc_steps_for_tol(1000000, 0, 64), 64);
+	TEST_EQUALS_I(arc_steps_for_tol(500, 1000, 64), 2);
+	END_TEST();
+}
+
+void capsule_tests(void)
+{
+	capsule_gap_test();
+	capsule_gap_cross_test();
+	capsule_ring_test();
+	arc_steps_test();
+}
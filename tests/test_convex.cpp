@@ -0,0 +1,182 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+
+#include "test_funcs.h"
+#include "../src/convex.h"
+#include "../src/trapezoid.h"
+#include "../src/gerbobj_line.h"
+#include "../src/gerbobj_poly.h"
+
+static GerbObj_Line * make_line(coord_t sx, coord_t sy, coord_t ex, coord_t ey, coord_t w)
+{
+	GerbObj_Line * l = new GerbObj_Line();
+	l->sx = sx;
+	l->sy = sy;
+	l->ex = ex;
+	l->ey = ey;
+	l->cx = l->cy = 0;
+	l->width = w;
+	l->lt = LT_STRAIGHT;
+	l->lc = GerbObj_Line::LC_ROUND;
+	return l;
+}
+
+static GerbObj_Poly * make_poly(const ring_t & r)
+{
+	GerbObj_Poly * p = new GerbObj_Poly();
+	for (unsigned int i=0; i < r.size(); i++)
+		p->addPoint(r[i]);
+	return p;
+}
+
+/* Brute force reference: everything by vertex and edge */
+
+static double seg_seg(const Point & a, const Point & b, const Point & c, const Point & d)
+{
+	if (segs_cross(a, b, c, d))
+		return 0;
+	return fmin(fmin(pt_seg_dist(a, c, d), pt_seg_dist(b, c, d)), fmin(pt_seg_dist(c, a, b), pt_seg_dist(d, a, b)));
+}
+
+// Filled region of r [any winding] to the segment a-b
+static double ring_seg(const ring_t & r, const Point & a, const Point & b)
+{
+	if (point_in_ring(r, a))
+		return 0;
+	double best = INFINITY;
+	for (unsigned int i=0; i < r.size(); i++)
+		best = fmin(best, seg_seg(a, b, r[i], r[(i + 1) % r.size()]));
+	return best;
+}
+
+static double ring_ring(const ring_t & x, const ring_t & y)
+{
+	if (point_in_ring(x, y[0]) || point_in_ring(y, x[0]))
+		return 0;
+	double best = INFINITY;
+	for (unsigned int i=0; i < x.size(); i++)
+		best = fmin(best, ring_seg(y, x[i], x[(i + 1) % x.size()]));
+	return best;
+}
+
+static bool close_enough(double got, double want)
+{
+	return fabs(got - want) <= 1e-3 + 1e-9 * want;
+}
+
+void convex_parts_test(void)
+{
+	START_TEST("ConvexParts (pieces cover the outline)");
+	srand(6);
+	int bad_area = 0, bad_turn = 0;
+	for (int k=0; k < 50; k++)
+	{
+		ring_t r = random_star(Point(0, 0), 1000, 50000, 4 + rand() % 30);
+		if (r.size() < 3 || ring_area(r) == 0)
+			continue;
+		PolyTraps t(r);
+		ConvexParts cp(r, &t);
+		
+		double a = 0;
+		for (unsigned int i=0; i < cp.pieces.size(); i++)
+		{
+			const struct convex_piece & pc = cp.pieces[i];
+			for (unsigned int j=0; j < pc.count; j++)
+			{
+				const struct cvx_point & p = cp.pts[pc.first + j];
+				const struct cvx_point & q = cp.pts[pc.first + (j + 1) % pc.count];
+				const struct cvx_point & s = cp.pts[pc.first + (j + 2) % pc.count];
+				a += (p.x * q.y - q.x * p.y) / 2;
+				
+				// Counterclockwise pieces only ever turn left
+				if ((q.x - p.x) * (s.y - q.y) - (q.y - p.y) * (s.x - q.x) < -1e-6)
+					bad_turn++;
+			}
+		}
+		if (fabs(a - fabs(ring_area(r))) > 1e-6 * fabs(ring_area(r)))
+			bad_area++;
+	}
+	TEST_EQUALS_I(bad_area, 0);
+	TEST_EQUALS_I(bad_turn, 0);
+	END_TEST();
+}
+
+void convex_gap_test(void)
+{
+	START_TEST("obj_gap (against vertex and edge distances)");
+	srand(7);
+	int bad_pp = 0, bad_pl = 0, bad_ll = 0, bad_pt = 0;
+	for (int k=0; k < 200; k++)
+	{
+		ring_t ra = random_star(Point(rand() % 100000, rand() % 100000), 500, 20000, 3 + rand() % 20);
+		ring_t rb = random_star(Point(rand() % 100000, rand() % 100000), 500, 20000, 3 + rand() % 20);
+		if (ra.size() < 3 || rb.size() < 3 || ring_area(ra) == 0 || ring_area(rb) == 0)
+			continue;
+		
+		GerbObj_Poly * pa = make_poly(ra), * pb = make_poly(rb);
+		if (!close_enough(obj_gap(pa, pb), ring_ring(ra, rb)))
+			bad_pp++;
+		
+		Point a(rand() % 100000, rand() % 100000), b(rand() % 100000, rand() % 100000);
+		coord_t w = 2 * (100 + rand() % 5000);
+		GerbObj_Line * la = make_line(a.x, a.y, b.x, b.y, w);
+		if (!close_enough(obj_gap(la, pa), fmax(0, ring_seg(ra, a, b) - w / 2)))
+			bad_pl++;
+		if (!close_enough(obj_gap(pb, la), fmax(0, ring_seg(rb, a, b) - w / 2)))
+			bad_pl++;
+		
+		Point c(rand() % 100000, rand() % 100000), d(rand() % 100000, rand() % 100000);
+		coord_t w2 = 2 * (100 + rand() % 5000);
+		GerbObj_Line * lb = make_line(c.x, c.y, d.x, d.y, w2);
+		if (!close_enough(obj_gap(la, lb), fmax(0, seg_seg(a, b, c, d) - w / 2 - w2 / 2)))
+			bad_ll++;
+		
+		if (!close_enough(point_gap(pa, c.x, c.y), ring_seg(ra, c, c)))
+			bad_pt++;
+		
+		delete pa;
+		delete pb;
+		delete la;
+		delete lb;
+	}
+	TEST_EQUALS_I(bad_pp, 0);
+	TEST_EQUALS_I(bad_pl, 0);
+	TEST_EQUALS_I(bad_ll, 0);
+	TEST_EQUALS_I(bad_pt, 0);
+	END_TEST();
+}
+
+void convex_stop_test(void)
+{
+	START_TEST("obj_gap (stop early)");
+	ring_t r;
+	r.push_back(Point(0, 0));
+	r.push_back(Point(1000, 0));
+	r.push_back(Point(1000, 1000));
+	r.push_back(Point(0, 1000));
+	GerbObj_Poly * p = make_poly(r);
+	GerbObj_Line * l = make_line(3000, -5000, 3000, 5000, 1000);
+	
+	TEST_EQUALS_F(obj_gap(p, l), 1500);
+	// Anything found within stop will do, but never a gap under the real one
+	double g = obj_gap(p, l, 1e9);
+	TEST_OUTPUT(g >= 1500 && g <= 1e9);
+	
+	GerbObj_Line * over = make_line(500, 500, 5000, 500, 10);
+	TEST_EQUALS_F(obj_gap(p, over), 0);
+	TEST_EQUALS_F(point_gap(p, 500, 500), 0);
+	TEST_EQUALS_F(point_gap(l, 3000, 7000), 1500);
+	delete p;
+	delete l;
+	delete over;
+	END_TEST();
+}
+
+void convex_tests(void)
+{
+	convex_parts_test();
+	convex_gap_test();
+	convex_stop_test();
+}
@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "test_funcs.h"
+#include "../src/util_type.h"
+
+/*
+ * What the parser and interpreter produced before coordinates were fixed
+ * point: the digits divided down in doubles, then scaled to microns
+ */
+static double old_unit_convert(long long value, int frac, enum unit_mode um)
+{
+	double v = value;
+	while (frac > 0)
+	{
+		frac--;
+		v = v / 10.0;
+	}
+	if (um == UNITMODE_IN)
+		return v * 25400;
+	return v * 1000;
+}
+
+static bool matches_old(long long value, int frac, enum unit_mode um)
+{
+	double o = old_unit_convert(value, frac, um);
+	coord_t c = file_to_coord(value, frac, um);
+
+	// Within half a grid step of the old result, and the nearest step to it
+	return fabs(coord_to_um(c) - o) <= 0.5 / COORD_PER_UM + 1e-9 * fabs(o)
+		&& c == um_to_coord(o);
+}
+
+void file_to_coord_test(void)
+{
+	START_TEST("file_to_coord (mm, exact)");
+	TEST_OUTPUT(file_to_coord(1, 0, UNITMODE_MM) == 1000LL * COORD_PER_UM);
+	TEST_OUTPUT(file_to_coord(123456, 3, UNITMODE_MM) == 123456LL * COORD_PER_UM);
+	TEST_OUTPUT(file_to_coord(-5, 6, UNITMODE_MM) == -5LL * COORD_PER_UM / 1000);
+	END_TEST();
+
+	START_TEST("file_to_coord (in, exact)");
+	TEST_OUTPUT(file_to_coord(1, 0, UNITMODE_IN) == 25400LL * COORD_PER_UM);
+	TEST_OUTPUT(file_to_coord(10000, 4, UNITMODE_IN) == 25400LL * COORD_PER_UM);
+	TEST_OUTPUT(file_to_coord(-1, 5, UNITMODE_IN) == -254LL * COORD_PER_UM / 1000);
+	END_TEST();
+
+	START_TEST("file_to_coord (matches double path)");
+	const int fracs[] = {0, 2, 3, 4, 5, 6};
+	const enum unit_mode ums[] = {UNITMODE_IN, UNITMODE_MM};
+	srand(1);
+	for (unsigned int u=0; u < 2; u++)
+		for (unsigned int f=0; f < sizeof(fracs)/sizeof(fracs[0]); f++)
+			for (int i=0; i < 2000; i++)
+			{
+				long long v = ((long long)rand() << 8) % 100000000LL;
+				if (i & 1)
+					v = -v;
+				TEST_ASSERT(matches_old(v, fracs[f], ums[u]));
+			}
+	TEST_OUTPUT(matches_old(99999999, 6, UNITMODE_IN));
+	TEST_OUTPUT(matches_old(-99999999, 6, UNITMODE_MM));
+	END_TEST();
+}
+
+void coord_round_test(void)
+{
+	START_TEST("um_to_coord / coord_to_um");
+	TEST_OUTPUT(um_to_coord(0) == 0);
+	TEST_OUTPUT(um_to_coord(25400) == 25400LL * COORD_PER_UM);
+	TEST_OUTPUT(um_to_coord(-1.5) == -3LL * COORD_PER_UM / 2);
+	TEST_EQUALS_F(coord_to_um(um_to_coord(12.345)), 12.345);
+	END_TEST();
+
+	START_TEST("Point rounds to grid");
+	Point p(10.4, -10.6);
+	TEST_OUTPUT(p.x == 10);
+	TEST_OUTPUT(p.y == -11);
+	END_TEST();
+}
+
+void rect_coord_test(void)
+{
+	START_TEST("Rect on the grid");
+	Rect r(30, 40, 10, 20);
+	TEST_OUTPUT(r.getStartPoint().x == 10 && r.getStartPoint().y == 20);
+	TEST_OUTPUT(r.getEndPoint().x == 30 && r.getEndPoint().y == 40);
+	TEST_OUTPUT(r.getWidth() == 20);
+	TEST_OUTPUT(r.getHeight() == 20);
+	TEST_OUTPUT(r.pointInRectClosed(10, 40));
+	TEST_OUTPUT(!r.pointInRectOpen(10, 40));
+
+	r.mergePoint(Point(0, 0), 5);
+	TEST_OUTPUT(r.getStartPoint().x == -5 && r.getStartPoint().y == -5);
+
+	r.feather(1);
+	TEST_OUTPUT(r.getWidth() == 37);
+
+	// Touching on the grid counts, one step apart does not
+	TEST_OUTPUT(r.intersectsWith(Rect(31, 0, 50, 10)));
+	TEST_OUTPUT(!r.intersectsWith(Rect(32, 0, 50, 10)));
+	END_TEST();
+
+	START_TEST("Rect beyond 32 bits");
+	coord_t big = 3000000000LL * COORD_PER_UM / 1000;
+	Rect b(-big, -big, big, big);
+	TEST_OUTPUT(b.getWidth() == 2 * big);
+	TEST_OUTPUT(b.pointInRectClosed(big, -big));
+	END_TEST();
+}
+
+void coord_tests(void)
+{
+	file_to_coord_test();
+	coord_round_test();
+	rect_coord_test();
+}
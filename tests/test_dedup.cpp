@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "test_funcs.h"
+#include "../src/dedup.h"
+#include "../src/gerbobj_line.h"
+#include "../src/gerbobj_poly.h"
+
+static GerbObj_Line * dedup_line(coord_t sx, coord_t sy, coord_t ex, coord_t ey, coord_t w)
+{
+	GerbObj_Line * l = new GerbObj_Line();
+	l->sx = sx;
+	l->sy = sy;
+	l->ex = ex;
+	l->ey = ey;
+	l->cx = l->cy = 0;
+	l->width = w;
+	l->lt = LT_STRAIGHT;
+	l->lc = GerbObj_Line::LC_ROUND;
+	return l;
+}
+
+// Counterclockwise from the lower left corner, or from start corners on
+static GerbObj_Poly * dedup_rect(coord_t x0, coord_t y0, coord_t x1, coord_t y1, int start = 0)
+{
+	Point c[4] = {Point(x0, y0), Point(x1, y0), Point(x1, y1), Point(x0, y1)};
+	GerbObj_Poly * p = new GerbObj_Poly();
+	for (int i=0; i < 4; i++)
+		p->addPoint(c[(i + start) % 4]);
+	return p;
+}
+
+static GerbObj * add(Vector_Outp & v, GerbObj * o, bool clear = false)
+{
+	o->clear = clear;
+	v.all.push_back(sp_GerbObj(o));
+	return o;
+}
+
+static bool has(Vector_Outp & v, GerbObj * o)
+{
+	std::list<sp_GerbObj>::iterator it = v.all.begin();
+	for (; it != v.all.end(); it++)
+		if ((*it).get() == o)
+			return true;
+	return false;
+}
+
+void dedup_line_test(void)
+{
+	START_TEST("dedup (lines)");
+	Vector_Outp v;
+	GerbObj * a = add(v, dedup_line(0, 0, 10000, 0, 1000));
+	GerbObj * b = add(v, dedup_line(10000, 0, 0, 0, 1000));		// a drawn backwards
+	GerbObj * c = add(v, dedup_line(2000, 0, 5000, 100, 500));	// inside a
+	GerbObj * d = add(v, dedup_line(2000, 0, 5000, 600, 500));	// pokes out of a
+	GerbObj * e = add(v, dedup_line(0, 0, 10000, 0, 1200));		// wider than a, covers it
+	
+	struct dedup_stats st = dedup_vector_outp(&v);
+	TEST_OUTPUT(st.duplicates == 1);
+	TEST_OUTPUT(st.covered == 2);
+	TEST_OUTPUT(!has(v, b));
+	TEST_OUTPUT(!has(v, c));
+	TEST_OUTPUT(has(v, d));
+	TEST_OUTPUT(!has(v, a) && has(v, e));
+	TEST_OUTPUT(v.all.size() == 2);
+	TEST_OUTPUT(v.bounds.size() == 2);
+	TEST_EQUALS_I(layer_id_errors(&v), 0);
+	END_TEST();
+}
+
+void dedup_poly_test(void)
+{
+	START_TEST("dedup (polygons)");
+	Vector_Outp v;
+	GerbObj * p = add(v, dedup_rect(20000, 0, 30000, 10000));
+	GerbObj * q = add(v, dedup_rect(20000, 0, 30000, 10000));
+	GerbObj * r = add(v, dedup_rect(20000, 0, 30000, 10000, 2));	// p from another corner
+	GerbObj * s = add(v, dedup_rect(21000, 1000, 29000, 9000));	// inside p
+	GerbObj * l = add(v, dedup_line(22000, 5000, 28000, 5000, 2000));	// inside p
+	GerbObj * t = add(v, dedup_rect(25000, 5000, 35000, 15000));	// overlaps p
+	
+	struct dedup_stats st = dedup_vector_outp(&v);
+	TEST_OUTPUT(st.duplicates == 1);
+	TEST_OUTPUT(st.covered == 3);
+	// p and r trace the same outline from different corners, so they
+	// cover each other; exactly one of them survives
+	TEST_OUTPUT(has(v, p) != has(v, r));
+	TEST_OUTPUT(!has(v, q));
+	TEST_OUTPUT(!has(v, s) && !has(v, l));
+	TEST_OUTPUT(has(v, t));
+	TEST_EQUALS_I(layer_id_errors(&v), 0);
+	END_TEST();
+}
+
+void dedup_polarity_test(void)
+{
+	START_TEST("dedup (dark runs)");
+	Vector_Outp v;
+	GerbObj * a = add(v, dedup_rect(0, 0, 10000, 10000));
+	GerbObj * c = add(v, dedup_rect(2000, 2000, 4000, 4000), true);
+	GerbObj * b = add(v, dedup_rect(0, 0, 10000, 10000));		// redraws what c cleared
+	GerbObj * s = add(v, dedup_rect(2500, 2500, 3500, 3500));	// inside b
+	
+	struct dedup_stats st = dedup_vector_outp(&v);
+	TEST_OUTPUT(st.duplicates == 0);
+	TEST_OUTPUT(st.covered == 1);
+	TEST_OUTPUT(has(v, a) && has(v, c) && has(v, b));
+	TEST_OUTPUT(!has(v, s));
+	END_TEST();
+}
+
+void dedup_tests(void)
+{
+	dedup_line_test();
+	dedup_poly_test();
+	dedup_polarity_test();
+}
@@ -1,5 +1,7 @@
 #include <setjmp.h>
 
+#include "../src/ring.h"
+
 void start_section(char * name);
 
 void start_test(char * name);
@@ -25,4 +27,51 @@ extern jmp_buf env;
 #define END_TEST() end_test()
 void end_test();
 
+// Objects whose id isn't their place in the layer, or whose BoundsTable
+// entry doesn't line up with it
+class Vector_Outp;
+int layer_id_errors(Vector_Outp * v);
+
+// Checks for outline tests [test_normalize.cpp]: nonzero winding of r
+// round p, the way regions are filled, and the distance from p to the
+// nearest edge of r
+int nonzero_winding(const ring_t & r, const Point & p);
+double ring_edge_dist(const ring_t & r, const Point & p);
+
+// Random outline, star shaped about c so it never crosses itself, and
+// wound either way [test_trapezoid.cpp]
+ring_t random_star(Point c, double rmin, double rmax, int n);
+
+/*
+ * Shared by the spatial index tests [test_grid.cpp, test_rtree.cpp,
+ * test_visit.cpp]: a random BoundsTable of small boxes, points, very wide
+ * boxes and entries with no extent, queries over the same area, and the
+ * answer by a scan of the table
+ */
+class BoundsTable;
+coord_t rnd(coord_t lo, coord_t hi);
+void random_table(BoundsTable & t, int n);
+Rect random_query(void);
+void scan(const BoundsTable & t, const Rect & r, std::vector<unsigned int> & out);
+
 void polymath_tests(void);
+void macro_tests(void);
+void parallel_tests(void);
+void polarity_tests(void);
+void coord_tests(void);
+void merge_tests(void);
+void dedup_tests(void);
+void inpoly_tests(void);
+void render_tests(void);
+void bounds_tests(void);
+void capsule_tests(void);
+void packed_points_tests(void);
+void simplify_tests(void);
+void normalize_tests(void);
+void trapezoid_tests(void);
+void convex_tests(void);
+void grid_tests(void);
+void rtree_tests(void);
+void visit_tests(void);
+void nearest_tests(void);
+void hiergrid_tests(void);
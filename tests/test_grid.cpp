@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "test_funcs.h"
+#include "../src/grid.h"
+#include "../src/gcode_interp.h"
+#include "../src/gerbobj_line.h"
+
+coord_t rnd(coord_t lo, coord_t hi)
+{
+	return lo + (coord_t)(((double)rand() / RAND_MAX) * (hi - lo));
+}
+
+/*
+ * Mostly small boxes over a few mm either side of the origin, with some
+ * points, some boxes wider than the whole board and a few with no extent
+ */
+void random_table(BoundsTable & t, int n)
+{
+	t.clear();
+	for (int i=0; i < n; i++)
+	{
+		coord_t x = rnd(-5000000, 5000000), y = rnd(-5000000, 5000000);
+		coord_t w, h;
+		switch (rand() % 10)
+		{
+			case 0:
+				w = h = 0;
+				break;
+			case 1:
+				w = rnd(1000000, 20000000);
+				h = rnd(0, 200000);
+				break;
+			case 2:
+				t.append(NULL, Rect());
+				continue;
+			default:
+				w = rnd(0, 300000);
+				h = rnd(0, 300000);
+		}
+		t.append(NULL, Rect(x, y, x + w, y + h));
+	}
+}
+
+Rect random_query(void)
+{
+	coord_t x = rnd(-6000000, 6000000), y = rnd(-6000000, 6000000);
+	switch (rand() % 4)
+	{
+		case 0:
+			return Rect(x, y, x, y);
+		case 1:
+			return Rect(x, y, x + rnd(0, 3000000), y + rnd(0, 3000000));
+		default:
+			return Rect(x, y, x + rnd(0, 200000), y + rnd(0, 200000));
+	}
+}
+
+void scan(const BoundsTable & t, const Rect & r, std::vector<unsigned int> & out)
+{
+	out.clear();
+	coord_t qx0 = r.getStartPoint().x, qy0 = r.getStartPoint().y;
+	coord_t qx1 = r.getEndPoint().x, qy1 = r.getEndPoint().y;
+	for (unsigned int i=0; i < t.size(); i++)
+		if (t.minx[i] <= qx1 && t.maxx[i] >= qx0 && t.miny[i] <= qy1 && t.maxy[i] >= qy0)
+			out.push_back(i);
+}
+
+void grid_query_test(void)
+{
+	START_TEST("UniformGrid query (against a scan)");
+	srand(8);
+	BoundsTable t;
+	random_table(t, 3000);
+	
+	// Auto-tuned, fine enough to be clamped, and one cell for everything
+	coord_t cells[] = {0, 1, 20000, 250000, 100000000};
+	int bad = 0, found = 0;
+	for (int c=0; c < 5; c++)
+	{
+		UniformGrid g;
+		g.build(t, cells[c]);
+		std::vector<unsigned int> got, want;
+		for (int q=0; q < 300; q++)
+		{
+			Rect r = random_query();
+			g.query(r, got);
+			scan(t, r, want);
+			if (got != want)
+				bad++;
+			found += want.size();
+		}
+	}
+	TEST_EQUALS_I(bad, 0);
+	TEST_OUTPUT(found > 1000);
+	END_TEST();
+}
+
+void grid_edge_test(void)
+{
+	START_TEST("UniformGrid query (edges and empty)");
+	BoundsTable t;
+	t.append(NULL, Rect(0, 0, 1000, 1000));
+	t.append(NULL, Rect(1000, 1000, 2000, 2000));
+	t.append(NULL, Rect(5000, 5000, 5000, 5000));
+	t.append(NULL, Rect());
+	
+	UniformGrid g;
+	g.build(t, 1000);
+	std::vector<unsigned int> out;
+	
+	// Closed boxes: a shared corner touches both
+	g.query(Rect(1000, 1000, 1000, 1000), out);
+	TEST_EQUALS_I(out.size(), 2);
+	g.query(Rect(5000, 5000, 6000, 6000), out);
+	TEST_OUTPUT(out.size() == 1 && out[0] == 2);
+	g.query(Rect(-100000, -100000, 100000, 100000), out);
+	TEST_EQUALS_I(out.size(), 3);
+	g.query(Rect(2001, 2001, 4999, 4999), out);
+	TEST_OUTPUT(out.empty());
+	g.query(Rect(), out);
+	TEST_OUTPUT(out.empty());
+	
+	BoundsTable none;
+	UniformGrid e;
+	e.build(none);
+	e.query(Rect(0, 0, 10, 10), out);
+	TEST_OUTPUT(e.built() && out.empty());
+	END_TEST();
+}
+
+void grid_layer_test(void)
+{
+	START_TEST("query_vector_outp (each index)");
+	srand(9);
+	Vector_Outp v;
+	for (int i=0; i < 2000; i++)
+	{
+		GerbObj_Line * l = new GerbObj_Line();
+		l->sx = rnd(0, 10000000);
+		l->sy = rnd(0, 10000000);
+		l->ex = l->sx + rnd(-500000, 500000);
+		l->ey = l->sy + rnd(-500000, 500000);
+		l->cx = l->cy = 0;
+		l->width = rnd(100000, 300000);
+		l->lt = LT_STRAIGHT;
+		l->lc = GerbObj_Line::LC_ROUND;
+		v.all.push_back(sp_GerbObj(l));
+	}
+	reindex_vector_outp(&v);
+	
+	std::vector<Rect> qs;
+	std::vector<std::vector<unsigned int> > want(200);
+	for (int q=0; q < 200; q++)
+	{
+		coord_t x = rnd(0, 10000000), y = rnd(0, 10000000);
+		qs.push_back(Rect(x, y, x + rnd(0, 1000000), y + rnd(0, 1000000)));
+		scan(v.bounds, qs[q], want[q]);
+	}
+	
+	enum layer_index_t kinds[] = {INDEX_SCAN, INDEX_GRID, INDEX_RTREE};
+	int bad = 0;
+	for (int k=0; k < 3; k++)
+	{
+		index_vector_outp(&v, kinds[k]);
+		std::vector<unsigned int> got;
+		for (int q=0; q < 200; q++)
+		{
+			query_vector_outp(&v, qs[q], got);
+			if (got != want[q])
+				bad++;
+		}
+	}
+	TEST_EQUALS_I(bad, 0);
+	
+	// Neither index is kept once bounds no longer match it
+	index_vector_outp(&v, INDEX_RTREE);
+	reindex_vector_outp(&v);
+	TEST_OUTPUT(!v.grid.built() && v.rtree.levels() == 0);
+	END_TEST();
+}
+
+void grid_tests(void)
+{
+	grid_query_test();
+	grid_edge_test();
+	grid_layer_test();
+}
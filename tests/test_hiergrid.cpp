@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+
+#include "test_funcs.h"
+#include "../src/partitioning.h"
+
+struct box {
+	coord_t x1, y1, x2, y2;
+	bool in;
+};
+
+// Points, pads, traces and the odd 100mm pour, either side of the origin
+static struct box random_box(void)
+{
+	struct box b;
+	b.x1 = rnd(-50000000, 50000000);
+	b.y1 = rnd(-50000000, 50000000);
+	coord_t w, h;
+	switch (rand() % 8)
+	{
+		case 0:
+			w = h = 0;
+			break;
+		case 1:
+			w = rnd(10000000, 100000000);
+			h = rnd(10000000, 100000000);
+			break;
+		case 2:
+			w = rnd(0, 5000000);
+			h = rnd(0, 200000);
+			break;
+		default:
+			w = rnd(0, 2000000);
+			h = rnd(0, 2000000);
+	}
+	b.x2 = b.x1 + w;
+	b.y2 = b.y1 + h;
+	b.in = true;
+	return b;
+}
+
+// Points and boxes up to 10mm, anywhere the boxes can be
+static Rect random_board_query(void)
+{
+	coord_t x = rnd(-60000000, 60000000), y = rnd(-60000000, 60000000);
+	if (rand() % 4 == 0)
+		return Rect(x, y, x, y);
+	return Rect(x, y, x + rnd(0, 10000000), y + rnd(0, 10000000));
+}
+
+static void scan_boxes(const std::vector<struct box> & bs, const Rect & r, std::vector<unsigned int> & out)
+{
+	out.clear();
+	coord_t qx0 = r.getStartPoint().x, qy0 = r.getStartPoint().y;
+	coord_t qx1 = r.getEndPoint().x, qy1 = r.getEndPoint().y;
+	for (unsigned int i=0; i < bs.size(); i++)
+		if (bs[i].in && bs[i].x1 <= qx1 && bs[i].x2 >= qx0 && bs[i].y1 <= qy1 && bs[i].y2 >= qy0)
+			out.push_back(i);
+}
+
+// Queries that disagree with a scan, by retrieve and by the output iterator
+static int compare(HierGrid<unsigned int> & g, const std::vector<struct box> & bs, int n, long & found)
+{
+	int bad = 0;
+	std::vector<unsigned int> want, out;
+	for (int q=0; q < n; q++)
+	{
+		Rect r = random_board_query();
+		scan_boxes(bs, r, want);
+		found += want.size();
+		if (g.retrieve(r) != want)
+			bad++;
+		
+		out.clear();
+		g.retrieve(r, std::back_inserter(out));
+		std::sort(out.begin(), out.end());
+		if (out != want)
+			bad++;
+	}
+	return bad;
+}
+
+void hiergrid_query_test(void)
+{
+	START_TEST("HierGrid retrieve (against a scan)");
+	srand(17);
+	std::vector<struct box> bs;
+	for (int i=0; i < 5000; i++)
+		bs.push_back(random_box());
+	
+	// Cells finer and coarser than most of the objects
+	coord_t cells[] = {50000, 1000000, 20000000};
+	int bad = 0;
+	long found = 0;
+	for (int c=0; c < 3; c++)
+	{
+		HierGrid<unsigned int> g(cells[c]);
+		for (unsigned int i=0; i < bs.size(); i++)
+			g.insertbounded(bs[i].x1, bs[i].y1, bs[i].x2, bs[i].y2, i);
+		if (g.size() != (long)bs.size())
+			bad++;
+		bad += compare(g, bs, 200, found);
+	}
+	TEST_EQUALS_I(bad, 0);
+	TEST_OUTPUT(found > 1000);
+	END_TEST();
+}
+
+void hiergrid_remove_test(void)
+{
+	START_TEST("HierGrid removebounded");
+	srand(18);
+	std::vector<struct box> bs;
+	for (int i=0; i < 3000; i++)
+		bs.push_back(random_box());
+	
+	HierGrid<unsigned int> g(250000);
+	for (unsigned int i=0; i < bs.size(); i++)
+		g.insertbounded(bs[i].x1, bs[i].y1, bs[i].x2, bs[i].y2, i);
+	
+	// Every third goes, and removing one twice changes nothing
+	long left = bs.size();
+	for (unsigned int i=0; i < bs.size(); i += 3)
+	{
+		Rect r(bs[i].x1, bs[i].y1, bs[i].x2, bs[i].y2);
+		g.removebounded(r, i);
+		g.removebounded(r, i);
+		bs[i].in = false;
+		left--;
+	}
+	TEST_OUTPUT(g.size() == left);
+	
+	long found = 0;
+	TEST_EQUALS_I(compare(g, bs, 300, found), 0);
+	
+	// Back in, at another place and size
+	for (unsigned int i=0; i < bs.size(); i += 3)
+	{
+		bs[i] = random_box();
+		g.insertbounded(bs[i].x1, bs[i].y1, bs[i].x2, bs[i].y2, i);
+	}
+	TEST_OUTPUT(g.size() == (long)bs.size());
+	TEST_EQUALS_I(compare(g, bs, 300, found), 0);
+	END_TEST();
+}
+
+void hiergrid_levels_test(void)
+{
+	START_TEST("HierGrid levels");
+	HierGrid<unsigned int> g(1000);
+	g.insertbounded(0, 0, 0, 0, 0);
+	TEST_EQUALS_I(g.levelCount(), 1);
+	g.insertbounded(0, 0, 1000, 1000, 1);
+	TEST_EQUALS_I(g.levelCount(), 1);
+	g.insertbounded(-5000, 0, 3000, 10, 2);
+	TEST_EQUALS_I(g.levelCount(), 4);
+	
+	// A big box reaches queries well away from its lower left corner
+	std::vector<unsigned int> out = g.retrieve(Rect(2999, 5, 2999, 5));
+	TEST_OUTPUT(out.size() == 1 && out[0] == 2);
+	out = g.retrieve(Rect(-1, -1, 0, 0));
+	TEST_OUTPUT(out.size() == 3);
+	out = g.retrieve(Rect(1001, 11, 2000, 2000));
+	TEST_OUTPUT(out.empty());
+	END_TEST();
+}
+
+void hiergrid_tests(void)
+{
+	hiergrid_query_test();
+	hiergrid_remove_test();
+	hiergrid_levels_test();
+}
@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "test_funcs.h"
+#include "../src/gerbobj_poly.h"
+
+typedef double tPointd[2];
+char InPoly( tPointd q, tPointd * P, int n );
+char InPolyPts( const Point & q, const Point * P, int n );
+
+// An L, concave at (10, 10) [coord_t steps]
+static GerbObj_Poly * inp_ell(void)
+{
+	static const coord_t c[6][2] = {{0, 0}, {20, 0}, {20, 10}, {10, 10}, {10, 20}, {0, 20}};
+	GerbObj_Poly * p = new GerbObj_Poly();
+	for (int i=0; i < 6; i++)
+		p->addPoint(Point(c[i][0], c[i][1]));
+	return p;
+}
+
+// InPoly on a copy, since it shifts the polygon it's given
+static char inp_ref(GerbObj_Poly * p, const Point & q)
+{
+	int n = p->points.size();
+	tPointd * d = new tPointd[n];
+	for (int i=0; i < n; i++)
+	{
+		d[i][0] = p->points[i].x;
+		d[i][1] = p->points[i].y;
+	}
+	tPointd dq = {(double)q.x, (double)q.y};
+	char r = InPoly(dq, d, n);
+	delete [] d;
+	return r;
+}
+
+void inpoly_pts_test(void)
+{
+	START_TEST("InPolyPts on the vertex buffer");
+	GerbObj_Poly * p = inp_ell();
+	const Point * v = &p->points[0];
+	
+	TEST_EQUALS_I(InPolyPts(Point(5, 5), v, 6), 'i');
+	TEST_EQUALS_I(InPolyPts(Point(15, 5), v, 6), 'i');
+	TEST_EQUALS_I(InPolyPts(Point(15, 15), v, 6), 'o');	// the notch
+	TEST_EQUALS_I(InPolyPts(Point(-1, 5), v, 6), 'o');
+	TEST_EQUALS_I(InPolyPts(Point(10, 10), v, 6), 'v');
+	TEST_EQUALS_I(InPolyPts(Point(0, 0), v, 6), 'v');
+	TEST_EQUALS_I(InPolyPts(Point(10, 15), v, 6), 'e');
+	TEST_EQUALS_I(InPolyPts(Point(20, 5), v, 6), 'e');
+	
+	// The same answer as InPoly everywhere around it, and the polygon
+	// is left alone
+	int bad = 0;
+	for (int x=-2; x <= 22; x++)
+		for (int y=-2; y <= 22; y++)
+			if (InPolyPts(Point(x, y), v, 6) != inp_ref(p, Point(x, y)))
+				bad++;
+	TEST_EQUALS_I(bad, 0);
+	TEST_ASSERT(p->points[3].x == 10 && p->points[3].y == 10);
+	delete p;
+	END_TEST();
+}
+
+void poly_points_test(void)
+{
+	START_TEST("GerbObj_Poly outline buffer");
+	GerbObj_Poly * p = inp_ell();
+	
+	// getPoints reads the buffer in this order
+	TEST_EQUALS_I(p->points.size(), 6);
+	TEST_ASSERT(p->points[0].x == 0 && p->points[0].y == 0);
+	TEST_ASSERT(p->points[1].x == 20 && p->points[1].y == 0);
+	TEST_ASSERT(p->points[5].x == 0 && p->points[5].y == 20);
+	TEST_ASSERT(&p->points[5] == &p->points[0] + 5);
+	
+	Rect r = p->getBounds();
+	TEST_ASSERT(r.getStartPoint().x == 0 && r.getStartPoint().y == 0);
+	TEST_ASSERT(r.getEndPoint().x == 20 && r.getEndPoint().y == 20);
+	delete p;
+	END_TEST();
+}
+
+void inpoly_tests(void)
+{
+	inpoly_pts_test();
+	poly_points_test();
+}
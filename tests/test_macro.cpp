@@ -0,0 +1,312 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "test_funcs.h"
+#include "../src/macro_vm.h"
+#include "../src/gerbobj_line.h"
+#include "../src/gerbobj_poly.h"
+#include "../src/ring.h"
+
+// Layer units per macro unit [mm]
+#define S (1000.0 * COORD_PER_UM)
+
+// Compile and run a macro of the given statements [NULL terminated] at the origin
+static bool run_macro(const char ** stmts, const double * params, int num_params, Macro_VM::obj_list_t & out)
+{
+	Macro_VM vm(UNITMODE_MM);
+	for (; *stmts; stmts++)
+		if (!parse_macro(&vm, *stmts))
+			return false;
+
+	Macro_VM * c = vm.compile(params, num_params);
+	if (!c)
+		return false;
+	bool ok = c->execute(0, 0, out);
+	delete c;
+	return ok;
+}
+
+static void free_objs(Macro_VM::obj_list_t & out)
+{
+	for (unsigned int i=0; i < out.size(); i++)
+		delete out[i];
+	out.clear();
+}
+
+static void poly_ring(GerbObj * o, ring_t & r)
+{
+	r.clear();
+	GerbObj_Poly * p = dynamic_cast<GerbObj_Poly *>(o);
+	if (p)
+		r.assign(p->points.begin(), p->points.end());
+}
+
+// Area covered, circles [zero length lines] exactly
+static double objs_area(Macro_VM::obj_list_t & out)
+{
+	double a = 0;
+	for (unsigned int i=0; i < out.size(); i++)
+	{
+		GerbObj_Line * l = dynamic_cast<GerbObj_Line *>(out[i]);
+		if (l)
+		{
+			a += M_PI * l->width * l->width / 4;
+			continue;
+		}
+		ring_t r;
+		poly_ring(out[i], r);
+		a += fabs(ring_area(r));
+	}
+	return a;
+}
+
+// Objects whose outline has p inside
+static int objs_at(Macro_VM::obj_list_t & out, const Point & p)
+{
+	int n = 0;
+	for (unsigned int i=0; i < out.size(); i++)
+	{
+		GerbObj_Line * l = dynamic_cast<GerbObj_Line *>(out[i]);
+		if (l)
+		{
+			if (hypot(p.x - l->sx, p.y - l->sy) < l->width / 2)
+				n++;
+			continue;
+		}
+		ring_t r;
+		poly_ring(out[i], r);
+		if (point_in_ring(r, p))
+			n++;
+	}
+	return n;
+}
+
+static bool near(double a, double b, double tol)
+{
+	return fabs(a - b) <= tol;
+}
+
+static bool bounds_are(GerbObj * o, double x0, double y0, double x1, double y1)
+{
+	Rect b = o->getBounds();
+	double tol = S * 1e-6;
+	return near(b.getStartPoint().x, x0, tol) && near(b.getStartPoint().y, y0, tol) &&
+		near(b.getEndPoint().x, x1, tol) && near(b.getEndPoint().y, y1, tol);
+}
+
+void macro_circle_test(void)
+{
+	START_TEST("macro primitive 1 (circle)");
+	const char * m[] = {"1,1,$1,0.5,0.25", NULL};
+	double params[] = {1.5};
+	Macro_VM::obj_list_t out;
+	TEST_ASSERT(run_macro(m, params, 1, out));
+	TEST_ASSERT(out.size() == 1);
+	GerbObj_Line * l = dynamic_cast<GerbObj_Line *>(out[0]);
+	TEST_ASSERT(l != NULL);
+	TEST_OUTPUT(l->sx == l->ex && l->sy == l->ey);
+	TEST_OUTPUT(near(l->sx, 0.5 * S, 1e-6 * S) && near(l->sy, 0.25 * S, 1e-6 * S));
+	TEST_OUTPUT(near(l->width, 1.5 * S, 1e-6 * S));
+	TEST_OUTPUT(l->lc == GerbObj_Line::LC_ROUND);
+	free_objs(out);
+	END_TEST();
+}
+
+void macro_outline_test(void)
+{
+	START_TEST("macro primitive 4 (outline)");
+	// 2 x 1 rectangle, closed back on its first point
+	const char * m[] = {"4,1,4,0,0,2,0,2,1,0,1,0,0,0", NULL};
+	Macro_VM::obj_list_t out;
+	TEST_ASSERT(run_macro(m, NULL, 0, out));
+	TEST_ASSERT(out.size() == 1);
+	TEST_OUTPUT(near(objs_area(out), 2 * S * S, 1e-6 * S * S));
+	TEST_OUTPUT(bounds_are(out[0], 0, 0, 2 * S, 1 * S));
+	free_objs(out);
+
+	// Turned a quarter round the origin
+	const char * r[] = {"4,1,4,0,0,2,0,2,1,0,1,0,0,90", NULL};
+	TEST_ASSERT(run_macro(r, NULL, 0, out));
+	TEST_ASSERT(out.size() == 1);
+	TEST_OUTPUT(bounds_are(out[0], -1 * S, 0, 0, 2 * S));
+	free_objs(out);
+	END_TEST();
+}
+
+void macro_polygon_test(void)
+{
+	START_TEST("macro primitive 5 (regular polygon)");
+	const char * m[] = {"5,1,6,1,0,2,0", NULL};
+	Macro_VM::obj_list_t out;
+	TEST_ASSERT(run_macro(m, NULL, 0, out));
+	TEST_ASSERT(out.size() == 1);
+	ring_t r;
+	poly_ring(out[0], r);
+	TEST_OUTPUT(r.size() == 6);
+	// Corners are rounded to the grid, which moves the area by up to half
+	// a step times the perimeter
+	TEST_OUTPUT(near(objs_area(out), 1.5 * sqrt(3.0) * S * S, 1e-5 * S * S));
+	TEST_OUTPUT(bounds_are(out[0], 0, -sqrt(3.0) / 2 * S, 2 * S, sqrt(3.0) / 2 * S));
+	free_objs(out);
+	END_TEST();
+}
+
+void macro_moire_test(void)
+{
+	START_TEST("macro primitive 6 (moire)");
+	// Rings 2.5-2 and 1.5-1, crosshairs 0.1 wide and 6 long
+	const char * m[] = {"6,0,0,5,0.5,0.5,2,0.1,6,0", NULL};
+	Macro_VM::obj_list_t out;
+	TEST_ASSERT(run_macro(m, NULL, 0, out));
+	TEST_ASSERT(out.size() == 4);
+	TEST_OUTPUT(objs_at(out, Point(2.25 * S, 0.5 * S)) == 1);
+	TEST_OUTPUT(objs_at(out, Point(1.75 * S, 0.5 * S)) == 0);
+	TEST_OUTPUT(objs_at(out, Point(1.25 * S, 0.5 * S)) == 1);
+	TEST_OUTPUT(objs_at(out, Point(0.5 * S, 0.5 * S)) == 0);
+	TEST_OUTPUT(objs_at(out, Point(2.9 * S, 0)) == 1);
+	TEST_OUTPUT(objs_at(out, Point(0, -2.9 * S)) == 1);
+	TEST_OUTPUT(objs_at(out, Point(0, 0)) == 2);
+	free_objs(out);
+
+	// The innermost ring closes up into a disc
+	const char * d[] = {"6,0,0,3,1,0.2,2,0,0,0", NULL};
+	TEST_ASSERT(run_macro(d, NULL, 0, out));
+	TEST_ASSERT(out.size() == 2);
+	GerbObj_Line * l = dynamic_cast<GerbObj_Line *>(out[1]);
+	TEST_ASSERT(l != NULL);
+	TEST_OUTPUT(near(l->width, 0.6 * S, 1e-6 * S));
+	free_objs(out);
+	END_TEST();
+}
+
+void macro_thermal_test(void)
+{
+	START_TEST("macro primitive 7 (thermal)");
+	const char * m[] = {"7,0,0,4,2,0.5,0", NULL};
+	Macro_VM::obj_list_t out;
+	TEST_ASSERT(run_macro(m, NULL, 0, out));
+	TEST_ASSERT(out.size() == 4);
+
+	// Ring between radius 1 and 2, minus the gaps
+	TEST_OUTPUT(objs_at(out, Point(1.5 * S * M_SQRT1_2, 1.5 * S * M_SQRT1_2)) == 1);
+	TEST_OUTPUT(objs_at(out, Point(1.5 * S, 0)) == 0);
+	TEST_OUTPUT(objs_at(out, Point(0, -1.5 * S)) == 0);
+	TEST_OUTPUT(objs_at(out, Point(0, 0)) == 0);
+	for (unsigned int i=0; i < out.size(); i++)
+	{
+		ring_t r;
+		poly_ring(out[i], r);
+		int bad = 0;
+		for (unsigned int j=0; j < r.size(); j++)
+			if (fabs(r[j].x) < 0.25 * S - 1e-6 * S || fabs(r[j].y) < 0.25 * S - 1e-6 * S)
+				bad++;
+		TEST_EQUALS_I(bad, 0);
+	}
+	free_objs(out);
+
+	// A gap past the outer radius over root 2 leaves nothing
+	const char * g[] = {"7,0,0,1,0.5,0.8,0", NULL};
+	TEST_ASSERT(run_macro(g, NULL, 0, out));
+	TEST_OUTPUT(out.size() == 0);
+	END_TEST();
+}
+
+void macro_line_test(void)
+{
+	START_TEST("macro primitives 20, 21, 22 (lines)");
+	Macro_VM::obj_list_t out;
+
+	// Vector line, square ends flush with its end points
+	const char * v[] = {"20,1,0.5,0,0,2,0,0", NULL};
+	TEST_ASSERT(run_macro(v, NULL, 0, out));
+	TEST_ASSERT(out.size() == 1);
+	TEST_OUTPUT(bounds_are(out[0], 0, -0.25 * S, 2 * S, 0.25 * S));
+	TEST_OUTPUT(near(objs_area(out), 1 * S * S, 1e-6 * S * S));
+	free_objs(out);
+
+	// Old code 2 is the same as 20
+	const char * v2[] = {"2,1,0.5,0,0,0,2,0", NULL};
+	TEST_ASSERT(run_macro(v2, NULL, 0, out));
+	TEST_ASSERT(out.size() == 1);
+	TEST_OUTPUT(bounds_are(out[0], -0.25 * S, 0, 0.25 * S, 2 * S));
+	free_objs(out);
+
+	// Center line, by its center
+	const char * c[] = {"21,1,2,1,1,1,0", NULL};
+	TEST_ASSERT(run_macro(c, NULL, 0, out));
+	TEST_ASSERT(out.size() == 1);
+	TEST_OUTPUT(bounds_are(out[0], 0, 0.5 * S, 2 * S, 1.5 * S));
+	free_objs(out);
+
+	// Lower left line, by its lower left corner
+	const char * l[] = {"22,1,2,1,1,1,0", NULL};
+	TEST_ASSERT(run_macro(l, NULL, 0, out));
+	TEST_ASSERT(out.size() == 1);
+	TEST_OUTPUT(bounds_are(out[0], 1 * S, 1 * S, 3 * S, 2 * S));
+	free_objs(out);
+	END_TEST();
+}
+
+void macro_exposure_test(void)
+{
+	START_TEST("macro exposure off and toggle");
+	Macro_VM::obj_list_t out;
+
+	// Donut: the hole is cut out of the disc, nothing is left clear
+	const char * d[] = {"1,1,2,0,0", "1,0,1,0,0", NULL};
+	TEST_ASSERT(run_macro(d, NULL, 0, out));
+	TEST_ASSERT(out.size() == 1);
+	TEST_OUTPUT(objs_at(out, Point(0, 0)) == 0);
+	TEST_OUTPUT(objs_at(out, Point(0.2 * S, 0.3 * S)) == 0);
+	TEST_OUTPUT(objs_at(out, Point(0.75 * S, 0)) == 1);
+	TEST_OUTPUT(objs_at(out, Point(0, -0.75 * S)) == 1);
+	TEST_OUTPUT(near(objs_area(out), M_PI * 0.75 * S * S, 0.01 * S * S));
+	free_objs(out);
+
+	// A bar cut in two
+	const char * b[] = {"21,1,4,1,0,0,0", "21,0,1,2,0,0,0", NULL};
+	TEST_ASSERT(run_macro(b, NULL, 0, out));
+	TEST_OUTPUT(out.size() == 2);
+	TEST_OUTPUT(near(objs_area(out), 3 * S * S, 1e-3 * S * S));
+	TEST_OUTPUT(objs_at(out, Point(0, 0)) == 0);
+	TEST_OUTPUT(objs_at(out, Point(-1 * S, 0)) == 1);
+	TEST_OUTPUT(objs_at(out, Point(1 * S, 0)) == 1);
+	free_objs(out);
+
+	// Off only cuts what was drawn before it
+	const char * o[] = {"21,0,1,1,0,0,0", "21,1,2,2,0,0,0", NULL};
+	TEST_ASSERT(run_macro(o, NULL, 0, out));
+	TEST_ASSERT(out.size() == 1);
+	TEST_OUTPUT(near(objs_area(out), 4 * S * S, 1e-6 * S * S));
+	free_objs(out);
+
+	// Clear of everything, nothing changes
+	const char * n[] = {"21,1,1,1,0,0,0", "1,0,0.5,5,5", NULL};
+	TEST_ASSERT(run_macro(n, NULL, 0, out));
+	TEST_ASSERT(out.size() == 1);
+	TEST_OUTPUT(near(objs_area(out), 1 * S * S, 1e-6 * S * S));
+	free_objs(out);
+
+	// Toggle: on where nothing was, off where something was
+	const char * t[] = {"21,1,2,2,0,0,0", "21,2,2,2,1,0,0", NULL};
+	TEST_ASSERT(run_macro(t, NULL, 0, out));
+	TEST_OUTPUT(out.size() == 2);
+	TEST_OUTPUT(near(objs_area(out), 4 * S * S, 1e-3 * S * S));
+	TEST_OUTPUT(objs_at(out, Point(-0.5 * S, 0)) == 1);
+	TEST_OUTPUT(objs_at(out, Point(0.5 * S, 0)) == 0);
+	TEST_OUTPUT(objs_at(out, Point(1.5 * S, 0)) == 1);
+	free_objs(out);
+	END_TEST();
+}
+
+void macro_tests(void)
+{
+	macro_circle_test();
+	macro_outline_test();
+	macro_polygon_test();
+	macro_moire_test();
+	macro_thermal_test();
+	macro_line_test();
+	macro_exposure_test();
+}
@@ -4,6 +4,7 @@
 #include <malloc.h>
 
 #include "test_funcs.h"
+#include "../src/main.h"
 
 #define CSI "\x1B["
 #define RESET CSI "0m"
@@ -51,6 +52,10 @@ static void  free_counter(void * block, const void * caller)
 
 jmp_buf env;
 
+// The layer code logs through this; the python module and the command
+// line tool each define their own
+enum debug_level_t debug_level = DEBUG_NONE;
+
 bool mstats[40];
 char * messages[40];
 int mint = 0;
@@ -140,6 +145,26 @@ void end_test()
 int main(int argc, char** argv)
 {
 	printf(BLUE "Starting Tests" RESET "\n");
+	macro_tests();
+	parallel_tests();
+	polarity_tests();
+	coord_tests();
+	merge_tests();
+	dedup_tests();
+	inpoly_tests();
+	render_tests();
+	bounds_tests();
+	capsule_tests();
+	packed_points_tests();
+	simplify_tests();
+	normalize_tests();
+	trapezoid_tests();
+	convex_tests();
+	grid_tests();
+	rtree_tests();
+	visit_tests();
+	nearest_tests();
+	hiergrid_tests();
 	polymath_tests();
 }
 
@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "test_funcs.h"
+#include "../src/merge_lines.h"
+#include "../src/gerbobj_line.h"
+
+// Straight round ended line, ends in coord_t steps, width in microns
+static void mrg_line(Vector_Outp & v, coord_t sx, coord_t sy, coord_t ex, coord_t ey, double w)
+{
+	GerbObj_Line * l = new GerbObj_Line();
+	l->sx = sx;
+	l->sy = sy;
+	l->ex = ex;
+	l->ey = ey;
+	l->width = um_to_coord(w);
+	l->lt = LT_STRAIGHT;
+	l->lc = GerbObj_Line::LC_ROUND;
+	v.all.push_back(sp_GerbObj(l));
+}
+
+static GerbObj_Line * mrg_first(Vector_Outp & v)
+{
+	return dynamic_cast<GerbObj_Line *>(v.all.front().get());
+}
+
+void merge_chain_test(void)
+{
+	START_TEST("merge chained collinear lines");
+	coord_t s = um_to_coord(100);
+	Vector_Outp v;
+	
+	// Drawn out of order, and the middle one backwards
+	mrg_line(v, 0, 0, s, s, 10);
+	mrg_line(v, 3 * s, 3 * s, 2 * s, 2 * s, 10);
+	mrg_line(v, 2 * s, 2 * s, s, s, 10);
+	mrg_line(v, 3 * s, 3 * s, 4 * s, 4 * s, 10);
+	
+	TEST_EQUALS_F(merge_collinear_lines(&v), 4.0);
+	TEST_EQUALS_I(v.all.size(), 1);
+	
+	GerbObj_Line * l = mrg_first(v);
+	TEST_ASSERT(l != NULL);
+	coord_t lo = l->sx < l->ex ? l->sx : l->ex, hi = l->sx < l->ex ? l->ex : l->sx;
+	TEST_ASSERT(lo == 0 && hi == 4 * s);
+	TEST_ASSERT(l->sx == l->sy && l->ex == l->ey);
+	TEST_ASSERT(l->width == um_to_coord(10));
+	END_TEST();
+}
+
+void merge_tol_test(void)
+{
+	START_TEST("merge joint just beyond MERGE_TOL");
+	coord_t s = um_to_coord(100);
+	
+	// One grid step off the line is already beyond the default of 0
+	Vector_Outp v;
+	mrg_line(v, 0, 0, s, 1, 10);
+	mrg_line(v, s, 1, 2 * s, 0, 10);
+	merge_collinear_lines(&v);
+	TEST_EQUALS_I(v.all.size(), 2);
+	
+	// Within tol of a single step it merges, two steps off it doesn't
+	merge_collinear_lines(&v, 1);
+	TEST_EQUALS_I(v.all.size(), 1);
+	
+	Vector_Outp w;
+	mrg_line(w, 0, 0, s, 2, 10);
+	mrg_line(w, s, 2, 2 * s, 0, 10);
+	merge_collinear_lines(&w, 1);
+	TEST_EQUALS_I(w.all.size(), 2);
+	END_TEST();
+}
+
+void merge_width_test(void)
+{
+	START_TEST("merge keeps lines of different widths");
+	coord_t s = um_to_coord(100);
+	Vector_Outp v;
+	mrg_line(v, 0, 0, s, 0, 10);
+	mrg_line(v, s, 0, 2 * s, 0, 12);
+	TEST_EQUALS_F(merge_collinear_lines(&v), 1.0);
+	TEST_EQUALS_I(v.all.size(), 2);
+	END_TEST();
+}
+
+void merge_tests(void)
+{
+	merge_chain_test();
+	merge_tol_test();
+	merge_width_test();
+}
@@ -0,0 +1,231 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#include "test_funcs.h"
+#include "../src/convex.h"
+#include "../src/rtree.h"
+#include "../src/gcode_interp.h"
+#include "../src/gerbobj_line.h"
+#include "../src/gerbobj_poly.h"
+
+// Traces and square pads scattered over a 20mm board
+static void random_layer(Vector_Outp & v, int n)
+{
+	for (int i=0; i < n; i++)
+	{
+		coord_t x = rnd(0, 20000000), y = rnd(0, 20000000);
+		if (rand() % 3)
+		{
+			GerbObj_Line * l = new GerbObj_Line();
+			l->sx = x;
+			l->sy = y;
+			l->ex = x + rnd(-1000000, 1000000);
+			l->ey = y + rnd(-1000000, 1000000);
+			l->cx = l->cy = 0;
+			l->width = rnd(100000, 400000);
+			l->lt = LT_STRAIGHT;
+			l->lc = GerbObj_Line::LC_ROUND;
+			v.all.push_back(sp_GerbObj(l));
+		}
+		else
+		{
+			coord_t s = rnd(200000, 1500000);
+			GerbObj_Poly * p = new GerbObj_Poly();
+			p->addPoint(Point(x, y));
+			p->addPoint(Point(x + s, y));
+			p->addPoint(Point(x + s, y + s));
+			p->addPoint(Point(x, y + s));
+			v.all.push_back(sp_GerbObj(p));
+		}
+	}
+	reindex_vector_outp(&v);
+}
+
+static bool same_d(double a, double b)
+{
+	return fabs(a - b) <= 1e-6 * fmax(1, fabs(b));
+}
+
+/*
+ * hits are in order, each at the distance dist(i) gives it, and their
+ * distances are the first of the brute force list all [sorted]
+ */
+template <class D> static bool check_hits(const std::vector<struct rtree_hit> & hits,
+	std::vector<double> all, unsigned int k, double maxd, D & dist)
+{
+	std::sort(all.begin(), all.end());
+	unsigned int want = 0;
+	while (want < all.size() && want < k && all[want] <= maxd && all[want] != INFINITY)
+		want++;
+	if (hits.size() != want)
+		return false;
+	for (unsigned int j=0; j < hits.size(); j++)
+	{
+		if (!same_d(hits[j].d, all[j]) || !same_d(hits[j].d, dist(hits[j].i)))
+			return false;
+		if (j && hits[j].d < hits[j-1].d)
+			return false;
+	}
+	return true;
+}
+
+struct box_dist {
+	const BoundsTable * t;
+	Rect q;
+	double operator()(unsigned int i) const
+	{
+		return box_gap(q.getStartPoint().x, q.getStartPoint().y, q.getEndPoint().x, q.getEndPoint().y,
+			t->minx[i], t->miny[i], t->maxx[i], t->maxy[i]);
+	};
+};
+
+struct obj_dist {
+	const BoundsTable * t;
+	GerbObj * o;
+	double operator()(unsigned int i) const {return t->objs[i] == o ? INFINITY : obj_gap(o, t->objs[i], -1);};
+};
+
+struct pt_dist {
+	const BoundsTable * t;
+	coord_t x, y;
+	double operator()(unsigned int i) const {return point_gap(t->objs[i], x, y, -1);};
+};
+
+struct collect {
+	std::vector<unsigned int> * v;
+	void operator()(unsigned int i) {v->push_back(i);};
+};
+
+void nearest_box_test(void)
+{
+	START_TEST("PackedRTree nearest / within (boxes)");
+	srand(14);
+	Vector_Outp v;
+	random_layer(v, 3000);
+	PackedRTree rt;
+	rt.build(v.bounds);
+	
+	unsigned int ks[] = {1, 5, 40};
+	double maxds[] = {INFINITY, 300000};
+	int bad_n = 0, bad_w = 0;
+	std::vector<struct rtree_hit> hits;
+	std::vector<unsigned int> got, want;
+	for (int q=0; q < 100; q++)
+	{
+		coord_t x = rnd(-1000000, 21000000), y = rnd(-1000000, 21000000);
+		Rect r(x, y, x + rnd(0, 500000), y + rnd(0, 500000));
+		struct rtree_box_kernel kern = {&v.bounds, r};
+		struct box_dist bd = {&v.bounds, r};
+		
+		std::vector<double> all;
+		for (unsigned int i=0; i < v.bounds.size(); i++)
+			all.push_back(bd(i));
+		
+		for (int k=0; k < 3; k++)
+			for (int m=0; m < 2; m++)
+			{
+				rt.nearest(r, ks[k], kern, hits, maxds[m]);
+				if (!check_hits(hits, all, ks[k], maxds[m], bd))
+					bad_n++;
+			}
+		
+		double d = rnd(0, 1000000);
+		got.clear();
+		want.clear();
+		struct collect c = {&got};
+		rt.within(r, d, kern, c);
+		std::sort(got.begin(), got.end());
+		for (unsigned int i=0; i < all.size(); i++)
+			if (all[i] <= d)
+				want.push_back(i);
+		if (got != want)
+			bad_w++;
+	}
+	TEST_EQUALS_I(bad_n, 0);
+	TEST_EQUALS_I(bad_w, 0);
+	END_TEST();
+}
+
+void nearest_layer_test(void)
+{
+	START_TEST("nearest_vector_outp / within_vector_outp (outlines)");
+	srand(15);
+	Vector_Outp v;
+	random_layer(v, 800);
+	
+	int bad_n = 0, bad_p = 0, bad_w = 0;
+	std::vector<struct rtree_hit> hits;
+	std::vector<unsigned int> got, want;
+	for (int q=0; q < 60; q++)
+	{
+		unsigned int at = rand() % v.bounds.size();
+		GerbObj * o = v.bounds.objs[at];
+		struct obj_dist od = {&v.bounds, o};
+		std::vector<double> all;
+		for (unsigned int i=0; i < v.bounds.size(); i++)
+			all.push_back(od(i));
+		
+		nearest_vector_outp(&v, o, 6, hits);
+		if (!check_hits(hits, all, 6, INFINITY, od))
+			bad_n++;
+		nearest_vector_outp(&v, o, 50, hits, 200000);
+		if (!check_hits(hits, all, 50, 200000, od))
+			bad_n++;
+		
+		coord_t d = rnd(0, 800000);
+		within_vector_outp(&v, o, d, got);
+		want.clear();
+		for (unsigned int i=0; i < all.size(); i++)
+			if (all[i] <= d)
+				want.push_back(i);
+		if (got != want)
+			bad_w++;
+		
+		coord_t x = rnd(0, 20000000), y = rnd(0, 20000000);
+		struct pt_dist pd = {&v.bounds, x, y};
+		std::vector<double> pall;
+		for (unsigned int i=0; i < v.bounds.size(); i++)
+			pall.push_back(pd(i));
+		nearest_vector_outp(&v, x, y, 4, hits);
+		if (!check_hits(hits, pall, 4, INFINITY, pd))
+			bad_p++;
+	}
+	TEST_EQUALS_I(bad_n, 0);
+	TEST_EQUALS_I(bad_w, 0);
+	TEST_EQUALS_I(bad_p, 0);
+	END_TEST();
+}
+
+void close_pairs_test(void)
+{
+	START_TEST("close_pairs_vector_outp (against all pairs)");
+	srand(16);
+	Vector_Outp v;
+	random_layer(v, 400);
+	
+	coord_t ds[] = {0, 100000, 1000000};
+	int bad = 0;
+	for (int k=0; k < 3; k++)
+	{
+		std::vector<bounds_pair_t> got, want;
+		close_pairs_vector_outp(&v, ds[k], got);
+		for (unsigned int i=0; i < v.bounds.size(); i++)
+			for (unsigned int j=i + 1; j < v.bounds.size(); j++)
+				if (obj_gap(v.bounds.objs[i], v.bounds.objs[j], -1) <= ds[k])
+					want.push_back(bounds_pair_t(i, j));
+		if (got != want || want.empty())
+			bad++;
+	}
+	TEST_EQUALS_I(bad, 0);
+	END_TEST();
+}
+
+void nearest_tests(void)
+{
+	nearest_box_test();
+	nearest_layer_test();
+	close_pairs_test();
+}
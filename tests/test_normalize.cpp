@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "test_funcs.h"
+#include "../src/normalize.h"
+
+static ring_t make_ring(const coord_t (*c)[2], unsigned int n)
+{
+	ring_t r;
+	for (unsigned int i=0; i < n; i++)
+		r.push_back(Point(c[i][0], c[i][1]));
+	return r;
+}
+
+int nonzero_winding(const ring_t & r, const Point & p)
+{
+	int w = 0;
+	for (unsigned int i=0; i < r.size(); i++)
+	{
+		const Point & a = r[i], & b = r[(i + 1) % r.size()];
+		double s = (double)(b.x - a.x) * (p.y - a.y) - (double)(b.y - a.y) * (p.x - a.x);
+		if (a.y <= p.y && b.y > p.y && s > 0)
+			w++;
+		else if (a.y > p.y && b.y <= p.y && s < 0)
+			w--;
+	}
+	return w;
+}
+
+double ring_edge_dist(const ring_t & r, const Point & p)
+{
+	double best = INFINITY;
+	for (unsigned int i=0; i < r.size(); i++)
+		best = fmin(best, pt_seg_dist(p, r[i], r[(i + 1) % r.size()]));
+	return best;
+}
+
+static double total_area(const ring_list_t & out)
+{
+	double a = 0;
+	for (unsigned int i=0; i < out.size(); i++)
+		a += ring_area(out[i]);
+	return a;
+}
+
+static bool in_any(const ring_list_t & out, const Point & p)
+{
+	for (unsigned int i=0; i < out.size(); i++)
+		if (point_in_ring(out[i], p))
+			return true;
+	return false;
+}
+
+void normalize_bowtie_test(void)
+{
+	START_TEST("ring_normalize (bowtie)");
+	static const coord_t c[][2] = {{0, 0}, {1000, 1000}, {1000, 0}, {0, 1000}};
+	ring_list_t out;
+	struct normalize_stats st = {0};
+	
+	TEST_OUTPUT(ring_normalize(make_ring(c, 4), out, st));
+	TEST_EQUALS_I(out.size(), 2);
+	TEST_EQUALS_I(st.crossings, 1);
+	TEST_EQUALS_I(st.split, 1);
+	TEST_OUTPUT(ring_area(out[0]) > 0 && ring_area(out[1]) > 0);
+	TEST_OUTPUT(fabs(total_area(out) - 500000) < 1);
+	TEST_EQUALS_I(ring_crossings(out[0]) + ring_crossings(out[1]), 0);
+	END_TEST();
+}
+
+void normalize_keyhole_test(void)
+{
+	START_TEST("ring_normalize (hole keyholed)");
+	// A square, then back round a smaller one the other way from the
+	// same corner: nonzero leaves the middle empty
+	static const coord_t c[][2] = {
+		{0, 0}, {3000, 0}, {3000, 3000}, {0, 3000}, {0, 0},
+		{1000, 1000}, {1000, 2000}, {2000, 2000}, {2000, 1000}, {1000, 1000}};
+	ring_list_t out;
+	struct normalize_stats st = {0};
+	
+	TEST_OUTPUT(ring_normalize(make_ring(c, 10), out, st));
+	TEST_EQUALS_I(out.size(), 1);
+	TEST_EQUALS_I(st.holes, 1);
+	TEST_OUTPUT(fabs(total_area(out) - 8000000) < 1);
+	TEST_OUTPUT(point_in_ring(out[0], Point(500, 500)));
+	TEST_OUTPUT(point_in_ring(out[0], Point(2500, 2700)));
+	TEST_OUTPUT(!point_in_ring(out[0], Point(1500, 1500)));
+	END_TEST();
+}
+
+void normalize_simple_test(void)
+{
+	START_TEST("ring_normalize (clockwise, spike, repeat)");
+	static const coord_t cw[][2] = {{0, 0}, {0, 1000}, {1000, 1000}, {1000, 0}};
+	ring_list_t out;
+	struct normalize_stats st = {0};
+	TEST_OUTPUT(ring_normalize(make_ring(cw, 4), out, st));
+	TEST_EQUALS_I(st.reversed, 1);
+	TEST_EQUALS_I(out.size(), 1);
+	TEST_OUTPUT(fabs(ring_area(out[0]) - 1000000) < 1);
+	
+	static const coord_t sp[][2] = {
+		{0, 0}, {1000, 0}, {1000, 1000}, {500, 1000}, {500, 2000},
+		{500, 1000}, {0, 1000}, {0, 1000}};
+	struct normalize_stats st2 = {0};
+	out.clear();
+	TEST_OUTPUT(ring_normalize(make_ring(sp, 8), out, st2));
+	TEST_OUTPUT(st2.degenerate > 0);
+	TEST_EQUALS_I(out.size(), 1);
+	TEST_OUTPUT(fabs(ring_area(out[0]) - 1000000) < 1);
+	TEST_OUTPUT(ring_bounds(out[0]).getHeight() == 1000);
+	
+	// Nothing left of a flat outline
+	static const coord_t flat[][2] = {{0, 0}, {1000, 0}, {2000, 0}};
+	struct normalize_stats st3 = {0};
+	out.clear();
+	TEST_OUTPUT(!ring_normalize(make_ring(flat, 3), out, st3));
+	TEST_OUTPUT(out.empty());
+	END_TEST();
+}
+
+void normalize_random_test(void)
+{
+	START_TEST("ring_normalize (against nonzero winding)");
+	srand(3);
+	int bad = 0, crossed = 0, checked = 0;
+	for (int k=0; k < 40; k++)
+	{
+		ring_t r;
+		int n = 4 + rand() % 9;
+		for (int i=0; i < n; i++)
+			r.push_back(Point(rand() % 10000, rand() % 10000));
+		
+		ring_list_t out;
+		struct normalize_stats st = {0};
+		ring_normalize(r, out, st);
+		for (unsigned int i=0; i < out.size(); i++)
+			if (ring_area(out[i]) <= 0)
+				bad++;
+		
+		// Samples right on an input edge may land either way once
+		// crossings are rounded to the grid
+		for (int s=0; s < 400; s++)
+		{
+			Point p(rand() % 10000, rand() % 10000);
+			if (ring_edge_dist(r, p) < 2)
+				continue;
+			checked++;
+			if ((nonzero_winding(r, p) != 0) != in_any(out, p))
+				crossed++;
+		}
+	}
+	TEST_EQUALS_I(bad, 0);
+	TEST_EQUALS_I(crossed, 0);
+	TEST_OUTPUT(checked > 10000);
+	END_TEST();
+}
+
+void normalize_tests(void)
+{
+	normalize_bowtie_test();
+	normalize_keyhole_test();
+	normalize_simple_test();
+	normalize_random_test();
+}
@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+
+#include "test_funcs.h"
+#include "../src/packed_points.h"
+#include "../src/gerbobj_poly.h"
+
+static bool same_point(const Point & a, const Point & b)
+{
+	return a.x == b.x && a.y == b.y;
+}
+
+// Number of points that don't come back out the way they went in
+static int round_trip(const std::vector<Point> & in)
+{
+	PackedPoints pp;
+	pp.pack(in.data(), in.size());
+	if (pp.size() != in.size())
+		return -1;
+	
+	int bad = 0;
+	unsigned int i = 0;
+	for (PackedPoints::const_iterator it = pp.begin(); it != pp.end(); it++, i++)
+		if (i >= in.size() || !same_point(*it, in[i]))
+			bad++;
+	return i == in.size() ? bad : -1;
+}
+
+void packed_round_trip_test(void)
+{
+	START_TEST("PackedPoints (round trip)");
+	srand(2);
+	std::vector<Point> pts;
+	
+	// A short walk with small steps either way, starting off negative
+	Point c(-123456789, -5);
+	for (int i=0; i < 1000; i++)
+	{
+		c.x += rand() % 2001 - 1000;
+		c.y += rand() % 2001 - 1000;
+		pts.push_back(c);
+	}
+	TEST_EQUALS_I(round_trip(pts), 0);
+	
+	// Steps that need every byte of a varint
+	pts.clear();
+	const coord_t big = (coord_t)1 << 61;
+	pts.push_back(Point(big, -big));
+	pts.push_back(Point(-big, big));
+	pts.push_back(Point(0, 0));
+	pts.push_back(Point(-1, 1));
+	pts.push_back(Point(big - 1, big - 1));
+	TEST_EQUALS_I(round_trip(pts), 0);
+	
+	pts.clear();
+	pts.push_back(Point(7, -7));
+	TEST_EQUALS_I(round_trip(pts), 0);
+	END_TEST();
+}
+
+void packed_empty_test(void)
+{
+	START_TEST("PackedPoints (empty)");
+	PackedPoints pp;
+	pp.pack(NULL, 0);
+	TEST_OUTPUT(pp.empty());
+	TEST_EQUALS_I(pp.size(), 0);
+	TEST_OUTPUT(pp.begin() == pp.end());
+	END_TEST();
+}
+
+void packed_size_test(void)
+{
+	START_TEST("PackedPoints (short steps stay short)");
+	std::vector<Point> pts;
+	for (int i=0; i < 360; i++)
+		pts.push_back(Point(25400000 + (coord_t)(250000 * cos(i * M_PI / 180)),
+			25400000 + (coord_t)(250000 * sin(i * M_PI / 180))));
+	PackedPoints pp;
+	pp.pack(pts.data(), pts.size());
+	
+	// A 0.25 mm radius steps about 4.4 um a degree, and steps under 2^13 nm
+	// take 2 bytes an axis
+	TEST_OUTPUT(pp.bytes() <= 16 + 4 * (long)pts.size());
+	END_TEST();
+}
+
+void packed_poly_test(void)
+{
+	START_TEST("GerbObj_Poly pack / unpack");
+	GerbObj_Poly p;
+	for (int i=0; i < 100; i++)
+		p.addPoint(Point(i * 1000 - 50000, (i % 7) * -300));
+	Rect before = p.getBounds();
+	
+	p.pack();
+	TEST_OUTPUT(p.isPacked());
+	TEST_OUTPUT(p.points.empty());
+	TEST_EQUALS_I(p.pointCount(), 100);
+	
+	int bad = 0, i = 0;
+	for (GerbObj_Poly::point_iter it = p.pointBegin(); it != p.pointEnd(); ++it, i++)
+		if ((*it).x != i * 1000 - 50000 || (*it).y != (i % 7) * -300)
+			bad++;
+	TEST_EQUALS_I(bad, 0);
+	TEST_EQUALS_I(i, 100);
+	
+	Rect after = p.getBounds();
+	TEST_OUTPUT(same_point(after.getStartPoint(), before.getStartPoint()));
+	TEST_OUTPUT(same_point(after.getEndPoint(), before.getEndPoint()));
+	
+	// Adding a point unpacks first
+	p.addPoint(Point(0, 1000));
+	TEST_OUTPUT(!p.isPacked());
+	TEST_EQUALS_I(p.points.size(), 101);
+	TEST_OUTPUT(p.points[99].x == 49000 && p.points[100].y == 1000);
+	END_TEST();
+}
+
+void packed_points_tests(void)
+{
+	packed_round_trip_test();
+	packed_empty_test();
+	packed_size_test();
+	packed_poly_test();
+}
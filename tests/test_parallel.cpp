@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <math.h>
+
+#include "test_funcs.h"
+#include "../src/gcode_interp.h"
+#include "../src/gerber_parse.h"
+#include "../src/gerbobj_line.h"
+#include "../src/gerbobj_poly.h"
+
+static unsigned int par_seed;
+
+static double par_rnd(double lo, double hi)
+{
+	par_seed = par_seed * 1103515245 + 12345;
+	return lo + (hi - lo) * ((par_seed >> 8) & 0xffff) / 65536.0;
+}
+
+/*
+ * A layer using every kind of block the interpreter keeps modal state
+ * for: aperture selection, interpolation and quadrant modes, regions and
+ * polarity. Written to a file, since the parser reads from one
+ */
+static sp_RS274X_Program par_layer(int n)
+{
+	char name[] = "/tmp/gerbtestXXXXXX";
+	int fd = mkstemp(name);
+	if (fd < 0)
+		return sp_RS274X_Program();
+	FILE * f = fdopen(fd, "w");
+
+	fprintf(f, "%%FSLAX24Y24*%%\n%%MOIN*%%\n");
+	fprintf(f, "%%AMBOX*21,1,0.047,0.027,0,0,30*1,1,0.015,0.011,0*%%\n");
+	fprintf(f, "%%ADD10C,0.010*%%\n%%ADD11R,0.043X0.023*%%\n%%ADD12O,0.019X0.051*%%\n");
+	fprintf(f, "%%ADD13P,0.039X6X15*%%\n%%ADD14BOX*%%\n%%ADD15C,0.030*%%\n");
+
+	double x = 1, y = 1;
+	for (int i=0; i < n; i++)
+	{
+		double k = par_rnd(0, 1);
+		if (k < 0.3)
+		{
+			fprintf(f, "D%d*\nX%dY%dD02*\n", k < 0.15 ? 10 : 15, (int)(x * 1e4), (int)(y * 1e4));
+			x = fmin(2, fmax(0, x + par_rnd(-0.1, 0.1)));
+			y = fmin(2, fmax(0, y + par_rnd(-0.1, 0.1)));
+			fprintf(f, "G01X%dY%dD01*\n", (int)(x * 1e4), (int)(y * 1e4));
+		} else if (k < 0.5) {
+			fprintf(f, "D%d*\nX%dY%dD03*\n", 10 + (int)par_rnd(0, 6),
+				(int)par_rnd(0, 2e4), (int)par_rnd(0, 2e4));
+		} else if (k < 0.65) {
+			int cx = (int)par_rnd(0, 2e4), cy = (int)par_rnd(0, 2e4), r = (int)par_rnd(100, 800);
+			fprintf(f, "D10*\n%s\nX%dY%dD02*\n", k < 0.6 ? "G75*" : "G74*", cx + r, cy);
+			fprintf(f, "G03X%dY%dI%dJ0D01*\nG01*\n", cx, cy + r, k < 0.6 ? -r : r);
+		} else if (k < 0.75) {
+			int cx = (int)par_rnd(0, 2e4), cy = (int)par_rnd(0, 2e4), s = (int)par_rnd(200, 1200);
+			fprintf(f, "G36*\nX%dY%dD02*\nG01X%dY%dD01*\n", cx, cy, cx + s, cy);
+			fprintf(f, "X%dY%dD01*\nX%dY%dD01*\nX%dY%dD01*\nG37*\n",
+				cx + s * 13 / 10, cy + s, cx, cy + s * 8 / 10, cx, cy);
+		} else if (k < 0.8) {
+			fprintf(f, "%%LPC*%%\nD15*\nX%dY%dD03*\n%%LPD*%%\n", (int)par_rnd(0, 2e4), (int)par_rnd(0, 2e4));
+		}
+	}
+	fprintf(f, "M02*\n");
+	fclose(f);
+
+	sp_RS274X_Program p = parseRS274X(name);
+	unlink(name);
+	return p;
+}
+
+static bool par_same_obj(GerbObj * a, GerbObj * b)
+{
+	Rect ra = a->getBounds(), rb = b->getBounds();
+	if (ra.getStartPoint().x != rb.getStartPoint().x || ra.getStartPoint().y != rb.getStartPoint().y ||
+		ra.getEndPoint().x != rb.getEndPoint().x || ra.getEndPoint().y != rb.getEndPoint().y)
+		return false;
+
+	GerbObj_Line * la = dynamic_cast<GerbObj_Line *>(a), * lb = dynamic_cast<GerbObj_Line *>(b);
+	if (la || lb)
+		return la && lb && la->sx == lb->sx && la->sy == lb->sy && la->ex == lb->ex && la->ey == lb->ey &&
+			la->width == lb->width && la->lc == lb->lc;
+
+	GerbObj_Poly * pa = dynamic_cast<GerbObj_Poly *>(a), * pb = dynamic_cast<GerbObj_Poly *>(b);
+	return pa && pb && pa->points.size() == pb->points.size();
+}
+
+// Objects that differ between the layers, by position
+static int par_diffs(Vector_Outp * a, Vector_Outp * b)
+{
+	int bad = 0;
+	std::list<sp_GerbObj>::iterator i = a->all.begin(), j = b->all.begin();
+	for (; i != a->all.end() && j != b->all.end(); i++, j++)
+		if (!par_same_obj((*i).get(), (*j).get()))
+			bad++;
+	return bad;
+}
+
+// Objects still tagged clear, none once polarity is composed
+static int par_num_clear(Vector_Outp * v)
+{
+	int n = 0;
+	std::list<sp_GerbObj>::iterator i = v->all.begin();
+	for (; i != v->all.end(); i++)
+		if ((*i)->clear)
+			n++;
+	return n;
+}
+
+int layer_id_errors(Vector_Outp * v)
+{
+	int bad = v->bounds.size() == v->all.size() ? 0 : 1;
+	obj_id_t id = 0;
+	std::list<sp_GerbObj>::iterator i = v->all.begin();
+	for (; i != v->all.end(); i++, id++)
+		if ((*i)->id != id || id >= v->bounds.size() || v->bounds.objs[id] != (*i).get())
+			bad++;
+	return bad;
+}
+
+void parallel_test(void)
+{
+	START_TEST("gcode_run_parallel matches gcode_run");
+	par_seed = 7;
+	sp_RS274X_Program p = par_layer(600);
+	TEST_ASSERT(p.get() != NULL);
+
+	sp_Vector_Outp serial = gcode_run(p);
+	TEST_ASSERT(serial.get() != NULL);
+	TEST_ASSERT(serial->all.size() > 500);
+	TEST_EQUALS_I(layer_id_errors(serial.get()), 0);
+
+	int threads[] = {1, 2, 4};
+	for (int t=0; t < 3; t++)
+	{
+		// Segments of 16 blocks, so there are plenty of checkpoints
+		sp_Vector_Outp par = gcode_run_parallel(p, threads[t], 16);
+		TEST_ASSERT(par.get() != NULL);
+		TEST_EQUALS_I(par->all.size(), serial->all.size());
+		TEST_EQUALS_I(par_diffs(serial.get(), par.get()), 0);
+		TEST_EQUALS_I(par->has_clear, serial->has_clear);
+		TEST_EQUALS_I(par_num_clear(par.get()), 0);
+		
+		// Each segment numbered its objects from 0, the joined layer is
+		// renumbered as a whole
+		TEST_EQUALS_I(layer_id_errors(par.get()), 0);
+	}
+	END_TEST();
+}
+
+void parallel_tests(void)
+{
+	parallel_test();
+}
@@ -0,0 +1,397 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <math.h>
+
+#include "test_funcs.h"
+#include "../src/polarity.h"
+#include "../src/polygonize.h"
+#include "../src/gerber_parse.h"
+#include "../src/gerbobj_line.h"
+#include "../src/gerbobj_poly.h"
+#include "../src/ring.h"
+
+// Layer point from microns
+static Point pt(double x, double y)
+{
+	Point p;
+	p.x = um_to_coord(x);
+	p.y = um_to_coord(y);
+	return p;
+}
+
+static GerbObj * pol_rect(double x0, double y0, double x1, double y1, bool clear)
+{
+	GerbObj_Poly * p = new GerbObj_Poly();
+	p->addPoint(pt(x0, y0));
+	p->addPoint(pt(x1, y0));
+	p->addPoint(pt(x1, y1));
+	p->addPoint(pt(x0, y1));
+	p->clear = clear;
+	return p;
+}
+
+static GerbObj * pol_line(double sx, double sy, double ex, double ey, double w, bool clear)
+{
+	GerbObj_Line * l = new GerbObj_Line();
+	l->sx = um_to_coord(sx);
+	l->sy = um_to_coord(sy);
+	l->ex = um_to_coord(ex);
+	l->ey = um_to_coord(ey);
+	l->width = um_to_coord(w);
+	l->lt = LT_STRAIGHT;
+	l->lc = GerbObj_Line::LC_ROUND;
+	l->clear = clear;
+	return l;
+}
+
+static void pol_add(Vector_Outp & v, GerbObj * o)
+{
+	v.all.push_back(sp_GerbObj(o));
+	if (o->clear)
+		v.has_clear = true;
+}
+
+// Outline of an object, lines as compose_polarity sees them
+static void pol_ring(GerbObj * o, ring_t & r)
+{
+	r.clear();
+	GerbObj_Poly * p = dynamic_cast<GerbObj_Poly *>(o);
+	if (p)
+	{
+		r.assign(p->points.begin(), p->points.end());
+		return;
+	}
+	GerbObj_Line * l = dynamic_cast<GerbObj_Line *>(o);
+	if (l && (p = createPolyForLine(l)))
+	{
+		r.assign(p->points.begin(), p->points.end());
+		delete p;
+	}
+}
+
+// Sum of the areas of the objects [um^2]. Equal to the area covered as
+// long as they don't overlap
+static double pol_area(Vector_Outp & v)
+{
+	double a = 0;
+	std::list<sp_GerbObj>::iterator i = v.all.begin();
+	for (; i != v.all.end(); i++)
+	{
+		ring_t r;
+		pol_ring((*i).get(), r);
+		a += fabs(ring_area(r));
+	}
+	return a / ((double)COORD_PER_UM * COORD_PER_UM);
+}
+
+static bool pol_dark(Vector_Outp & v, const Point & p)
+{
+	std::list<sp_GerbObj>::iterator i = v.all.begin();
+	for (; i != v.all.end(); i++)
+	{
+		ring_t r;
+		pol_ring((*i).get(), r);
+		if (point_in_ring(r, p))
+			return true;
+	}
+	return false;
+}
+
+static int pol_num_clear(Vector_Outp & v)
+{
+	int n = 0;
+	std::list<sp_GerbObj>::iterator i = v.all.begin();
+	for (; i != v.all.end(); i++)
+		if ((*i)->clear)
+			n++;
+	return n;
+}
+
+void polarity_hole_test(void)
+{
+	START_TEST("compose_polarity hole inside a pad");
+	Vector_Outp v;
+	pol_add(v, pol_rect(0, 0, 1000, 1000, false));
+	pol_add(v, pol_rect(400, 400, 600, 600, true));
+	compose_polarity(&v);
+
+	TEST_EQUALS_I(v.all.size(), 1);
+	TEST_EQUALS_I(pol_num_clear(v), 0);
+	TEST_OUTPUT(!v.has_clear);
+	TEST_OUTPUT(fabs(pol_area(v) - (1e6 - 4e4)) < 1);
+	TEST_OUTPUT(!pol_dark(v, pt(500, 500)));
+	TEST_OUTPUT(pol_dark(v, pt(300, 500)));
+	TEST_OUTPUT(pol_dark(v, pt(700, 500)));
+	TEST_OUTPUT(pol_dark(v, pt(500, 900)));
+	END_TEST();
+}
+
+void polarity_split_test(void)
+{
+	START_TEST("compose_polarity cut splitting a pad in two");
+	Vector_Outp v;
+	pol_add(v, pol_rect(0, 0, 1000, 200, false));
+	pol_add(v, pol_rect(450, -100, 550, 300, true));
+	compose_polarity(&v);
+
+	TEST_EQUALS_I(v.all.size(), 2);
+	TEST_OUTPUT(fabs(pol_area(v) - (2e5 - 2e4)) < 1);
+	TEST_OUTPUT(!pol_dark(v, pt(500, 100)));
+	TEST_OUTPUT(pol_dark(v, pt(400, 100)));
+	TEST_OUTPUT(pol_dark(v, pt(600, 100)));
+
+	// One piece each side of the cut
+	std::list<sp_GerbObj>::iterator i = v.all.begin();
+	Rect a = (*i)->getBounds(), b = (*++i)->getBounds();
+	TEST_OUTPUT(coord_to_um(a.getEndPoint().x) < 451 || coord_to_um(b.getEndPoint().x) < 451);
+	TEST_OUTPUT(coord_to_um(a.getStartPoint().x) > 549 || coord_to_um(b.getStartPoint().x) > 549);
+	END_TEST();
+}
+
+void polarity_line_test(void)
+{
+	START_TEST("compose_polarity clear line across a trace");
+	Vector_Outp v;
+	pol_add(v, pol_line(0, 0, 2000, 0, 100, false));
+	double before = pol_area(v);
+	pol_add(v, pol_line(1000, -500, 1000, 500, 200, true));
+	compose_polarity(&v);
+
+	TEST_EQUALS_I(v.all.size(), 2);
+	TEST_OUTPUT(dynamic_cast<GerbObj_Poly *>(v.all.front().get()) != NULL);
+
+	// The clear line is straight where it crosses, so takes out 200 x 100
+	TEST_OUTPUT(fabs(pol_area(v) - (before - 2e4)) < 1);
+	TEST_OUTPUT(!pol_dark(v, pt(1000, 0)));
+	TEST_OUTPUT(!pol_dark(v, pt(1090, 40)));
+	TEST_OUTPUT(pol_dark(v, pt(800, 0)));
+	TEST_OUTPUT(pol_dark(v, pt(1200, 0)));
+	TEST_OUTPUT(pol_dark(v, pt(1999, 0)));
+	END_TEST();
+}
+
+void polarity_concave_test(void)
+{
+	START_TEST("compose_polarity concave clear region");
+	Vector_Outp v;
+	pol_add(v, pol_rect(0, 0, 1000, 1000, false));
+
+	// L over the bottom left corner, the notch of the L over the pad
+	GerbObj_Poly * c = new GerbObj_Poly();
+	c->addPoint(pt(-200, -200));
+	c->addPoint(pt(400, -200));
+	c->addPoint(pt(400, 100));
+	c->addPoint(pt(100, 100));
+	c->addPoint(pt(100, 400));
+	c->addPoint(pt(-200, 400));
+	c->clear = true;
+	pol_add(v, c);
+
+	// And a concave [U shaped] clear region wholly inside
+	c = new GerbObj_Poly();
+	c->addPoint(pt(600, 600));
+	c->addPoint(pt(900, 600));
+	c->addPoint(pt(900, 900));
+	c->addPoint(pt(800, 900));
+	c->addPoint(pt(800, 700));
+	c->addPoint(pt(700, 700));
+	c->addPoint(pt(700, 900));
+	c->addPoint(pt(600, 900));
+	c->clear = true;
+	pol_add(v, c);
+	compose_polarity(&v);
+
+	TEST_OUTPUT(v.all.size() >= 1);
+	TEST_EQUALS_I(pol_num_clear(v), 0);
+	TEST_OUTPUT(fabs(pol_area(v) - (1e6 - 7e4 - 7e4)) < 1);
+	TEST_OUTPUT(!pol_dark(v, pt(50, 50)));
+	TEST_OUTPUT(!pol_dark(v, pt(300, 50)));
+	TEST_OUTPUT(!pol_dark(v, pt(50, 300)));
+	TEST_OUTPUT(pol_dark(v, pt(200, 200)));
+	TEST_OUTPUT(!pol_dark(v, pt(650, 800)));
+	TEST_OUTPUT(pol_dark(v, pt(750, 800)));
+	TEST_OUTPUT(pol_dark(v, pt(500, 500)));
+	END_TEST();
+}
+
+static unsigned int pol_seed;
+
+static double pol_rnd(double lo, double hi)
+{
+	pol_seed = pol_seed * 1103515245 + 12345;
+	return lo + (hi - lo) * ((pol_seed >> 8) & 0xffff) / 65536.0;
+}
+
+static double overlap(double a0, double a1, double b0, double b1)
+{
+	return fmax(0, fmin(a1, b1) - fmax(a0, b0));
+}
+
+void polarity_area_test(void)
+{
+	START_TEST("compose_polarity conserves area");
+	pol_seed = 11;
+
+	// Pads in a row, not touching, and clear squares on a grid that
+	// don't touch each other. Some fall inside a pad, some across an
+	// edge or between two, some miss
+	Vector_Outp v;
+	double expect = 0;
+	for (int i=0; i < 4; i++)
+	{
+		pol_add(v, pol_rect(i * 3000, 0, i * 3000 + 2500, 2500, false));
+		expect += 2500 * 2500;
+	}
+
+	int bad = 0;
+	for (int gx=0; gx < 24; gx++)
+		for (int gy=0; gy < 6; gy++)
+		{
+			double x = gx * 500 + pol_rnd(0, 150) - 100, y = gy * 500 + pol_rnd(0, 150) - 100;
+			double s = pol_rnd(50, 300);
+			pol_add(v, pol_rect(x, y, x + s, y + s, true));
+			for (int i=0; i < 4; i++)
+				expect -= overlap(x, x + s, i * 3000, i * 3000 + 2500) * overlap(y, y + s, 0, 2500);
+		}
+
+	// Drawn after the last clear object, so it stays as it is
+	GerbObj * last = pol_rect(0, 3000, 100, 3100, false);
+	pol_add(v, last);
+	expect += 100 * 100;
+
+	struct polarity_stats st = compose_polarity(&v);
+	TEST_EQUALS_I(pol_num_clear(v), 0);
+	TEST_OUTPUT(v.all.back().get() == last);
+	TEST_OUTPUT(st.cuts > 0 && st.verts_out <= st.verts_in);
+	TEST_OUTPUT(fabs(pol_area(v) - expect) < 10);
+	
+	// Cut pieces took the place of the pads, ids are dense again
+	TEST_EQUALS_I(layer_id_errors(&v), 0);
+
+	// No slivers left behind
+	std::list<sp_GerbObj>::iterator i = v.all.begin();
+	for (; i != v.all.end(); i++)
+	{
+		ring_t r;
+		pol_ring((*i).get(), r);
+		if (fabs(ring_area(r)) < RING_MIN_AREA)
+			bad++;
+	}
+	TEST_EQUALS_I(bad, 0);
+	END_TEST();
+}
+
+// Is p dark, drawing the objects one after the other
+static bool pol_painted(std::vector<GerbObj *> & objs, const Point & p)
+{
+	bool dark = false;
+	for (unsigned int i=0; i < objs.size(); i++)
+	{
+		ring_t r;
+		pol_ring(objs[i], r);
+		if (point_in_ring(r, p))
+			dark = !objs[i]->clear;
+	}
+	return dark;
+}
+
+void polarity_paint_test(void)
+{
+	START_TEST("compose_polarity matches drawing in order");
+	pol_seed = 5;
+
+	// Overlapping traces, pads and round clearances in any order
+	Vector_Outp v;
+	std::vector<GerbObj *> orig;
+	for (int i=0; i < 120; i++)
+	{
+		double k = pol_rnd(0, 1);
+		double x = pol_rnd(0, 5000), y = pol_rnd(0, 5000);
+		GerbObj * o;
+		if (k < 0.3)
+			o = pol_line(x, y, x + pol_rnd(-1000, 1000), y + pol_rnd(-1000, 1000), pol_rnd(50, 300), false);
+		else if (k < 0.5)
+			o = pol_rect(x, y, x + pol_rnd(100, 1500), y + pol_rnd(100, 1500), false);
+		else if (k < 0.8)
+			o = pol_line(x, y, x, y, pol_rnd(100, 600), true);
+		else
+			o = pol_line(x, y, x + pol_rnd(-1000, 1000), y + pol_rnd(-1000, 1000), pol_rnd(50, 200), true);
+
+		// Keep a copy to paint with, the layer objects get replaced
+		if (dynamic_cast<GerbObj_Line *>(o))
+			orig.push_back(new GerbObj_Line(*dynamic_cast<GerbObj_Line *>(o)));
+		else
+			orig.push_back(new GerbObj_Poly(*dynamic_cast<GerbObj_Poly *>(o)));
+		pol_add(v, o);
+	}
+	compose_polarity(&v);
+	TEST_EQUALS_I(pol_num_clear(v), 0);
+
+	// Off grid, so no sample sits on an edge
+	int bad = 0, dark = 0, n = 0;
+	for (double x=-533.3; x < 6500; x += 47.1)
+		for (double y=-533.3; y < 6500; y += 47.1)
+		{
+			Point p = pt(x, y);
+			bool want = pol_painted(orig, p);
+			if (want != pol_dark(v, p))
+				bad++;
+			if (want)
+				dark++;
+			n++;
+		}
+
+	for (unsigned int i=0; i < orig.size(); i++)
+		delete orig[i];
+
+	TEST_OUTPUT(dark > n / 10);
+	TEST_EQUALS_I(bad, 0);
+	END_TEST();
+}
+
+void polarity_donut_test(void)
+{
+	START_TEST("compose_polarity %LPC macro donut clears only the ring");
+	char name[] = "/tmp/gerbtestXXXXXX";
+	int fd = mkstemp(name);
+	TEST_ASSERT(fd >= 0);
+	FILE * f = fdopen(fd, "w");
+
+	// 4mm pad, then a 2mm donut with a 1mm hole flashed clear in the middle
+	fprintf(f, "%%FSLAX34Y34*%%\n%%MOMM*%%\nG71*\n");
+	fprintf(f, "%%AMDONUT*1,1,2.0,0,0*1,0,1.0,0,0*%%\n%%ADD10DONUT*%%\n");
+	fprintf(f, "G36*\nX0Y0D02*\nG01X40000Y0D01*\nX40000Y40000D01*\nX0Y40000D01*\nX0Y0D01*\nG37*\n");
+	fprintf(f, "%%LPC*%%\nD10*\nX20000Y20000D03*\n%%LPD*%%\nM02*\n");
+	fclose(f);
+
+	sp_RS274X_Program p = parseRS274X(name);
+	unlink(name);
+	TEST_ASSERT(p.get() != NULL);
+	sp_Vector_Outp v = gcode_run(p);
+	TEST_ASSERT(v.get() != NULL);
+
+	TEST_EQUALS_I(pol_num_clear(*v), 0);
+	TEST_OUTPUT(pol_dark(*v, pt(2000, 2000)));
+	TEST_OUTPUT(pol_dark(*v, pt(2300, 2200)));
+	TEST_OUTPUT(!pol_dark(*v, pt(2750, 2000)));
+	TEST_OUTPUT(!pol_dark(*v, pt(2000, 1250)));
+	TEST_OUTPUT(pol_dark(*v, pt(3100, 2000)));
+	TEST_OUTPUT(pol_dark(*v, pt(500, 500)));
+
+	// Pad less the ring
+	double ring = M_PI * (1000 * 1000 - 500 * 500);
+	TEST_OUTPUT(fabs(pol_area(*v) - (4000.0 * 4000 - ring)) < 0.01 * ring);
+	END_TEST();
+}
+
+void polarity_tests(void)
+{
+	polarity_hole_test();
+	polarity_split_test();
+	polarity_line_test();
+	polarity_concave_test();
+	polarity_area_test();
+	polarity_paint_test();
+	polarity_donut_test();
+}
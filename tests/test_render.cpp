@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "test_funcs.h"
+#include "../src/gcode_interp.h"
+#include "../src/render.h"
+#include "../src/gerbobj_line.h"
+#include "../src/gerbobj_poly.h"
+
+static GerbObj * rnd_line(double sx, double sy, double ex, double ey, double w)
+{
+	GerbObj_Line * l = new GerbObj_Line();
+	l->sx = um_to_coord(sx);
+	l->sy = um_to_coord(sy);
+	l->ex = um_to_coord(ex);
+	l->ey = um_to_coord(ey);
+	l->width = um_to_coord(w);
+	l->lt = LT_STRAIGHT;
+	l->lc = GerbObj_Line::LC_ROUND;
+	return l;
+}
+
+static GerbObj * rnd_poly(int n, double r)
+{
+	GerbObj_Poly * p = new GerbObj_Poly();
+	for (int i=0; i < n; i++)
+		p->addPoint(Point(um_to_coord(r * cos(2 * M_PI * i / n)), um_to_coord(r * sin(2 * M_PI * i / n))));
+	return p;
+}
+
+static bool rnd_same_seg(const point_line & a, const point_line & b)
+{
+	return a.lt == b.lt && a.x == b.x && a.y == b.y && a.cx == b.cx && a.cy == b.cy;
+}
+
+void render_layout_test(void)
+{
+	START_TEST("render_vector_outp span layout");
+	Vector_Outp v;
+	v.all.push_back(sp_GerbObj(rnd_line(0, 0, 1000, 0, 100)));
+	v.all.push_back(sp_GerbObj(rnd_poly(8, 500)));
+	v.all.push_back(sp_GerbObj(rnd_line(0, 0, 0, 0, 50)));
+	v.all.push_back(sp_GerbObj(rnd_poly(3, 200)));
+	
+	render_vector_outp(&v);
+	RenderLayer & l = v.render;
+	TEST_EQUALS_I(l.polys.size(), 4);
+	
+	// One span per object in layer order, back to back in the shared
+	// buffer, each holding the same segments as the object's RenderPoly
+	unsigned int next = 0;
+	int bad = 0;
+	std::list<sp_GerbObj>::iterator it = v.all.begin();
+	for (unsigned int i=0; i < l.polys.size(); i++, it++)
+	{
+		const render_span & sp = l.polys[i];
+		sp_RenderPoly rp = (*it)->getPolyData();
+		if (sp.first != next || sp.count != rp->segs.size())
+			bad++;
+		else
+			for (unsigned int j=0; j < sp.count; j++)
+				if (!rnd_same_seg(l.segs[sp.first + j], rp->segs[j]))
+					bad++;
+		if (sp.flag != rp->flag || sp.fillptx != rp->fillptx || sp.fillpty != rp->fillpty)
+			bad++;
+		next += sp.count;
+	}
+	TEST_EQUALS_I(bad, 0);
+	TEST_EQUALS_I(next, l.segs.size());
+	
+	// The polygons are closed outlines of straight segments
+	TEST_EQUALS_I(l.polys[1].count, 8);
+	TEST_EQUALS_I(l.polys[3].count, 3);
+	
+	// Building again replaces the data
+	unsigned int segs = l.segs.size();
+	render_vector_outp(&v);
+	TEST_EQUALS_I(l.polys.size(), 4);
+	TEST_EQUALS_I(l.segs.size(), segs);
+	END_TEST();
+}
+
+void render_cache_test(void)
+{
+	START_TEST("RenderCache LRU order and budget");
+	RenderCache c;
+	sp_GerbObj a(rnd_poly(6, 100)), b(rnd_poly(6, 200)), d(rnd_poly(6, 300));
+	
+	sp_RenderPoly ra = c.get(a.get());
+	c.get(b.get());
+	c.get(d.get());
+	TEST_EQUALS_I(c.getMisses(), 3);
+	TEST_EQUALS_I(c.getEntries(), 3);
+	long e = c.getBytes() / 3;
+	TEST_ASSERT(e > 0 && c.getBytes() == 3 * e);
+	
+	// A hit hands out the same data and makes a the newest
+	TEST_ASSERT(c.get(a.get()) == ra);
+	TEST_EQUALS_I(c.getHits(), 1);
+	
+	// Down to two entries, b is the oldest
+	c.setBudget(2 * e);
+	TEST_EQUALS_I(c.getEntries(), 2);
+	TEST_EQUALS_I(c.getEvictions(), 1);
+	TEST_ASSERT(c.getBytes() <= c.getBudget());
+	
+	// Bringing b back pushes out d, a stays
+	c.get(b.get());
+	TEST_EQUALS_I(c.getMisses(), 4);
+	c.get(a.get());
+	TEST_EQUALS_I(c.getHits(), 2);
+	c.get(d.get());
+	TEST_EQUALS_I(c.getMisses(), 5);
+	TEST_EQUALS_I(c.getEvictions(), 3);
+	TEST_ASSERT(c.getBytes() <= c.getBudget());
+	
+	// The newest entry stays even when it alone is over budget
+	c.setBudget(1);
+	TEST_EQUALS_I(c.getEntries(), 1);
+	c.setBudget(RENDER_CACHE_BUDGET);
+	
+	// Evicted data stays valid for whoever holds it
+	TEST_EQUALS_I(ra->segs.size(), 6);
+	END_TEST();
+}
+
+void render_edit_test(void)
+{
+	START_TEST("RenderCache misses after an edit");
+	RenderCache c;
+	GerbObj_Poly * p = dynamic_cast<GerbObj_Poly *>(rnd_poly(4, 100));
+	sp_GerbObj sp(p);
+	TEST_EQUALS_I(c.get(p)->segs.size(), 4);
+	TEST_EQUALS_I(c.get(p)->segs.size(), 4);
+	TEST_EQUALS_I(c.getHits(), 1);
+	
+	p->addPoint(Point(0, 0));
+	TEST_EQUALS_I(c.get(p)->segs.size(), 5);
+	TEST_EQUALS_I(c.getMisses(), 2);
+	
+	GerbObj_Line * l = dynamic_cast<GerbObj_Line *>(rnd_line(0, 0, 1000, 0, 100));
+	sp_GerbObj sl(l);
+	sp_RenderPoly old = c.get(l);
+	l->sx = um_to_coord(-500);
+	l->geometryChanged();
+	sp_RenderPoly now = c.get(l), fresh = l->buildPolyData();
+	TEST_EQUALS_I(c.getMisses(), 4);
+	TEST_ASSERT(now != old);
+	TEST_EQUALS_I(now->segs.size(), fresh->segs.size());
+	int bad = 0;
+	for (unsigned int i=0; i < now->segs.size(); i++)
+		if (!rnd_same_seg(now->segs[i], fresh->segs[i]))
+			bad++;
+	TEST_EQUALS_I(bad, 0);
+	END_TEST();
+}
+
+void render_tests(void)
+{
+	render_layout_test();
+	render_cache_test();
+	render_edit_test();
+}
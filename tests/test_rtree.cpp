@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "test_funcs.h"
+#include "../src/rtree.h"
+
+static bool slot_used(const PackedRTree & rt, long s)
+{
+	return rt.minx[s] <= rt.maxx[s] && rt.miny[s] <= rt.maxy[s];
+}
+
+/*
+ * Every entry with extent sits in exactly one leaf slot with its own box,
+ * and every inner slot's box holds all the slots of the node it points to.
+ * Returns the number of faults
+ */
+static int check_tree(const PackedRTree & rt, const BoundsTable & t)
+{
+	int bad = 0;
+	if (rt.levels() == 0)
+		return 0;
+	
+	std::vector<int> seen(t.size(), 0);
+	long leaf_end = rt.levels() > 1 ? rt.first[1] : rt.slots();
+	for (long s=rt.first[0]; s < leaf_end; s++)
+	{
+		if (!slot_used(rt, s))
+			continue;
+		unsigned int i = rt.ref[s];
+		if (i >= t.size() || rt.minx[s] != t.minx[i] || rt.miny[s] != t.miny[i] ||
+			rt.maxx[s] != t.maxx[i] || rt.maxy[s] != t.maxy[i])
+			bad++;
+		else
+			seen[i]++;
+	}
+	for (unsigned int i=0; i < t.size(); i++)
+		if (seen[i] != (t.minx[i] <= t.maxx[i] ? 1 : 0))
+			bad++;
+	
+	for (int l=1; l < rt.levels(); l++)
+	{
+		long end = l + 1 < rt.levels() ? rt.first[l + 1] : rt.slots();
+		for (long s=rt.first[l]; s < end; s++)
+		{
+			if (!slot_used(rt, s))
+				continue;
+			long c0 = rt.first[l - 1] + (long)rt.ref[s] * RTREE_FANOUT;
+			for (long c=c0; c < c0 + RTREE_FANOUT; c++)
+				if (slot_used(rt, c) && (rt.minx[c] < rt.minx[s] || rt.miny[c] < rt.miny[s] ||
+					rt.maxx[c] > rt.maxx[s] || rt.maxy[c] > rt.maxy[s]))
+					bad++;
+		}
+	}
+	return bad;
+}
+
+void rtree_query_test(void)
+{
+	START_TEST("PackedRTree query (against a scan)");
+	srand(10);
+	// Either side of a full node, and of a full second level
+	int sizes[] = {0, 1, 15, 16, 17, 255, 256, 257, 5000};
+	int bad_q = 0, bad_t = 0, found = 0;
+	for (int n=0; n < 9; n++)
+	{
+		BoundsTable t;
+		random_table(t, sizes[n]);
+		PackedRTree rt;
+		rt.build(t);
+		bad_t += check_tree(rt, t);
+		
+		std::vector<unsigned int> got, want;
+		for (int q=0; q < 200; q++)
+		{
+			Rect r = random_query();
+			rt.query(r, got);
+			scan(t, r, want);
+			if (got != want)
+				bad_q++;
+			found += want.size();
+		}
+	}
+	TEST_EQUALS_I(bad_t, 0);
+	TEST_EQUALS_I(bad_q, 0);
+	TEST_OUTPUT(found > 1000);
+	END_TEST();
+}
+
+void rtree_edge_test(void)
+{
+	START_TEST("PackedRTree query (edges and empty)");
+	BoundsTable t;
+	t.append(NULL, Rect(0, 0, 1000, 1000));
+	t.append(NULL, Rect(1000, 1000, 2000, 2000));
+	t.append(NULL, Rect());
+	PackedRTree rt;
+	rt.build(t);
+	
+	std::vector<unsigned int> out;
+	rt.query(Rect(1000, 1000, 1000, 1000), out);
+	TEST_EQUALS_I(out.size(), 2);
+	rt.query(Rect(1001, -5000, 5000, 999), out);
+	TEST_OUTPUT(out.empty());
+	rt.query(Rect(), out);
+	TEST_OUTPUT(out.empty());
+	
+	// A copy starts out empty rather than pointing at the same table
+	PackedRTree copy(rt);
+	TEST_OUTPUT(!copy.built());
+	copy.query(Rect(0, 0, 10, 10), out);
+	TEST_OUTPUT(out.empty());
+	END_TEST();
+}
+
+void rtree_tests(void)
+{
+	rtree_query_test();
+	rtree_edge_test();
+}
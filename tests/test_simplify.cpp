@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+
+#include "test_funcs.h"
+#include "../src/simplify.h"
+#include "../src/ring.h"
+
+// Furthest any point of the original lies from the simplified outline
+static double max_stray(const std::vector<Point> & orig, const std::vector<Point> & s)
+{
+	double worst = 0;
+	for (unsigned int i=0; i < orig.size(); i++)
+	{
+		double best = INFINITY;
+		for (unsigned int j=0; j < s.size(); j++)
+			best = fmin(best, pt_seg_dist(orig[i], s[j], s[(j + 1) % s.size()]));
+		worst = fmax(worst, best);
+	}
+	return worst;
+}
+
+// Every point kept is one of the originals
+static bool subset_of(const std::vector<Point> & s, const std::vector<Point> & orig)
+{
+	for (unsigned int j=0; j < s.size(); j++)
+	{
+		bool found = false;
+		for (unsigned int i=0; i < orig.size() && !found; i++)
+			found = s[j].x == orig[i].x && s[j].y == orig[i].y;
+		if (!found)
+			return false;
+	}
+	return true;
+}
+
+void simplify_arc_test(void)
+{
+	START_TEST("simplify_ring (tessellated circle)");
+	std::vector<Point> r;
+	for (int i=0; i < 3600; i++)
+		r.push_back(Point((coord_t)(1e6 * cos(i * M_PI / 1800)), (coord_t)(1e6 * sin(i * M_PI / 1800))));
+	std::vector<Point> orig = r;
+	
+	simplify_ring(r, 100);
+	
+	// A chord within 100nm of a 1mm arc spans about 1.6 degrees
+	TEST_OUTPUT(r.size() < 400);
+	TEST_OUTPUT(r.size() > 100);
+	TEST_OUTPUT(max_stray(orig, r) <= 100);
+	TEST_OUTPUT(subset_of(r, orig));
+	TEST_EQUALS_I(ring_crossings(r), 0);
+	END_TEST();
+}
+
+void simplify_collinear_test(void)
+{
+	START_TEST("simplify_ring (collinear and repeated)");
+	// A square with points along every side, and one repeated corner
+	std::vector<Point> r;
+	for (int i=0; i < 10; i++)
+		r.push_back(Point(i * 1000, 0));
+	for (int i=0; i < 10; i++)
+		r.push_back(Point(10000, i * 1000));
+	r.push_back(Point(10000, 10000));
+	for (int i=10; i > 0; i--)
+		r.push_back(Point(i * 1000, 10000));
+	for (int i=10; i > 0; i--)
+		r.push_back(Point(0, i * 1000));
+	std::vector<Point> orig = r;
+	
+	// With no tolerance only exact repeats and straight runs go
+	simplify_ring(r, 0);
+	TEST_EQUALS_I(r.size(), 4);
+	TEST_OUTPUT(max_stray(orig, r) == 0);
+	END_TEST();
+}
+
+void simplify_min_test(void)
+{
+	START_TEST("simplify_ring (keeps 3 points)");
+	std::vector<Point> r;
+	r.push_back(Point(0, 0));
+	r.push_back(Point(50, 0));
+	r.push_back(Point(50, 30));
+	r.push_back(Point(0, 30));
+	simplify_ring(r, 1000);
+	TEST_OUTPUT(r.size() >= 3);
+	END_TEST();
+}
+
+void simplify_crossing_test(void)
+{
+	START_TEST("simplify_ring (no new crossings)");
+	// A spike reaching down into a notch 90nm above the bottom edge:
+	// thinned at 100nm the notch floor would be cut across
+	static const coord_t c[][2] = {
+		{0, 0}, {1000, 0}, {1000, 2000}, {0, 2000}, {0, 1100}, {480, 1100},
+		{500, 50}, {520, 1100}, {900, 1100}, {900, 100}, {600, 100},
+		{500, 10}, {400, 100}, {0, 100}};
+	std::vector<Point> r;
+	for (unsigned int i=0; i < sizeof(c) / sizeof(c[0]); i++)
+		r.push_back(Point(c[i][0], c[i][1]));
+	TEST_EQUALS_I(ring_crossings(r), 0);
+	
+	simplify_ring(r, 100);
+	TEST_EQUALS_I(ring_crossings(r), 0);
+	TEST_OUTPUT(r.size() >= 3);
+	END_TEST();
+}
+
+void simplify_tests(void)
+{
+	simplify_arc_test();
+	simplify_collinear_test();
+	simplify_min_test();
+	simplify_crossing_test();
+}
@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+
+#include "test_funcs.h"
+#include "../src/trapezoid.h"
+
+ring_t random_star(Point c, double rmin, double rmax, int n)
+{
+	std::vector<double> ang;
+	for (int i=0; i < n; i++)
+		ang.push_back(rand() * 2 * M_PI / RAND_MAX);
+	std::sort(ang.begin(), ang.end());
+	
+	ring_t r;
+	for (int i=0; i < n; i++)
+	{
+		double rad = rmin + (rmax - rmin) * rand() / RAND_MAX;
+		Point p(c.x + (coord_t)(rad * cos(ang[i])), c.y + (coord_t)(rad * sin(ang[i])));
+		if (r.empty() || p.x != r.back().x || p.y != r.back().y)
+			r.push_back(p);
+	}
+	
+	// Either way round
+	if (rand() & 1)
+		std::reverse(r.begin(), r.end());
+	return r;
+}
+
+// Samples that disagree with the winding number, away from the outline
+static int contains_errors(const PolyTraps & t, const ring_t & r, int samples, double margin)
+{
+	int bad = 0;
+	for (int s=0; s < samples; s++)
+	{
+		Point p(rand() % 20000, rand() % 20000);
+		if (ring_edge_dist(r, p) < margin)
+			continue;
+		if (t.contains(p) != (nonzero_winding(r, p) != 0))
+			bad++;
+	}
+	return bad;
+}
+
+void traps_simple_test(void)
+{
+	START_TEST("PolyTraps (simple outlines)");
+	srand(4);
+	int bad_area = 0, bad_in = 0;
+	for (int k=0; k < 50; k++)
+	{
+		ring_t r = random_star(Point(10000, 10000), 1000, 10000, 5 + rand() % 40);
+		if (r.size() < 3 || ring_area(r) == 0)
+			continue;
+		PolyTraps t(r);
+		if (fabs(t.area() - fabs(ring_area(r))) > 1e-6 * fabs(ring_area(r)))
+			bad_area++;
+		bad_in += contains_errors(t, r, 300, 0.5);
+	}
+	TEST_EQUALS_I(bad_area, 0);
+	TEST_EQUALS_I(bad_in, 0);
+	END_TEST();
+}
+
+void traps_crossing_test(void)
+{
+	START_TEST("PolyTraps (self crossing outlines)");
+	srand(5);
+	int bad_in = 0, bad_area = 0;
+	for (int k=0; k < 40; k++)
+	{
+		ring_t r;
+		int n = 4 + rand() % 9;
+		for (int i=0; i < n; i++)
+			r.push_back(Point(rand() % 20000, rand() % 20000));
+		PolyTraps t(r);
+		
+		// Crossings are rounded to the grid, so give the outline room
+		bad_in += contains_errors(t, r, 300, 2);
+		
+		// The area is whatever the nonzero rule covers: count a fine grid
+		long hits = 0;
+		for (int y=50; y < 20000; y += 100)
+			for (int x=50; x < 20000; x += 100)
+				if (nonzero_winding(r, Point(x, y)))
+					hits++;
+		if (fabs(t.area() - hits * 10000.0) > 0.03 * t.area() + 2e5)
+			bad_area++;
+	}
+	TEST_EQUALS_I(bad_in, 0);
+	TEST_EQUALS_I(bad_area, 0);
+	END_TEST();
+}
+
+void traps_bowtie_test(void)
+{
+	START_TEST("PolyTraps (bowtie)");
+	ring_t r;
+	r.push_back(Point(0, 0));
+	r.push_back(Point(1000, 1000));
+	r.push_back(Point(1000, 0));
+	r.push_back(Point(0, 1000));
+	PolyTraps t(r);
+	TEST_EQUALS_F(t.area(), 500000);
+	TEST_OUTPUT(t.contains(Point(100, 500)));
+	TEST_OUTPUT(t.contains(Point(900, 500)));
+	TEST_OUTPUT(!t.contains(Point(500, 100)));
+	TEST_OUTPUT(!t.contains(Point(500, 900)));
+	TEST_OUTPUT(t.contains(Point(500, 500)));
+	END_TEST();
+}
+
+void traps_spans_test(void)
+{
+	START_TEST("PolyTraps (spans and closed edges)");
+	// A U shape: two spans across the arms, one across the base
+	static const coord_t c[][2] = {
+		{0, 0}, {3000, 0}, {3000, 3000}, {2000, 3000},
+		{2000, 1000}, {1000, 1000}, {1000, 3000}, {0, 3000}};
+	ring_t r;
+	for (int i=0; i < 8; i++)
+		r.push_back(Point(c[i][0], c[i][1]));
+	PolyTraps t(r);
+	TEST_EQUALS_F(t.area(), 7000000);
+	
+	std::vector<std::pair<double, double> > sp;
+	t.spans(2000, sp);
+	TEST_EQUALS_I(sp.size(), 2);
+	TEST_OUTPUT(sp[0].first == 0 && sp[0].second == 1000);
+	TEST_OUTPUT(sp[1].first == 2000 && sp[1].second == 3000);
+	
+	sp.clear();
+	t.spans(500, sp);
+	TEST_EQUALS_I(sp.size(), 1);
+	TEST_OUTPUT(sp[0].first == 0 && sp[0].second == 3000);
+	
+	TEST_OUTPUT(t.contains(Point(1000, 2000)));
+	TEST_OUTPUT(t.contains(Point(1500, 1000)));
+	TEST_OUTPUT(t.contains(Point(3000, 3000)));
+	TEST_OUTPUT(!t.contains(Point(1500, 1001)));
+	TEST_OUTPUT(!t.contains(Point(3001, 0)));
+	END_TEST();
+}
+
+void trapezoid_tests(void)
+{
+	traps_simple_test();
+	traps_crossing_test();
+	traps_bowtie_test();
+	traps_spans_test();
+}
@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+#include <vector>
+#include <algorithm>
+
+#include "test_funcs.h"
+#include "../src/grid.h"
+#include "../src/rtree.h"
+#include "../src/partitioning.h"
+#include "../src/gcode_interp.h"
+#include "../src/gerbobj_line.h"
+
+/*
+ * Count allocations while a visit runs. Replacing the global operators
+ * covers the whole test program; they only count while counting is set
+ */
+static bool counting = false;
+static long allocs = 0;
+
+void * operator new(size_t n)
+{
+	if (counting)
+		allocs++;
+	void * p = malloc(n ? n : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void * p) throw()
+{
+	free(p);
+}
+
+// Collects into storage set aside beforehand, so it doesn't allocate
+struct collect {
+	std::vector<unsigned int> * v;
+	void operator()(unsigned int i) {v->push_back(i);};
+};
+
+// What a visit saw, sorted, against what the query returned
+static bool same_as(std::vector<unsigned int> seen, const std::vector<unsigned int> & want)
+{
+	std::sort(seen.begin(), seen.end());
+	return seen == want;
+}
+
+void visit_index_test(void)
+{
+	START_TEST("visit (grid and R-tree, against query)");
+	srand(11);
+	BoundsTable t;
+	random_table(t, 4000);
+	UniformGrid g;
+	g.build(t);
+	PackedRTree rt;
+	rt.build(t);
+	
+	std::vector<unsigned int> want, seen;
+	seen.reserve(t.size());
+	struct collect c = {&seen};
+	int bad = 0;
+	for (int q=0; q < 300; q++)
+	{
+		Rect r = random_query();
+		g.query(r, want);
+		
+		seen.clear();
+		counting = true;
+		g.visit(r, c);
+		counting = false;
+		if (!same_as(seen, want))
+			bad++;
+		
+		seen.clear();
+		counting = true;
+		rt.visit(r, c);
+		counting = false;
+		if (!same_as(seen, want))
+			bad++;
+	}
+	long used = allocs;
+	allocs = 0;
+	TEST_EQUALS_I(bad, 0);
+	TEST_EQUALS_I(used, 0);
+	END_TEST();
+}
+
+void visit_layer_test(void)
+{
+	START_TEST("visit_vector_outp (each index)");
+	srand(12);
+	Vector_Outp v;
+	for (int i=0; i < 1500; i++)
+	{
+		GerbObj_Line * l = new GerbObj_Line();
+		l->sx = rnd(0, 10000000);
+		l->sy = rnd(0, 10000000);
+		l->ex = l->sx + rnd(-500000, 500000);
+		l->ey = l->sy + rnd(-500000, 500000);
+		l->cx = l->cy = 0;
+		l->width = rnd(100000, 300000);
+		l->lt = LT_STRAIGHT;
+		l->lc = GerbObj_Line::LC_ROUND;
+		v.all.push_back(sp_GerbObj(l));
+	}
+	reindex_vector_outp(&v);
+	
+	enum layer_index_t kinds[] = {INDEX_SCAN, INDEX_GRID, INDEX_RTREE};
+	std::vector<unsigned int> want, seen;
+	seen.reserve(v.bounds.size());
+	struct collect c = {&seen};
+	int bad = 0;
+	for (int k=0; k < 3; k++)
+	{
+		index_vector_outp(&v, kinds[k]);
+		for (int q=0; q < 100; q++)
+		{
+			coord_t x = rnd(0, 10000000), y = rnd(0, 10000000);
+			Rect r(x, y, x + rnd(0, 1000000), y + rnd(0, 1000000));
+			query_vector_outp(&v, r, want);
+			seen.clear();
+			counting = true;
+			visit_vector_outp(&v, r, c);
+			counting = false;
+			if (!same_as(seen, want))
+				bad++;
+		}
+	}
+	long used = allocs;
+	allocs = 0;
+	TEST_EQUALS_I(bad, 0);
+	TEST_EQUALS_I(used, 0);
+	END_TEST();
+}
+
+// Part2D holds the boxes with extent that aren't very wide, less every
+// tenth once removals are done
+static bool part2d_keeps(const BoundsTable & t, unsigned int i)
+{
+	return t.minx[i] <= t.maxx[i] && t.maxx[i] - t.minx[i] < 5000000;
+}
+
+void visit_part2d_test(void)
+{
+	START_TEST("Part2D visit (against retrieve)");
+	srand(13);
+	// 0.1mm cells, so wide boxes cover many
+	Part2D<unsigned int> p(1.0 / (100 * COORD_PER_UM));
+	BoundsTable t;
+	random_table(t, 1000);
+	for (unsigned int i=0; i < t.size(); i++)
+		if (part2d_keeps(t, i))
+			p.insertbounded(t.minx[i], t.miny[i], t.maxx[i], t.maxy[i], i);
+	
+	// Take every tenth back out again
+	for (unsigned int i=0; i < t.size(); i += 10)
+		if (part2d_keeps(t, i))
+			p.removebounded(Rect(t.minx[i], t.miny[i], t.maxx[i], t.maxy[i]), i);
+	
+	std::vector<unsigned int> seen, exact, out;
+	seen.reserve(t.size());
+	struct collect c = {&seen};
+	int bad = 0, dups = 0, missed = 0, removed = 0;
+	for (int q=0; q < 200; q++)
+	{
+		Rect r = random_query();
+		Part2D<unsigned int>::cell_t want = p.retrieve(r);
+		
+		seen.clear();
+		counting = true;
+		p.visit(r, c);
+		counting = false;
+		std::sort(seen.begin(), seen.end());
+		if (std::adjacent_find(seen.begin(), seen.end()) != seen.end())
+			dups++;
+		if (seen != want)
+			bad++;
+		
+		out.clear();
+		p.retrieve(r, std::back_inserter(out));
+		std::sort(out.begin(), out.end());
+		if (out != want)
+			bad++;
+		
+		// Cells may hand back extras, but nothing whose box touches r
+		// may be missing, and nothing removed may come back
+		exact.clear();
+		t.query(r, exact);
+		for (unsigned int k=0; k < exact.size(); k++)
+		{
+			unsigned int i = exact[k];
+			bool in = std::binary_search(want.begin(), want.end(), i);
+			bool kept = part2d_keeps(t, i) && i % 10 != 0;
+			if (kept && !in)
+				missed++;
+		}
+		for (unsigned int k=0; k < want.size(); k++)
+			if (want[k] % 10 == 0)
+				removed++;
+	}
+	long used = allocs;
+	allocs = 0;
+	TEST_EQUALS_I(bad, 0);
+	TEST_EQUALS_I(dups, 0);
+	TEST_EQUALS_I(missed, 0);
+	TEST_EQUALS_I(removed, 0);
+	TEST_EQUALS_I(used, 0);
+	END_TEST();
+}
+
+void visit_tests(void)
+{
+	visit_index_test();
+	visit_layer_test();
+	visit_part2d_test();
+}